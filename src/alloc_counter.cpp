@@ -0,0 +1,51 @@
+// Replaces the global allocation functions so that everything allocated with
+// new -- nlohmann's std::map nodes and strings included -- shows up in
+// alloc_counter. Link this only into binaries that want the accounting; the
+// over-aligned overloads are left to the standard library.
+
+#include "alloc_counter.hpp"
+
+#include <new>
+
+void* operator new(std::size_t size) {
+    if (void* ptr = alloc_counter::allocate(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return alloc_counter::allocate(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return alloc_counter::allocate(size == 0 ? 1 : size);
+}
+
+void operator delete(void* ptr) noexcept {
+    alloc_counter::deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    alloc_counter::deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    alloc_counter::deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    alloc_counter::deallocate(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    alloc_counter::deallocate(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    alloc_counter::deallocate(ptr);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+struct alloc_stats {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+
+    alloc_stats operator+(const alloc_stats& other) const {
+        return {allocations + other.allocations, bytes + other.bytes};
+    }
+
+    alloc_stats operator-(const alloc_stats& other) const {
+        return {allocations - other.allocations, bytes - other.bytes};
+    }
+};
+
+// Process-wide allocation totals, live bytes and a resettable peak of live
+// bytes. Relaxed atomics: the counters are only read between benchmark runs,
+// never used to synchronise anything.
+//
+// Memory handed out through allocate()/reallocate() carries a small header
+// with its size so deallocate() can keep the live count exact without help
+// from the caller. Binaries that link alloc_counter.cpp route the global
+// operator new/delete through here; RapidJSON allocates with malloc, so use
+// counting_allocator for its documents.
+class alloc_counter {
+public:
+    static constexpr size_t header_size = alignof(std::max_align_t);
+
+    static void record(size_t bytes) {
+        _allocations.fetch_add(1, std::memory_order_relaxed);
+        _bytes.fetch_add(bytes, std::memory_order_relaxed);
+        uint64_t live = _live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        uint64_t peak = _peak.load(std::memory_order_relaxed);
+        while (live > peak && !_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) { }
+    }
+
+    static void release(size_t bytes) {
+        _live.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    static alloc_stats snapshot() {
+        return {_allocations.load(std::memory_order_relaxed), _bytes.load(std::memory_order_relaxed)};
+    }
+
+    static uint64_t live_bytes() {
+        return _live.load(std::memory_order_relaxed);
+    }
+
+    static uint64_t peak_bytes() {
+        return _peak.load(std::memory_order_relaxed);
+    }
+
+    // Restarts peak tracking from the current live byte count.
+    static void reset_peak() {
+        _peak.store(_live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    static void* allocate(size_t size) {
+        auto* base = static_cast<char*>(std::malloc(size + header_size));
+        if (base == nullptr) {
+            return nullptr;
+        }
+        *reinterpret_cast<size_t*>(base) = size;
+        record(size);
+        return base + header_size;
+    }
+
+    static void* reallocate(void* ptr, size_t new_size) {
+        if (ptr == nullptr) {
+            return allocate(new_size);
+        }
+        char* base = static_cast<char*>(ptr) - header_size;
+        size_t old_size = *reinterpret_cast<size_t*>(base);
+        auto* moved = static_cast<char*>(std::realloc(base, new_size + header_size));
+        if (moved == nullptr) {
+            return nullptr;
+        }
+        *reinterpret_cast<size_t*>(moved) = new_size;
+        release(old_size);
+        record(new_size);
+        return moved + header_size;
+    }
+
+    static void deallocate(void* ptr) {
+        if (ptr == nullptr) {
+            return;
+        }
+        char* base = static_cast<char*>(ptr) - header_size;
+        release(*reinterpret_cast<size_t*>(base));
+        std::free(base);
+    }
+
+private:
+    static inline std::atomic<uint64_t> _allocations{0};
+    static inline std::atomic<uint64_t> _bytes{0};
+    static inline std::atomic<uint64_t> _live{0};
+    static inline std::atomic<uint64_t> _peak{0};
+};
+
+// Drop-in replacement for rapidjson::CrtAllocator that records every request in
+// alloc_counter. Use it as the base allocator of MemoryPoolAllocator and as the
+// stack allocator of GenericDocument to count what a parse really asks of malloc.
+class counting_allocator {
+public:
+    static const bool kNeedFree = true;
+
+    void* Malloc(size_t size) {
+        if (size == 0) {
+            return nullptr;
+        }
+        return alloc_counter::allocate(size);
+    }
+
+    void* Realloc(void* original_ptr, size_t original_size, size_t new_size) {
+        (void) original_size;
+        if (new_size == 0) {
+            alloc_counter::deallocate(original_ptr);
+            return nullptr;
+        }
+        return alloc_counter::reallocate(original_ptr, new_size);
+    }
+
+    static void Free(void* ptr) {
+        alloc_counter::deallocate(ptr);
+    }
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "alloc_counter.hpp"
+#include "profile.hpp"
+
+// Allocation counters are taken from one extra, untimed run of the benchmark's
+// operation after the timing loop, so the accounting never perturbs the
+// timings and the paused setup/teardown in the loop is not counted. The
+// operations are deterministic, which makes one run exact per-document numbers.
+//
+//   allocs       allocations made by one run
+//   alloc_bytes  bytes requested by those allocations
+//   peak_bytes   high-water mark of live bytes above what was live before
+
+inline void set_allocation_counters(benchmark::State& state, const alloc_stats& allocs, uint64_t peak_bytes) {
+    state.counters["allocs"] = benchmark::Counter(static_cast<double>(allocs.allocations));
+    state.counters["alloc_bytes"] = benchmark::Counter(static_cast<double>(allocs.bytes));
+    state.counters["peak_bytes"] = benchmark::Counter(static_cast<double>(peak_bytes));
+}
+
+template <typename Operation>
+void report_allocations(benchmark::State& state, Operation&& operation) {
+    uint64_t live_before = alloc_counter::live_bytes();
+    alloc_stats before = alloc_counter::snapshot();
+    alloc_counter::reset_peak();
+
+    if constexpr (std::is_void_v<decltype(operation())>) {
+        operation();
+    } else {
+        auto result = operation();
+        (void) result;
+    }
+
+    set_allocation_counters(state, alloc_counter::snapshot() - before,
+            alloc_counter::peak_bytes() - live_before);
+}
+
+// As report_allocations, for operations that build a DOM and return it. Also
+// reports the bytes the DOM keeps alive (dom_bytes) and dom_bytes_per_byte,
+// its footprint relative to input_bytes of JSON text.
+template <typename Operation>
+void report_dom_allocations(benchmark::State& state, size_t input_bytes, Operation&& operation) {
+    uint64_t live_before = alloc_counter::live_bytes();
+    alloc_stats before = alloc_counter::snapshot();
+    alloc_counter::reset_peak();
+
+    auto dom = operation();
+    uint64_t dom_bytes = alloc_counter::live_bytes() - live_before;
+
+    set_allocation_counters(state, alloc_counter::snapshot() - before,
+            alloc_counter::peak_bytes() - live_before);
+    state.counters["dom_bytes"] = benchmark::Counter(static_cast<double>(dom_bytes));
+    state.counters["dom_bytes_per_byte"] = benchmark::Counter(
+            input_bytes == 0 ? 0.0 : static_cast<double>(dom_bytes) / static_cast<double>(input_bytes));
+}
+
+// Phase times and hardware counters for a benchmark's timing loop, built only
+// with JSON_COMPARISON_PROFILE. Construct it just before the loop, use its
+// pause/resume in place of State::PauseTiming/ResumeTiming so that untimed
+// setup is not counted, and call report after the loop. Per iteration:
+//
+//   <phase>_ns      time spent in each phase that was entered (see profile.hpp)
+//   cycles, instructions, ipc, branch_misses, l1d_misses, llc_misses
+//                   where perf_event_open allows them
+//
+// Phase times only cover code inside a phase_scope; the hardware counters
+// cover everything timed. Without JSON_COMPARISON_PROFILE nothing is reported.
+class profile_session {
+public:
+    profile_session() {
+#ifdef JSON_COMPARISON_PROFILE
+        reset_thread_phases();
+        _counters.start();
+#endif
+    }
+
+    void pause(benchmark::State& state) {
+        state.PauseTiming();
+#ifdef JSON_COMPARISON_PROFILE
+        _counters.pause();
+#endif
+    }
+
+    void resume(benchmark::State& state) {
+#ifdef JSON_COMPARISON_PROFILE
+        _counters.resume();
+#endif
+        state.ResumeTiming();
+    }
+
+    void report(benchmark::State& state) {
+#ifdef JSON_COMPARISON_PROFILE
+        _counters.stop();
+        double iterations = state.iterations() == 0 ? 1.0 : static_cast<double>(state.iterations());
+
+        phase_totals totals = thread_phase_totals();
+        for (size_t i = 0; i < phase_count; ++i) {
+            if (totals.ns[i] != 0) {
+                state.counters[std::string(phase_name(static_cast<phase>(i))) + "_ns"] =
+                        benchmark::Counter(static_cast<double>(totals.ns[i]) / iterations);
+            }
+        }
+
+        for (size_t i = 0; i < hw_counter_count; ++i) {
+            std::optional<uint64_t> value = _counters.value(static_cast<hw_counter>(i));
+            if (value) {
+                state.counters[hw_counter_name(static_cast<hw_counter>(i))] =
+                        benchmark::Counter(static_cast<double>(*value) / iterations);
+            }
+        }
+        std::optional<uint64_t> cycles = _counters.value(hw_counter::cycles);
+        std::optional<uint64_t> instructions = _counters.value(hw_counter::instructions);
+        if (cycles && instructions && *cycles != 0) {
+            state.counters["ipc"] = benchmark::Counter(static_cast<double>(*instructions) / static_cast<double>(*cycles));
+        }
+#else
+        (void) state;
+#endif
+    }
+
+private:
+#ifdef JSON_COMPARISON_PROFILE
+    perf_counters _counters;
+#endif
+};
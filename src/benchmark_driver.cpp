@@ -0,0 +1,465 @@
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Runs the benchmark binaries pinned to fixed CPUs, with repetitions, keeping
+// google benchmark's JSON output; and compares two sets of such results case
+// by case, with a Mann-Whitney U test on the repetitions, so that dependency
+// upgrades are checked for regressions by more than eye.
+//
+//     benchmark_driver run --out results/baseline nlohmann_benchmark rapid_benchmark
+//     (upgrade, rebuild)
+//     benchmark_driver run --out results/current nlohmann_benchmark rapid_benchmark
+//     benchmark_driver compare results/baseline results/current
+//
+// compare exits with 1 if any case is significantly slower by more than the
+// threshold, and with 2 if a case in the baseline failed (SkipWithError) or is
+// missing in the current results.
+
+namespace {
+
+const int exit_regression = 1;
+const int exit_failure = 2;
+
+int usage() {
+    std::cerr << "usage: benchmark_driver run [--out DIR] [--repetitions N] [--cpus LIST] [--filter REGEX] BINARY...\n"
+              << "       benchmark_driver compare [--alpha P] [--threshold PERCENT] [--time real|cpu] BASELINE CURRENT\n"
+              << "\n"
+              << "run writes DIR/<binary>.json for each binary, run from its own directory and pinned to\n"
+              << "LIST (e.g. 2 or 2-3,6; default 1). compare takes two such directories, or two files;\n"
+              << "a case regresses when its median time grows by more than PERCENT (default 5) with a\n"
+              << "two-sided p-value below P (default 0.05). Exits with 1 on regressions, and with 2 on\n"
+              << "errors, including cases that failed or are missing in CURRENT.\n";
+    return exit_failure;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// run
+//////////////////////////////////////////////////////////////////////////////
+
+// "2-3,6" -> {2, 3, 6}.
+std::vector<int> parse_cpus(const std::string& text) {
+    std::vector<int> cpus;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string range = text.substr(start, end - start);
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            throw std::invalid_argument("invalid CPU list: " + text);
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+        start = end + 1;
+    }
+    return cpus;
+}
+
+// Runs binary from its own directory, as the benchmarks find their data
+// relative to it, pinned to cpus. Returns the exit status.
+int run_pinned(const fs::path& binary, const std::vector<std::string>& args, const std::vector<int>& cpus) {
+    std::vector<char*> argv;
+    std::string program = binary.string();
+    argv.push_back(program.data());
+    std::vector<std::string> owned = args;
+    for (std::string& arg : owned) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        throw std::runtime_error(fmt::format("fork failed: {}", std::strerror(errno)));
+    }
+    if (pid == 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            CPU_SET(cpu, &set);
+        }
+        if (::sched_setaffinity(0, sizeof(set), &set) != 0) {
+            std::cerr << "benchmark_driver: failed to pin " << program << " to --cpus: "
+                      << std::strerror(errno) << "\n";
+            ::_exit(127);
+        }
+        if (binary.has_parent_path() && ::chdir(binary.parent_path().c_str()) != 0) {
+            std::cerr << "benchmark_driver: failed to enter " << binary.parent_path() << ": "
+                      << std::strerror(errno) << "\n";
+            ::_exit(127);
+        }
+        ::execv(program.c_str(), argv.data());
+        std::cerr << "benchmark_driver: failed to run " << program << ": " << std::strerror(errno) << "\n";
+        ::_exit(127);
+    }
+
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            throw std::runtime_error(fmt::format("waitpid failed: {}", std::strerror(errno)));
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+int run(int argc, char** argv) {
+    fs::path out_dir = "benchmark_results";
+    int repetitions = 10;
+    std::vector<int> cpus = {1};
+    std::string filter;
+    std::vector<fs::path> binaries;
+
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (arg == "--repetitions" && i + 1 < argc) {
+            repetitions = std::stoi(argv[++i]);
+        } else if (arg == "--cpus" && i + 1 < argc) {
+            cpus = parse_cpus(argv[++i]);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg.rfind("--", 0) == 0) {
+            return usage();
+        } else {
+            binaries.push_back(fs::absolute(arg));
+        }
+    }
+    if (binaries.empty() || repetitions < 1) {
+        return usage();
+    }
+
+    fs::create_directories(out_dir);
+    int failed = 0;
+    for (const fs::path& binary : binaries) {
+        fs::path out = fs::absolute(out_dir / (binary.stem().string() + ".json"));
+        std::vector<std::string> args = {
+            "--benchmark_repetitions=" + std::to_string(repetitions),
+            "--benchmark_display_aggregates_only=true",
+            "--benchmark_out_format=json",
+            "--benchmark_out=" + out.string(),
+        };
+        if (!filter.empty()) {
+            args.push_back("--benchmark_filter=" + filter);
+        }
+
+        std::cout << "== " << binary.filename().string() << " -> " << out.string() << "\n" << std::flush;
+        int status = run_pinned(binary, args, cpus);
+        if (status != 0) {
+            std::cerr << "benchmark_driver: " << binary.filename().string() << " exited with " << status << "\n";
+            ++failed;
+        }
+    }
+    return failed == 0 ? 0 : exit_failure;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// compare
+//////////////////////////////////////////////////////////////////////////////
+
+// Times of every repetition of every case in a result file, in nanoseconds,
+// with aggregates (mean, median, stddev) left out; and the cases that reported
+// an error, with its message.
+struct result_file {
+    std::map<std::string, std::vector<double>> cases;
+    std::map<std::string, std::string> errors;
+};
+
+result_file load_results(const fs::path& filename, const std::string& time_key) {
+    std::ifstream in(filename);
+    if (!in) {
+        throw std::runtime_error("failed to open " + filename.string());
+    }
+    nlohmann::json results = nlohmann::json::parse(in);
+
+    result_file file;
+    for (const auto& run : results.at("benchmarks")) {
+        if (run.value("run_type", "iteration") != "iteration" || run.find("aggregate_name") != run.end()) {
+            continue;
+        }
+
+        std::string name = run.value("run_name", run.at("name").get<std::string>());
+        if (run.value("error_occurred", false)) {
+            file.errors[name] = run.value("error_message", "");
+            continue;
+        }
+        std::string unit = run.value("time_unit", "ns");
+        double scale = unit == "s" ? 1e9 : unit == "ms" ? 1e6 : unit == "us" ? 1e3 : 1;
+        file.cases[name].push_back(run.at(time_key).get<double>() * scale);
+    }
+    return file;
+}
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 == 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// Two-sided p-value of the Mann-Whitney U test that a and b come from the same
+// distribution. Exact for small samples without ties; otherwise the normal
+// approximation, corrected for ties and continuity.
+double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b) {
+    size_t m = a.size();
+    size_t n = b.size();
+
+    // Ranks over both samples, ties sharing their mean rank.
+    std::vector<std::pair<double, size_t>> all;
+    for (double x : a) {
+        all.emplace_back(x, 0);
+    }
+    for (double x : b) {
+        all.emplace_back(x, 1);
+    }
+    std::sort(all.begin(), all.end());
+
+    double rank_sum_a = 0;
+    double tie_term = 0;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first) {
+            ++j;
+        }
+        double rank = (static_cast<double>(i + 1) + static_cast<double>(j)) / 2;
+        for (size_t k = i; k < j; ++k) {
+            if (all[k].second == 0) {
+                rank_sum_a += rank;
+            }
+        }
+        double t = static_cast<double>(j - i);
+        tie_term += t * t * t - t;
+        i = j;
+    }
+
+    double u = rank_sum_a - static_cast<double>(m * (m + 1)) / 2;
+    double mean = static_cast<double>(m * n) / 2;
+
+    if (tie_term == 0 && m <= 50 && n <= 50) {
+        // f(i, j)[v]: orderings of i values of a and j of b with U = v. The
+        // largest value is either from a, beating all j of b, or from b:
+        // f(i, j)[v] = f(i - 1, j)[v - j] + f(i, j - 1)[v]. Kept a column of j
+        // at a time.
+        size_t max_u = m * n;
+        std::vector<std::vector<double>> previous(m + 1, std::vector<double>(max_u + 1, 0));
+        std::vector<std::vector<double>> column = previous;
+        for (size_t i = 0; i <= m; ++i) {
+            previous[i][0] = 1;
+        }
+        for (size_t j = 1; j <= n; ++j) {
+            for (size_t i = 0; i <= m; ++i) {
+                for (size_t v = 0; v <= max_u; ++v) {
+                    column[i][v] = previous[i][v] + (i > 0 && v >= j ? column[i - 1][v - j] : 0);
+                }
+            }
+            std::swap(previous, column);
+        }
+
+        double total = 0;
+        double tail = 0;
+        double low = std::min(u, static_cast<double>(max_u) - u);
+        for (size_t v = 0; v <= max_u; ++v) {
+            total += previous[m][v];
+            if (static_cast<double>(v) <= low) {
+                tail += previous[m][v];
+            }
+        }
+        return std::min(1.0, 2 * tail / total);
+    }
+
+    double total = static_cast<double>(m + n);
+    double variance = static_cast<double>(m * n) / 12 * ((total + 1) - tie_term / (total * (total - 1)));
+    if (variance <= 0) {
+        return 1;
+    }
+    double z = (std::fabs(u - mean) - 0.5) / std::sqrt(variance);
+    return std::min(1.0, std::erfc(std::max(z, 0.0) / std::sqrt(2.0)));
+}
+
+std::string format_time(double ns) {
+    if (ns >= 1e9) {
+        return fmt::format("{:.3f} s", ns / 1e9);
+    }
+    if (ns >= 1e6) {
+        return fmt::format("{:.3f} ms", ns / 1e6);
+    }
+    if (ns >= 1e3) {
+        return fmt::format("{:.3f} us", ns / 1e3);
+    }
+    return fmt::format("{:.1f} ns", ns);
+}
+
+struct compare_options {
+    double alpha = 0.05;
+    double threshold = 5;
+    std::string time_key = "real_time";
+};
+
+struct compare_counts {
+    int regressions = 0;
+    // Cases that reported an error in the current run, or are in the baseline
+    // but missing from it: a benchmark that stops running must not pass.
+    int failures = 0;
+};
+
+// Prints one row per case.
+compare_counts compare_file(const fs::path& baseline_file, const fs::path& current_file, const std::string& prefix,
+        const compare_options& options) {
+    result_file baseline = load_results(baseline_file, options.time_key);
+    result_file current = load_results(current_file, options.time_key);
+
+    compare_counts counts;
+    for (const auto& entry : current.cases) {
+        std::string name = prefix + entry.first;
+        auto before = baseline.cases.find(entry.first);
+        if (before == baseline.cases.end()) {
+            std::cout << fmt::format("{:<60} {:>12} {:>12}\n", name, "-", format_time(median(entry.second)));
+            continue;
+        }
+
+        double old_median = median(before->second);
+        double new_median = median(entry.second);
+        double change = (new_median - old_median) / old_median * 100;
+        double p = mann_whitney_p(before->second, entry.second);
+
+        const char* verdict = "";
+        if (p < options.alpha && change > options.threshold) {
+            verdict = "  REGRESSION";
+            ++counts.regressions;
+        } else if (p < options.alpha && change < -options.threshold) {
+            verdict = "  improvement";
+        }
+        std::cout << fmt::format("{:<60} {:>12} {:>12} {:>+8.1f}% {:>8.4f}{}\n", name, format_time(old_median),
+                format_time(new_median), change, p, verdict);
+    }
+    for (const auto& entry : current.errors) {
+        auto before = baseline.cases.find(entry.first);
+        std::cout << fmt::format("{:<60} {:>12} {:>12}  FAILED: {}\n", prefix + entry.first,
+                before == baseline.cases.end() ? "-" : format_time(median(before->second)), "error", entry.second);
+        ++counts.failures;
+    }
+    for (const auto& entry : baseline.cases) {
+        if (current.cases.find(entry.first) == current.cases.end()
+                && current.errors.find(entry.first) == current.errors.end()) {
+            std::cout << fmt::format("{:<60} {:>12} {:>12}  MISSING\n", prefix + entry.first,
+                    format_time(median(entry.second)), "-");
+            ++counts.failures;
+        }
+    }
+    return counts;
+}
+
+int compare(int argc, char** argv) {
+    compare_options options;
+    std::vector<fs::path> paths;
+
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--alpha" && i + 1 < argc) {
+            options.alpha = std::stod(argv[++i]);
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            options.threshold = std::stod(argv[++i]);
+        } else if (arg == "--time" && i + 1 < argc) {
+            std::string time = argv[++i];
+            if (time != "real" && time != "cpu") {
+                return usage();
+            }
+            options.time_key = time + "_time";
+        } else if (arg.rfind("--", 0) == 0) {
+            return usage();
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != 2) {
+        return usage();
+    }
+
+    // Pairs of result files, matched by name when given directories.
+    std::vector<std::pair<fs::path, fs::path>> files;
+    int missing_files = 0;
+    if (fs::is_directory(paths[0]) && fs::is_directory(paths[1])) {
+        for (const auto& entry : fs::directory_iterator(paths[1])) {
+            fs::path baseline = paths[0] / entry.path().filename();
+            if (entry.path().extension() == ".json" && fs::exists(baseline)) {
+                files.emplace_back(baseline, entry.path());
+            } else if (entry.path().extension() == ".json") {
+                std::cerr << "benchmark_driver: no baseline for " << entry.path().filename().string() << "\n";
+            }
+        }
+        for (const auto& entry : fs::directory_iterator(paths[0])) {
+            if (entry.path().extension() == ".json" && !fs::exists(paths[1] / entry.path().filename())) {
+                std::cerr << "benchmark_driver: no current results for " << entry.path().filename().string() << "\n";
+                ++missing_files;
+            }
+        }
+        std::sort(files.begin(), files.end());
+    } else {
+        files.emplace_back(paths[0], paths[1]);
+    }
+    if (files.empty()) {
+        throw std::runtime_error("no result files to compare");
+    }
+
+    std::cout << fmt::format("{:<60} {:>12} {:>12} {:>9} {:>8}\n", "benchmark", "baseline", "current", "change",
+            "p-value");
+    compare_counts total;
+    for (const auto& pair : files) {
+        std::string prefix = files.size() > 1 ? pair.second.stem().string() + ": " : "";
+        compare_counts counts = compare_file(pair.first, pair.second, prefix, options);
+        total.regressions += counts.regressions;
+        total.failures += counts.failures;
+    }
+
+    if (total.regressions != 0) {
+        std::cout << total.regressions << " significant regression" << (total.regressions == 1 ? "" : "s") << "\n";
+    }
+    if (total.failures != 0) {
+        std::cout << total.failures << " failed or missing case" << (total.failures == 1 ? "" : "s") << "\n";
+    }
+    if (total.failures != 0 || missing_files != 0) {
+        return exit_failure;
+    }
+    return total.regressions != 0 ? exit_regression : 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        return usage();
+    }
+    std::string command = argv[1];
+
+    try {
+        if (command == "run") {
+            return run(argc - 2, argv + 2);
+        }
+        if (command == "compare") {
+            return compare(argc - 2, argv + 2);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "benchmark_driver: " << e.what() << "\n";
+        return exit_failure;
+    }
+    return usage();
+}
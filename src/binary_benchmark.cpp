@@ -0,0 +1,188 @@
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <fstream>
+
+#include "benchmark_counters.hpp"
+#include "binary_cache.hpp"
+#include "mapped_file.hpp"
+
+using json = nlohmann::json;
+
+static std::string ReadString(const char* filename)
+{
+    std::ifstream f(filename);
+    return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+// size is the encoded size of the document; size_ratio is that relative to
+// the JSON text as found on disk.
+static void SetSizeCounters(benchmark::State& state, size_t size, size_t text_size)
+{
+    state.counters["size"] = benchmark::Counter(static_cast<double>(size));
+    state.counters["size_ratio"] = benchmark::Counter(
+            text_size == 0 ? 0.0 : static_cast<double>(size) / static_cast<double>(text_size));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// encode
+//////////////////////////////////////////////////////////////////////////////
+
+static void DumpText(benchmark::State& state, const char* filename)
+{
+    std::string str = ReadString(filename);
+    json j = json::parse(str);
+
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(j.dump());
+    }
+
+    size_t size = j.dump().size();
+    state.SetBytesProcessed(state.iterations() * size);
+    SetSizeCounters(state, size, str.size());
+}
+
+static void Encode(benchmark::State& state, const char* filename, binary_format format)
+{
+    std::string str = ReadString(filename);
+    json j = json::parse(str);
+    if (format == binary_format::bson && !j.is_object())
+    {
+        state.SkipWithError("BSON needs an object at the root");
+        return;
+    }
+
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(to_binary(j, format));
+    }
+
+    size_t size = to_binary(j, format).size();
+    state.SetBytesProcessed(state.iterations() * size);
+    SetSizeCounters(state, size, str.size());
+    report_allocations(state, [&] {
+        return to_binary(j, format);
+    });
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// decode
+//////////////////////////////////////////////////////////////////////////////
+
+static void ParseText(benchmark::State& state, const char* filename)
+{
+    std::string str = ReadString(filename);
+
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(json::parse(str));
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    SetSizeCounters(state, str.size(), str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        return json::parse(str);
+    });
+}
+
+static void Decode(benchmark::State& state, const char* filename, binary_format format)
+{
+    std::string str = ReadString(filename);
+    json j = json::parse(str);
+    if (format == binary_format::bson && !j.is_object())
+    {
+        state.SkipWithError("BSON needs an object at the root");
+        return;
+    }
+    std::vector<uint8_t> encoded = to_binary(j, format);
+
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(from_binary(encoded.data(), encoded.size(), format));
+    }
+
+    state.SetBytesProcessed(state.iterations() * encoded.size());
+    SetSizeCounters(state, encoded.size(), str.size());
+    report_dom_allocations(state, encoded.size(), [&] {
+        return from_binary(encoded.data(), encoded.size(), format);
+    });
+}
+
+#define BINARY_CAPTURES(name, filename) \
+    BENCHMARK_CAPTURE(DumpText,  name,           filename); \
+    BENCHMARK_CAPTURE(Encode,    name / cbor,    filename, binary_format::cbor); \
+    BENCHMARK_CAPTURE(Encode,    name / msgpack, filename, binary_format::msgpack); \
+    BENCHMARK_CAPTURE(Encode,    name / ubjson,  filename, binary_format::ubjson); \
+    BENCHMARK_CAPTURE(Encode,    name / bson,    filename, binary_format::bson); \
+    BENCHMARK_CAPTURE(ParseText, name,           filename); \
+    BENCHMARK_CAPTURE(Decode,    name / cbor,    filename, binary_format::cbor); \
+    BENCHMARK_CAPTURE(Decode,    name / msgpack, filename, binary_format::msgpack); \
+    BENCHMARK_CAPTURE(Decode,    name / ubjson,  filename, binary_format::ubjson); \
+    BENCHMARK_CAPTURE(Decode,    name / bson,    filename, binary_format::bson)
+
+BINARY_CAPTURES(jeopardy,          "../data/jeopardy/jeopardy.json");
+BINARY_CAPTURES(canada,            "../data/nativejson-benchmark/canada.json");
+BINARY_CAPTURES(citm_catalog,      "../data/nativejson-benchmark/citm_catalog.json");
+BINARY_CAPTURES(twitter,           "../data/nativejson-benchmark/twitter.json");
+BINARY_CAPTURES(floats,            "../data/numbers/floats.json");
+BINARY_CAPTURES(signed_ints,       "../data/numbers/signed_ints.json");
+BINARY_CAPTURES(unsigned_ints,     "../data/numbers/unsigned_ints.json");
+BINARY_CAPTURES(small_signed_ints, "../data/numbers/small_signed_ints.json");
+
+//////////////////////////////////////////////////////////////////////////////
+// startup: load a configuration document from disk
+//////////////////////////////////////////////////////////////////////////////
+
+static const char* const CacheDirectory = "binary_cache";
+
+static void StartupText(benchmark::State& state, const char* filename)
+{
+    while (state.KeepRunning())
+    {
+        mapped_file file(filename);
+        benchmark::DoNotOptimize(json::parse(file.data(), file.data() + file.size()));
+    }
+
+    state.SetBytesProcessed(state.iterations() * mapped_file(filename).size());
+}
+
+// Every load is a hit: the entry is written once before timing.
+static void StartupCached(benchmark::State& state, const char* filename, binary_format format)
+{
+    document_cache cache(CacheDirectory, format);
+    cache.load(filename);
+
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(cache.load(filename));
+    }
+
+    state.SetBytesProcessed(state.iterations() * mapped_file(filename).size());
+    state.counters["hits"] = benchmark::Counter(static_cast<double>(cache.hits()));
+}
+
+// Every load is a miss: parse, encode and write the entry.
+static void StartupCacheMiss(benchmark::State& state, const char* filename, binary_format format)
+{
+    document_cache cache(CacheDirectory, format);
+
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        cache.clear();
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(cache.load(filename));
+    }
+
+    state.SetBytesProcessed(state.iterations() * mapped_file(filename).size());
+}
+
+BENCHMARK_CAPTURE(StartupText,      citm_catalog,           "../data/nativejson-benchmark/citm_catalog.json");
+BENCHMARK_CAPTURE(StartupCached,    citm_catalog / cbor,    "../data/nativejson-benchmark/citm_catalog.json", binary_format::cbor);
+BENCHMARK_CAPTURE(StartupCached,    citm_catalog / msgpack, "../data/nativejson-benchmark/citm_catalog.json", binary_format::msgpack);
+BENCHMARK_CAPTURE(StartupCached,    citm_catalog / ubjson,  "../data/nativejson-benchmark/citm_catalog.json", binary_format::ubjson);
+BENCHMARK_CAPTURE(StartupCached,    citm_catalog / bson,    "../data/nativejson-benchmark/citm_catalog.json", binary_format::bson);
+BENCHMARK_CAPTURE(StartupCacheMiss, citm_catalog / msgpack, "../data/nativejson-benchmark/citm_catalog.json", binary_format::msgpack);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,193 @@
+#include "binary_cache.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include "mapped_file.hpp"
+
+const char* binary_format_name(binary_format format) {
+    switch (format) {
+    case binary_format::cbor:
+        return "cbor";
+    case binary_format::msgpack:
+        return "msgpack";
+    case binary_format::ubjson:
+        return "ubjson";
+    case binary_format::bson:
+        return "bson";
+    }
+    return "unknown";
+}
+
+std::vector<uint8_t> to_binary(const nlohmann::json& j, binary_format format) {
+    switch (format) {
+    case binary_format::cbor:
+        return nlohmann::json::to_cbor(j);
+    case binary_format::msgpack:
+        return nlohmann::json::to_msgpack(j);
+    case binary_format::ubjson:
+        return nlohmann::json::to_ubjson(j);
+    case binary_format::bson:
+        return nlohmann::json::to_bson(j);
+    }
+    return {};
+}
+
+nlohmann::json from_binary(const uint8_t* data, size_t size, binary_format format) {
+    switch (format) {
+    case binary_format::cbor:
+        return nlohmann::json::from_cbor(data, data + size);
+    case binary_format::msgpack:
+        return nlohmann::json::from_msgpack(data, data + size);
+    case binary_format::ubjson:
+        return nlohmann::json::from_ubjson(data, data + size);
+    case binary_format::bson:
+        return nlohmann::json::from_bson(data, data + size);
+    }
+    return nullptr;
+}
+
+uint64_t fnv1a_hash(std::string_view data) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+namespace {
+
+// Written before the encoded document. An entry is named by the FNV-1a hash
+// of its text; the header repeats the text's size and a second, unrelated
+// hash of it, so an entry left by a colliding or renamed document is detected
+// and replaced rather than returned.
+struct entry_header {
+    char magic[4];
+    uint32_t format;
+    uint64_t source_size;
+    uint64_t source_check;
+};
+
+const char entry_magic[4] = {'J', 'D', 'C', '1'};
+
+// Eight bytes at a time through a multiply-xorshift mix, unlike FNV-1a's
+// byte-wise multiply, so the two hashes do not collide on the same inputs.
+uint64_t check_hash(std::string_view data) {
+    uint64_t hash = 0x9e3779b97f4a7c15ULL ^ data.size();
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        hash = (hash ^ word) * 0xbf58476d1ce4e5b9ULL;
+        hash ^= hash >> 31;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data.data() + i, data.size() - i);
+    hash = (hash ^ tail) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 29);
+}
+
+entry_header make_header(std::string_view text, binary_format format) {
+    entry_header header;
+    std::memcpy(header.magic, entry_magic, sizeof(entry_magic));
+    header.format = static_cast<uint32_t>(format);
+    header.source_size = text.size();
+    header.source_check = check_hash(text);
+    return header;
+}
+
+}
+
+document_cache::document_cache(std::string directory, binary_format format)
+        :_directory(std::move(directory)), _format(format) {
+    if (::mkdir(_directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::runtime_error(fmt::format("Failed to create {}: {}", _directory, std::strerror(errno)));
+    }
+}
+
+nlohmann::json document_cache::load(const std::string& filename) {
+    mapped_file file(filename);
+    return load_text(file.view());
+}
+
+nlohmann::json document_cache::load_text(std::string_view text) {
+    std::string path = entry_path(fnv1a_hash(text));
+    entry_header header = make_header(text, _format);
+
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0 && static_cast<size_t>(st.st_size) > sizeof(header)) {
+        mapped_file entry(path);
+        if (std::memcmp(entry.data(), &header, sizeof(header)) == 0) {
+            ++_hits;
+            return from_binary(reinterpret_cast<const uint8_t*>(entry.data()) + sizeof(header),
+                    entry.size() - sizeof(header), _format);
+        }
+        ++_mismatches;
+    }
+
+    ++_misses;
+    nlohmann::json j = nlohmann::json::parse(text.data(), text.data() + text.size());
+    store(path, text, to_binary(j, _format));
+    return j;
+}
+
+std::string document_cache::entry_path(uint64_t hash) const {
+    return fmt::format("{}/{:016x}.{}", _directory, hash, binary_format_name(_format));
+}
+
+void document_cache::clear() {
+    DIR* dir = ::opendir(_directory.c_str());
+    if (dir == nullptr) {
+        return;
+    }
+    while (dirent* entry = ::readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            std::remove(fmt::format("{}/{}", _directory, entry->d_name).c_str());
+        }
+    }
+    ::closedir(dir);
+}
+
+void document_cache::store(const std::string& path, std::string_view text, const std::vector<uint8_t>& document) {
+    entry_header header = make_header(text, _format);
+    std::vector<uint8_t> encoded(sizeof(header));
+    std::memcpy(encoded.data(), &header, sizeof(header));
+    encoded.insert(encoded.end(), document.begin(), document.end());
+
+    std::string temporary = fmt::format("{}.{}.tmp", path, ::getpid());
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error(fmt::format("Failed to open {}: {}", temporary, std::strerror(errno)));
+    }
+
+    size_t offset = 0;
+    while (offset < encoded.size()) {
+        ssize_t n = ::write(fd, encoded.data() + offset, encoded.size() - offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            int error = errno;
+            ::close(fd);
+            std::remove(temporary.c_str());
+            throw std::runtime_error(fmt::format("Failed to write {}: {}", temporary, std::strerror(error)));
+        }
+        offset += static_cast<size_t>(n);
+    }
+    ::close(fd);
+
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        int error = errno;
+        std::remove(temporary.c_str());
+        throw std::runtime_error(fmt::format("Failed to rename {}: {}", temporary, std::strerror(error)));
+    }
+}
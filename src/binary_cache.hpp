@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// nlohmann's binary encodings. BSON can only encode objects at the root.
+enum class binary_format {
+    cbor,
+    msgpack,
+    ubjson,
+    bson,
+};
+
+const char* binary_format_name(binary_format format);
+
+std::vector<uint8_t> to_binary(const nlohmann::json& j, binary_format format);
+
+// Throws nlohmann::json::parse_error on malformed input.
+nlohmann::json from_binary(const uint8_t* data, size_t size, binary_format format);
+
+// 64-bit FNV-1a.
+uint64_t fnv1a_hash(std::string_view data);
+
+// Keeps the parsed form of JSON documents on disk in one of the binary
+// encodings, keyed by a hash of the JSON text, so a process that loads the
+// same configuration on every start decodes it instead of parsing it. The
+// text still has to be read and hashed to find its entry; a changed file
+// simply hashes to a new entry. Each entry records the size and a second hash
+// of its text, checked on load; an entry that does not match (a hash
+// collision, or a file left behind by another document) is counted in
+// mismatches() and replaced.
+//
+// Entries are written to a temporary name and renamed into place, so
+// concurrent processes sharing a directory only ever see complete entries.
+// Stale entries are never removed; clear() empties the directory.
+class document_cache {
+public:
+    explicit document_cache(std::string directory, binary_format format = binary_format::msgpack);
+
+    // The document in filename, decoded from the cache if present, otherwise
+    // parsed and then stored.
+    nlohmann::json load(const std::string& filename);
+
+    // As load, for JSON text already in memory.
+    nlohmann::json load_text(std::string_view text);
+
+    // Path of the entry for text with the given hash.
+    std::string entry_path(uint64_t hash) const;
+
+    void clear();
+
+    size_t hits() const {
+        return _hits;
+    }
+
+    size_t misses() const {
+        return _misses;
+    }
+
+    // Entries found for a text but written for another; each is also a miss.
+    size_t mismatches() const {
+        return _mismatches;
+    }
+
+private:
+    // Writes the entry header for text, then the encoded document.
+    void store(const std::string& path, std::string_view text, const std::vector<uint8_t>& document);
+
+    std::string _directory;
+    binary_format _format;
+    size_t _hits = 0;
+    size_t _misses = 0;
+    size_t _mismatches = 0;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+
+// Bounded multi-producer, multi-consumer queue after Dmitry Vyukov's: a ring of
+// cells, each with a sequence number that says whose turn it is, so producers
+// and consumers only ever contend on their own index with one CAS per
+// operation. No locks and no allocation after construction.
+//
+// push() and pop() block by backing off (spin, then yield, then short sleeps)
+// while the queue is full or empty, which is the backpressure: a fast producer
+// waits for its consumers instead of growing the queue. After close(), pop()
+// drains what is left and then returns false.
+template <typename T>
+class bounded_queue {
+public:
+    // capacity is rounded up to a power of two.
+    explicit bounded_queue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _cells = std::make_unique<cell[]>(size);
+        _mask = size - 1;
+        for (size_t i = 0; i < size; ++i) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bounded_queue(const bounded_queue&) = delete;
+    bounded_queue& operator=(const bounded_queue&) = delete;
+
+    // value is only moved from if the push succeeds.
+    bool try_push(T&& value) {
+        size_t position = _enqueue.load(std::memory_order_relaxed);
+        for (;;) {
+            cell& c = _cells[position & _mask];
+            size_t sequence = c.sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position);
+            if (difference == 0) {
+                if (_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    c.value = std::move(value);
+                    c.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = _enqueue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& value) {
+        size_t position = _dequeue.load(std::memory_order_relaxed);
+        for (;;) {
+            cell& c = _cells[position & _mask];
+            size_t sequence = c.sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position + 1);
+            if (difference == 0) {
+                if (_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = std::move(c.value);
+                    c.sequence.store(position + _mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = _dequeue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void push(T value) {
+        backoff wait;
+        while (!try_push(std::move(value))) {
+            wait();
+        }
+    }
+
+    // False once the queue is closed and empty.
+    bool pop(T& value) {
+        backoff wait;
+        while (!try_pop(value)) {
+            if (_closed.load(std::memory_order_acquire)) {
+                // Anything pushed before close() is visible now.
+                return try_pop(value);
+            }
+            wait();
+        }
+        return true;
+    }
+
+    // Call once every producer is done pushing.
+    void close() {
+        _closed.store(true, std::memory_order_release);
+    }
+
+private:
+    struct cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    class backoff {
+    public:
+        void operator()() {
+            if (_rounds < 64) {
+                ++_rounds;
+            } else if (_rounds < 128) {
+                ++_rounds;
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+
+    private:
+        unsigned _rounds = 0;
+    };
+
+    std::unique_ptr<cell[]> _cells;
+    size_t _mask = 0;
+    alignas(64) std::atomic<size_t> _enqueue{0};
+    alignas(64) std::atomic<size_t> _dequeue{0};
+    alignas(64) std::atomic<bool> _closed{false};
+};
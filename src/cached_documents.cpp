@@ -0,0 +1,121 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "binary_cache.hpp"
+
+static std::string make_directory() {
+    char name[] = "/tmp/cached_documentsXXXXXX";
+    REQUIRE(mkdtemp(name) != nullptr);
+    return name;
+}
+
+static bool exists(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0;
+}
+
+TEST_CASE("a stored document is decoded on the next load") {
+    std::string directory = make_directory();
+    std::string text = R"({"name": "cache", "sizes": [1, 2.5, -3], "nested": {"ok": true, "none": null}})";
+
+    for (binary_format format : {binary_format::cbor, binary_format::msgpack, binary_format::ubjson,
+            binary_format::bson}) {
+        document_cache cache(directory, format);
+        cache.clear();
+
+        nlohmann::json parsed = cache.load_text(text);
+        CHECK(cache.misses() == 1);
+        CHECK(cache.hits() == 0);
+        CHECK(exists(cache.entry_path(fnv1a_hash(text))));
+
+        nlohmann::json decoded = cache.load_text(text);
+        CHECK(cache.hits() == 1);
+        CHECK(cache.misses() == 1);
+        CHECK(cache.mismatches() == 0);
+        CHECK(decoded == parsed);
+        CHECK(decoded == nlohmann::json::parse(text));
+
+        // A new cache on the same directory finds the entry too.
+        document_cache reopened(directory, format);
+        CHECK(reopened.load_text(text) == parsed);
+        CHECK(reopened.hits() == 1);
+    }
+
+    document_cache(directory).clear();
+    std::remove(directory.c_str());
+}
+
+TEST_CASE("an entry written for another text is replaced, not returned") {
+    std::string directory = make_directory();
+    document_cache cache(directory);
+
+    std::string first = R"({"document": 1})";
+    std::string second = R"({"document": 2, "longer": true})";
+    std::string first_path = cache.entry_path(fnv1a_hash(first));
+    std::string second_path = cache.entry_path(fnv1a_hash(second));
+
+    // Put the entry for second where first's would go, as a collision of the
+    // two hashes would.
+    cache.load_text(second);
+    REQUIRE(std::rename(second_path.c_str(), first_path.c_str()) == 0);
+
+    CHECK(cache.load_text(first) == nlohmann::json::parse(first));
+    CHECK(cache.mismatches() == 1);
+    CHECK(cache.misses() == 2);
+    CHECK(cache.hits() == 0);
+
+    // The entry now belongs to first.
+    CHECK(cache.load_text(first) == nlohmann::json::parse(first));
+    CHECK(cache.hits() == 1);
+    CHECK(cache.mismatches() == 1);
+
+    cache.clear();
+    std::remove(directory.c_str());
+}
+
+TEST_CASE("entries without a matching header are misses") {
+    std::string directory = make_directory();
+    document_cache cache(directory);
+
+    std::string text = R"([1, 2, 3])";
+    std::string path = cache.entry_path(fnv1a_hash(text));
+
+    // An entry from before headers were written: only the encoded document.
+    {
+        std::vector<uint8_t> encoded = to_binary(nlohmann::json::parse(text), binary_format::msgpack);
+        std::ofstream f(path, std::ios::binary);
+        f.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+    }
+    CHECK(cache.load_text(text) == nlohmann::json::parse(text));
+    CHECK(cache.misses() == 1);
+
+    // An entry cut off inside its header.
+    {
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        f.write("JDC1", 4);
+    }
+    CHECK(cache.load_text(text) == nlohmann::json::parse(text));
+    CHECK(cache.misses() == 2);
+
+    // The same text cached in another format.
+    document_cache cbor(directory, binary_format::cbor);
+    std::string cbor_path = cbor.entry_path(fnv1a_hash(text));
+    cbor.load_text(text);
+    REQUIRE(std::rename(cbor_path.c_str(), path.c_str()) == 0);
+    CHECK(cache.load_text(text) == nlohmann::json::parse(text));
+    CHECK(cache.misses() == 3);
+
+    CHECK(cache.load_text(text) == nlohmann::json::parse(text));
+    CHECK(cache.hits() == 1);
+
+    cache.clear();
+    std::remove(directory.c_str());
+}
@@ -0,0 +1,127 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fmt/format.h>
+#include <fstream>
+#include <rapidjson/document.h>
+#include <rapidjson/schema.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "compiled_schema.hpp"
+#include "compiled_schema/limits/wide_object.hpp"
+#include "validating_parse.hpp"
+
+// schema/limits/wide_object.json declares p0 ... p69, all integers, and
+// requires p0 and p63: the first and last ordinals a required bit can have.
+
+static std::string wide_object(int skip, const char* p69 = "69") {
+    std::string json = "{";
+    for (int i = 0; i < 70; ++i) {
+        if (i == skip) {
+            continue;
+        }
+        json += fmt::format("{}\"p{}\": {}", json.size() > 1 ? ", " : "", i, i == 69 ? p69 : std::to_string(i));
+    }
+    return json + "}";
+}
+
+static void require_same_result(const std::string& json) {
+    rapidjson::Document schema_doc;
+    schema_doc.Parse(compiled_limits_wide_object::source);
+    rapidjson::SchemaDocument schema(schema_doc);
+
+    rapidjson::Document expected_doc;
+    validation_result expected = validating_parse(expected_doc, json.c_str(), schema);
+    rapidjson::Document actual_doc;
+    validation_result actual = compiled_validating_parse<compiled_limits_wide_object>(actual_doc, json.c_str());
+    REQUIRE(actual.valid == expected.valid);
+    REQUIRE(actual.schema_pointer == expected.schema_pointer);
+    REQUIRE(actual.keyword == expected.keyword);
+    REQUIRE(actual.document_pointer == expected.document_pointer);
+}
+
+TEST_CASE("properties past the 64th are validated but not tracked as required") {
+    require_same_result(wide_object(-1));
+    require_same_result(wide_object(5));
+    require_same_result(wide_object(64));
+
+    // Seeing p64 must not count as seeing p0, nor anything later as p63.
+    require_same_result(wide_object(0));
+    require_same_result(wide_object(63));
+
+    require_same_result(wide_object(-1, "\"69\""));
+    require_same_result(wide_object(0, "\"69\""));
+
+    rapidjson::Document d;
+    CHECK(compiled_validating_parse<compiled_limits_wide_object>(d, wide_object(64).c_str()).valid);
+    validation_result missing = compiled_validating_parse<compiled_limits_wide_object>(d, wide_object(0).c_str());
+    CHECK(!missing.valid);
+    CHECK(missing.keyword == "required");
+    validation_result mistyped =
+            compiled_validating_parse<compiled_limits_wide_object>(d, wide_object(-1, "\"69\"").c_str());
+    CHECK(!mistyped.valid);
+    CHECK(mistyped.schema_pointer == "#/properties/p69");
+}
+
+// Runs schema_compiler (its path is set by CMake) on the schema text and
+// returns its exit status, or -1 if it did not exit normally (an assertion).
+static int compile_schema(const std::string& schema) {
+    char directory[] = "/tmp/compiled_limitsXXXXXX";
+    REQUIRE(mkdtemp(directory) != nullptr);
+    std::string input = fmt::format("{}/schema.json", directory);
+    std::string output = fmt::format("{}/schema.hpp", directory);
+    std::ofstream(input) << schema;
+
+    int status = std::system(
+            fmt::format("{} {} compiled {} 2>/dev/null", JSON_COMPARISON_SCHEMA_COMPILER, input, output).c_str());
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+    ::rmdir(directory);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// An object schema with n integer properties, requiring the one with the
+// given ordinal.
+static int compile_wide_schema(int n, int required) {
+    std::string schema = R"({"type": "object", "properties": {)";
+    for (int i = 0; i < n; ++i) {
+        schema += fmt::format("{}\"p{}\": {{\"type\": \"integer\"}}", i > 0 ? ", " : "", i);
+    }
+    schema += fmt::format(R"(}}, "required": ["p{}"]}})", required);
+    return compile_schema(schema);
+}
+
+TEST_CASE("schema_compiler rejects required properties past the 64th") {
+    CHECK(compile_wide_schema(65, 0) == 0);
+    CHECK(compile_wide_schema(65, 63) == 0);
+    CHECK(compile_wide_schema(65, 64) == 1);
+    CHECK(compile_wide_schema(100, 99) == 1);
+
+    // A required name that is not a declared property takes the next ordinal.
+    CHECK(compile_wide_schema(63, 63) == 0);
+    CHECK(compile_wide_schema(64, 64) == 1);
+}
+
+TEST_CASE("schema_compiler reports mistyped keywords as errors") {
+    CHECK(compile_schema(R"({"type": ["object", "null"], "properties": {"a": {}}, "required": ["a"]})") == 0);
+
+    for (const char* schema : {
+            R"({"type": ["object", 1]})",
+            R"({"type": 1})",
+            R"({"type": "thing"})",
+            R"({"properties": []})",
+            R"({"properties": {"a": 1}})",
+            R"({"required": "a"})",
+            R"({"required": ["a", 1]})",
+            R"({"items": [{}]})",
+            R"({"minLength": -1})",
+            R"({"properties": {"a": {"required": {}}}})",
+            R"([])"}) {
+        CAPTURE(schema);
+        CHECK(compile_schema(schema) == 1);
+    }
+}
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <rapidjson/pointer.h>
+#include <rapidjson/reader.h>
+#include <string_view>
+#include <type_traits>
+
+#include "profile.hpp"
+#include "validating_parse.hpp"
+
+// Validators for fixed schemas, compiled ahead of time. schema_compiler turns
+// each schema listed in CMakeLists.txt into compiled_schema/<name>.hpp, a
+// stateless struct whose checks are switch statements over the schema's nodes
+// with the keywords' bounds inlined. compiled_validator runs one of them as a
+// RapidJSON Handler and stands in for SchemaValidator: Accept it from a
+// Document, or put it between a Reader and a Document to validate while
+// parsing, and read failures through the same IsValid/GetInvalid* accessors.
+//
+// Nodes are numbered from 0, the root. A generated Schema provides:
+//
+//   source, max_depth      the schema text, and its deepest container nesting
+//   pointer(node)          the node's JSON pointer within the schema
+//   check_null(node) ... check_start_array(node), check_end_array(node, count)
+//                          nullptr, or the keyword the value fails
+//   property(node, key, length)
+//                          ordinal of a property the node declares, or -1
+//   property_node, property_name(node, ordinal), required(node), items(node)
+//
+// A node of -1 is unconstrained: any value is valid there, and containers
+// under it are skipped without tracking.
+
+// a < b, exact between integers of either signedness and in double otherwise,
+// which is how SchemaValidator compares values against minimum and maximum.
+template <typename A, typename B>
+constexpr bool compiled_less(A a, B b) {
+    if constexpr (std::is_floating_point_v<A> || std::is_floating_point_v<B>) {
+        return static_cast<double>(a) < static_cast<double>(b);
+    } else if constexpr (std::is_signed_v<A> == std::is_signed_v<B>) {
+        return a < b;
+    } else if constexpr (std::is_signed_v<A>) {
+        return a < 0 || static_cast<uint64_t>(a) < b;
+    } else {
+        return b >= 0 && a < static_cast<uint64_t>(b);
+    }
+}
+
+// Code points in a UTF-8 string, which is what minLength and maxLength count.
+inline size_t compiled_code_points(const char* str, size_t length) {
+    size_t count = 0;
+    for (size_t i = 0; i < length; ++i) {
+        count += (static_cast<unsigned char>(str[i]) & 0xC0) != 0x80;
+    }
+    return count;
+}
+
+template <typename Schema, typename OutputHandler = rapidjson::BaseReaderHandler<>>
+class compiled_validator {
+public:
+    compiled_validator() = default;
+
+    // Forwards every event that passes validation to output, as
+    // GenericSchemaValidator does with its output handler.
+    explicit compiled_validator(OutputHandler& output)
+            :_output(&output) { }
+
+    bool IsValid() const {
+        return _keyword == nullptr;
+    }
+
+    rapidjson::Pointer GetInvalidSchemaPointer() const {
+        return IsValid() ? rapidjson::Pointer() : rapidjson::Pointer(Schema::pointer(_invalid_node));
+    }
+
+    const char* GetInvalidSchemaKeyword() const {
+        return IsValid() ? "" : _keyword;
+    }
+
+    rapidjson::Pointer GetInvalidDocumentPointer() const {
+        return _invalid_document;
+    }
+
+    void Reset() {
+        _depth = 0;
+        _skip = 0;
+        _keyword = nullptr;
+        _invalid_node = -1;
+        _invalid_document = rapidjson::Pointer();
+    }
+
+    bool Null() {
+        return scalar([](int node) { return Schema::check_null(node); }) && (!_output || _output->Null());
+    }
+
+    bool Bool(bool b) {
+        return scalar([](int node) { return Schema::check_bool(node); }) && (!_output || _output->Bool(b));
+    }
+
+    bool Int(int i) {
+        return scalar([&](int node) { return Schema::check_int64(node, i); }) && (!_output || _output->Int(i));
+    }
+
+    bool Uint(unsigned u) {
+        return scalar([&](int node) { return Schema::check_uint64(node, u); }) && (!_output || _output->Uint(u));
+    }
+
+    bool Int64(int64_t i) {
+        return scalar([&](int node) { return Schema::check_int64(node, i); }) && (!_output || _output->Int64(i));
+    }
+
+    bool Uint64(uint64_t u) {
+        return scalar([&](int node) { return Schema::check_uint64(node, u); }) && (!_output || _output->Uint64(u));
+    }
+
+    bool Double(double d) {
+        return scalar([&](int node) { return Schema::check_double(node, d); }) && (!_output || _output->Double(d));
+    }
+
+    // Checked as a string, as SchemaValidator does.
+    bool RawNumber(const char* str, rapidjson::SizeType length, bool copy) {
+        return scalar([&](int node) { return Schema::check_string(node, str, length); })
+                && (!_output || _output->RawNumber(str, length, copy));
+    }
+
+    bool String(const char* str, rapidjson::SizeType length, bool copy) {
+        return scalar([&](int node) { return Schema::check_string(node, str, length); })
+                && (!_output || _output->String(str, length, copy));
+    }
+
+    bool StartObject() {
+        return start(false, [](int node) { return Schema::check_start_object(node); })
+                && (!_output || _output->StartObject());
+    }
+
+    bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+        if (_skip == 0) {
+            frame& top = _frames[_depth - 1];
+            top.property = Schema::property(top.node, str, length);
+            // schema_compiler only allows the first 64 ordinals to be
+            // required, so later properties are not tracked.
+            if (top.property >= 0 && top.property < 64) {
+                top.seen |= uint64_t(1) << top.property;
+            }
+        }
+        return !_output || _output->Key(str, length, copy);
+    }
+
+    bool EndObject(rapidjson::SizeType count) {
+        if (_skip != 0) {
+            --_skip;
+        } else {
+            const frame& top = _frames[_depth - 1];
+            uint64_t required = Schema::required(top.node);
+            if ((top.seen & required) != required) {
+                return fail(top.node, "required", _depth - 1);
+            }
+            --_depth;
+        }
+        return !_output || _output->EndObject(count);
+    }
+
+    bool StartArray() {
+        return start(true, [](int node) { return Schema::check_start_array(node); })
+                && (!_output || _output->StartArray());
+    }
+
+    bool EndArray(rapidjson::SizeType count) {
+        if (_skip != 0) {
+            --_skip;
+        } else {
+            const frame& top = _frames[_depth - 1];
+            if (const char* keyword = Schema::check_end_array(top.node, top.count)) {
+                return fail(top.node, keyword, _depth - 1);
+            }
+            --_depth;
+        }
+        return !_output || _output->EndArray(count);
+    }
+
+private:
+    // One per open container under a constrained node. Each holds the token of
+    // the child being read: the last key's ordinal, or the element count.
+    struct frame {
+        int node;
+        bool array;
+        int property;
+        uint32_t count;
+        uint64_t seen;
+    };
+
+    // The node the next value must match.
+    int enter() {
+        if (_depth == 0) {
+            return 0;
+        }
+        frame& top = _frames[_depth - 1];
+        if (top.array) {
+            ++top.count;
+            return Schema::items(top.node);
+        }
+        return top.property < 0 ? -1 : Schema::property_node(top.node, top.property);
+    }
+
+    template <typename Check>
+    bool scalar(Check&& check) {
+        if (_skip != 0) {
+            return true;
+        }
+        int node = enter();
+        if (node >= 0) {
+            if (const char* keyword = check(node)) {
+                return fail(node, keyword, _depth);
+            }
+        }
+        return true;
+    }
+
+    template <typename Check>
+    bool start(bool array, Check&& check) {
+        if (_skip != 0) {
+            ++_skip;
+            return true;
+        }
+        int node = enter();
+        if (node < 0) {
+            ++_skip;
+            return true;
+        }
+        if (const char* keyword = check(node)) {
+            return fail(node, keyword, _depth);
+        }
+        _frames[_depth++] = frame{node, array, -1, 0, 0};
+        return true;
+    }
+
+    // Records the failure of node at the location named by the first depth
+    // frames. Only runs once per validation, so it may allocate.
+    bool fail(int node, const char* keyword, int depth) {
+        _invalid_node = node;
+        _keyword = keyword;
+        rapidjson::Pointer location;
+        for (int i = 0; i < depth; ++i) {
+            const frame& f = _frames[i];
+            if (f.array) {
+                location = location.Append(static_cast<rapidjson::SizeType>(f.count - 1));
+            } else {
+                std::string_view name = Schema::property_name(f.node, f.property);
+                location = location.Append(name.data(), static_cast<rapidjson::SizeType>(name.size()));
+            }
+        }
+        _invalid_document = location;
+        return false;
+    }
+
+    OutputHandler* _output = nullptr;
+    frame _frames[Schema::max_depth];
+    int _depth = 0;
+    unsigned _skip = 0;
+
+    const char* _keyword = nullptr;
+    int _invalid_node = -1;
+    rapidjson::Pointer _invalid_document;
+};
+
+// validating_parse against a compiled schema: the validator sits between the
+// Reader and the document, so the first violation aborts the parse and the
+// document only receives a value if the whole input was valid.
+template <typename Schema, unsigned parseFlags = rapidjson::kParseDefaultFlags, typename Document,
+        typename InputStream>
+validation_result compiled_validating_parse(Document& document, InputStream& is) {
+    phase_scope tokenize(phase::tokenize);
+    rapidjson::Reader reader;
+    validation_result result;
+    auto generator = [&](Document& handler) {
+        phase_handler<Document> dom(handler, phase::dom_build);
+        compiled_validator<Schema, phase_handler<Document>> validator(dom);
+        phase_handler<decltype(validator)> validate(validator, phase::validate);
+        result = make_validation_result(reader.Parse<parseFlags>(is, validate), validator);
+        return static_cast<bool>(result);
+    };
+    document.Populate(generator);
+    return result;
+}
+
+template <typename Schema, unsigned parseFlags = rapidjson::kParseDefaultFlags, typename Document>
+validation_result compiled_validating_parse(Document& document, const char* json) {
+    rapidjson::StringStream ss(json);
+    return compiled_validating_parse<Schema, parseFlags>(document, ss);
+}
@@ -0,0 +1,372 @@
+#include "data_generator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t flush_threshold = 256 * 1024;
+
+// splitmix64: tiny, fast, and identical everywhere.
+class corpus_rng {
+public:
+    explicit corpus_rng(uint64_t seed)
+            :_state(seed) { }
+
+    uint64_t next() {
+        uint64_t z = (_state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, bound) via the multiply-shift reduction.
+    uint32_t below(uint32_t bound) {
+        return static_cast<uint32_t>(((next() >> 32) * bound) >> 32);
+    }
+
+    double unit() {
+        return static_cast<double>(next() >> 11) * 0x1.0p-53;
+    }
+
+private:
+    uint64_t _state;
+};
+
+class corpus_buffer {
+public:
+    explicit corpus_buffer(const corpus_sink& sink)
+            :_sink(sink) {
+        _buffer.reserve(flush_threshold + 4096);
+    }
+
+    ~corpus_buffer() {
+        flush();
+    }
+
+    void append(std::string_view text) {
+        _buffer.append(text);
+        _written += text.size();
+        if (_buffer.size() >= flush_threshold) {
+            flush();
+        }
+    }
+
+    void append(char c) {
+        append(std::string_view(&c, 1));
+    }
+
+    size_t written() const {
+        return _written;
+    }
+
+    void flush() {
+        if (!_buffer.empty()) {
+            _sink(_buffer);
+            _buffer.clear();
+        }
+    }
+
+private:
+    const corpus_sink& _sink;
+    std::string _buffer;
+    size_t _written = 0;
+};
+
+template <typename T>
+void append_number(corpus_buffer& out, const char* format, T value) {
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), format, value);
+    out.append(std::string_view(buf, static_cast<size_t>(n)));
+}
+
+// Emits "[" element ("," element)* "]" until target_bytes is reached. At least
+// one element is always written.
+template <typename Element>
+void generate_array(corpus_buffer& out, size_t target_bytes, Element&& element) {
+    out.append('[');
+    bool first = true;
+    while (first || out.written() + 1 < target_bytes) {
+        if (!first) {
+            out.append(',');
+        }
+        element();
+        first = false;
+    }
+    out.append(']');
+}
+
+// Literals rather than std::pow, which is not required to be correctly rounded.
+const std::array<double, 41> powers_of_ten = {
+        1e-20, 1e-19, 1e-18, 1e-17, 1e-16, 1e-15, 1e-14, 1e-13, 1e-12, 1e-11, 1e-10, 1e-9, 1e-8, 1e-7,
+        1e-6, 1e-5, 1e-4, 1e-3, 1e-2, 1e-1, 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+};
+
+const std::array<const char*, 48> jeopardy_words = {
+        "HISTORY", "ESPN's", "EVERYBODY", "TALKS", "ABOUT", "IT", "THE", "COMPANY", "LINE", "EPITAPHS", "TRIBUTES",
+        "state", "river", "author", "novel", "capital", "island", "king", "queen", "treaty", "war", "planet",
+        "element", "composer", "opera", "painter", "city", "mountain", "language", "emperor", "inventor", "ocean",
+        "desert", "poet", "symphony", "battle", "film", "actor", "president", "senator", "bird", "flower",
+        "constellation", "recipe", "sport", "team", "country", "law",
+};
+
+const std::array<const char*, 3> jeopardy_rounds = {"Jeopardy!", "Double Jeopardy!", "Final Jeopardy!"};
+
+void append_words(corpus_buffer& out, corpus_rng& rng, uint32_t min_words, uint32_t max_words) {
+    uint32_t count = min_words + rng.below(max_words - min_words + 1);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i != 0) {
+            out.append(' ');
+        }
+        out.append(jeopardy_words[rng.below(jeopardy_words.size())]);
+    }
+}
+
+void generate_jeopardy(corpus_buffer& out, corpus_rng& rng, size_t target_bytes) {
+    generate_array(out, target_bytes, [&] {
+        uint32_t show = 1 + rng.below(7000);
+        out.append(R"({"category": ")");
+        append_words(out, rng, 1, 3);
+        out.append(R"(", "air_date": ")");
+        append_number(out, "%04u", 1984 + rng.below(28));
+        append_number(out, "-%02u", 1 + rng.below(12));
+        append_number(out, "-%02u", 1 + rng.below(28));
+        out.append(R"(", "question": "')");
+        append_words(out, rng, 6, 24);
+        out.append(R"('", "value": )");
+        uint32_t round = rng.below(jeopardy_rounds.size());
+        if (round == 2) {
+            out.append("null");
+        } else {
+            append_number(out, "\"$%u\"", (1 + rng.below(5)) * (round + 1) * 200);
+        }
+        out.append(R"(, "answer": ")");
+        append_words(out, rng, 1, 4);
+        out.append(R"(", "round": ")");
+        out.append(jeopardy_rounds[round]);
+        out.append(R"(", "show_number": ")");
+        append_number(out, "%u", show);
+        out.append("\"}");
+    });
+}
+
+// {"type":"FeatureCollection","features":[...]} with one Polygon per
+// feature, its rings of [lon, lat] pairs at full precision, as in canada.json.
+void generate_features(corpus_buffer& out, corpus_rng& rng, size_t target_bytes) {
+    out.append(R"({"type":"FeatureCollection","features":)");
+    generate_array(out, target_bytes == 0 ? 0 : target_bytes - 1, [&] {
+        out.append(R"({"type":"Feature","properties":{"name":"Canada"},"geometry":{"type":"Polygon","coordinates":[)");
+        uint32_t rings = 1 + rng.below(3);
+        for (uint32_t ring = 0; ring < rings; ++ring) {
+            if (ring != 0) {
+                out.append(',');
+            }
+            out.append('[');
+            uint32_t points = 20 + rng.below(381);
+            for (uint32_t point = 0; point < points; ++point) {
+                if (point != 0) {
+                    out.append(',');
+                }
+                append_number(out, "[%.17g", -141.0 + 89.0 * rng.unit());
+                append_number(out, ",%.17g]", 41.0 + 42.0 * rng.unit());
+            }
+            out.append(']');
+        }
+        out.append("]}}");
+    });
+    out.append('}');
+}
+
+const std::array<const char*, 12> street_names = {
+        "Main", "Oak", "Maple", "Cedar", "Pine", "Elm", "Walnut", "Grand", "Broadway", "Locust", "Troost", "Wornall",
+};
+
+const std::array<const char*, 4> street_suffixes = {"St.", "Ave.", "Blvd.", "Rd."};
+
+const std::array<const char*, 10> cities = {
+        "Kansas City", "Overland Park", "St. Louis", "Springfield", "Lawrence", "Omaha", "Des Moines", "Tulsa",
+        "Wichita", "Columbia",
+};
+
+const std::array<const char*, 8> states = {"MO", "KS", "NE", "IA", "OK", "IL", "AR", "CO"};
+
+void append_address_fields(corpus_buffer& out, corpus_rng& rng) {
+    append_number(out, R"("line_1":"%u )", 1 + rng.below(9999));
+    if (rng.below(4) == 0) {
+        append_number(out, "%c. ", "NSEW"[rng.below(4)]);
+    }
+    out.append(street_names[rng.below(street_names.size())]);
+    out.append(' ');
+    out.append(street_suffixes[rng.below(street_suffixes.size())]);
+    if (rng.below(2) == 0) {
+        append_number(out, R"(","line_2":"#%u",)", 1 + rng.below(999));
+    } else {
+        out.append(R"(","line_2":"",)");
+    }
+    out.append(R"("city":")");
+    out.append(cities[rng.below(cities.size())]);
+    out.append(R"(","state":")");
+    out.append(states[rng.below(states.size())]);
+    append_number(out, R"(","zip":%u)", 10000 + rng.below(90000));
+}
+
+}
+
+const char* corpus_name(corpus kind) {
+    switch (kind) {
+    case corpus::floats: return "floats";
+    case corpus::signed_ints: return "signed_ints";
+    case corpus::unsigned_ints: return "unsigned_ints";
+    case corpus::small_signed_ints: return "small_signed_ints";
+    case corpus::jeopardy: return "jeopardy";
+    case corpus::features: return "features";
+    }
+    throw std::invalid_argument("unknown corpus");
+}
+
+const char* corpus_path(corpus kind) {
+    switch (kind) {
+    case corpus::floats: return "numbers/floats.json";
+    case corpus::signed_ints: return "numbers/signed_ints.json";
+    case corpus::unsigned_ints: return "numbers/unsigned_ints.json";
+    case corpus::small_signed_ints: return "numbers/small_signed_ints.json";
+    case corpus::jeopardy: return "jeopardy/jeopardy.json";
+    case corpus::features: return "geojson/features.json";
+    }
+    throw std::invalid_argument("unknown corpus");
+}
+
+bool parse_corpus_name(std::string_view name, corpus& kind) {
+    for (corpus candidate : {corpus::floats, corpus::signed_ints, corpus::unsigned_ints, corpus::small_signed_ints,
+                             corpus::jeopardy, corpus::features}) {
+        if (name == corpus_name(candidate)) {
+            kind = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void generate_corpus(corpus kind, uint64_t seed, size_t target_bytes, const corpus_sink& sink) {
+    corpus_rng rng(seed ^ (static_cast<uint64_t>(kind) << 56));
+    corpus_buffer out(sink);
+
+    switch (kind) {
+    case corpus::floats:
+        generate_array(out, target_bytes, [&] {
+            // Spread magnitudes over 1e-20..1e20 so both the short and the
+            // long-exponent paths of the number parsers are exercised.
+            double value = (1.0 + 9.0 * rng.unit()) * powers_of_ten[rng.below(powers_of_ten.size())];
+            append_number(out, "%.17g", (rng.next() & 1) ? -value : value);
+        });
+        break;
+    case corpus::signed_ints:
+        generate_array(out, target_bytes, [&] {
+            append_number(out, "%lld", static_cast<long long>(rng.next()));
+        });
+        break;
+    case corpus::unsigned_ints:
+        generate_array(out, target_bytes, [&] {
+            append_number(out, "%llu", static_cast<unsigned long long>(rng.next()));
+        });
+        break;
+    case corpus::small_signed_ints:
+        generate_array(out, target_bytes, [&] {
+            append_number(out, "%d", static_cast<int>(rng.below(65536)) - 32768);
+        });
+        break;
+    case corpus::jeopardy:
+        generate_jeopardy(out, rng, target_bytes);
+        break;
+    case corpus::features:
+        generate_features(out, rng, target_bytes);
+        break;
+    }
+}
+
+std::string generate_corpus(corpus kind, uint64_t seed, size_t target_bytes) {
+    std::string result;
+    result.reserve(target_bytes + 1024);
+    generate_corpus(kind, seed, target_bytes, [&](std::string_view chunk) {
+        result.append(chunk);
+    });
+    return result;
+}
+
+void write_corpus_file(corpus kind, uint64_t seed, size_t target_bytes, const std::string& filename) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("failed to open " + filename + " for writing");
+    }
+
+    generate_corpus(kind, seed, target_bytes, [&](std::string_view chunk) {
+        out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    });
+
+    if (!out.flush()) {
+        throw std::runtime_error("failed to write " + filename);
+    }
+}
+
+const std::string& cached_corpus(corpus kind, size_t target_bytes) {
+    static corpus cached_kind;
+    static size_t cached_size = 0;
+    static std::string cached;
+
+    if (cached_size != target_bytes || cached_kind != kind || cached.empty()) {
+        cached.clear();
+        cached.shrink_to_fit();
+        cached = generate_corpus(kind, default_corpus_seed, target_bytes);
+        cached_kind = kind;
+        cached_size = target_bytes;
+    }
+
+    return cached;
+}
+
+std::vector<std::string> generate_messages(uint64_t seed, size_t count, size_t min_bytes, size_t max_bytes) {
+    corpus_rng rng(seed ^ 0x6d657373616765ULL);
+    unsigned octaves = 0;
+    while ((min_bytes << (octaves + 1)) <= max_bytes) {
+        ++octaves;
+    }
+
+    std::vector<std::string> messages;
+    messages.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        // A uniform octave, then a uniform size within it.
+        size_t low = min_bytes << rng.below(octaves + 1);
+        size_t high = std::min(max_bytes, low * 2);
+        size_t target = low + rng.below(static_cast<uint32_t>(high - low + 1));
+
+        std::string message;
+        corpus_sink sink = [&](std::string_view chunk) {
+            message.append(chunk);
+        };
+        {
+            corpus_buffer out(sink);
+            out.append('{');
+            append_address_fields(out, rng);
+            out.append(R"(,"history":[)");
+            bool first = true;
+            // Each earlier address is about 100 bytes, so this lands within
+            // half of one of the target.
+            while (out.written() + 50 < target) {
+                if (!first) {
+                    out.append(',');
+                }
+                out.append('{');
+                append_address_fields(out, rng);
+                out.append('}');
+                first = false;
+            }
+            out.append("]}");
+        }
+        messages.push_back(std::move(message));
+    }
+    return messages;
+}
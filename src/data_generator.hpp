@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Largest corpus size registered by the size-swept (->Range) benchmarks. The
+// build overrides this from the JSON_COMPARISON_SWEEP_MAX cache variable.
+#ifndef JSON_COMPARISON_SWEEP_MAX
+#define JSON_COMPARISON_SWEEP_MAX (int64_t(1) << 30)
+#endif
+
+enum class corpus {
+    floats,
+    signed_ints,
+    unsigned_ints,
+    small_signed_ints,
+    jeopardy,
+    // A GeoJSON FeatureCollection of polygons, shaped like canada.json.
+    features,
+};
+
+constexpr uint64_t default_corpus_seed = 1;
+
+// Name used for the file on disk, e.g. "floats" -> data/numbers/floats.json.
+const char* corpus_name(corpus kind);
+
+// Path of the corpus relative to the data directory, e.g. "numbers/floats.json".
+const char* corpus_path(corpus kind);
+
+bool parse_corpus_name(std::string_view name, corpus& kind);
+
+// Receives the generated document in chunks of at most a few hundred KB, so
+// corpora far larger than memory can be streamed straight to disk.
+using corpus_sink = std::function<void(std::string_view)>;
+
+// Generates a document of the given kind whose size is target_bytes rounded up
+// to the end of the last element. The output depends only on kind, seed and
+// target_bytes: the random source and all formatting are implemented here
+// rather than with <random> distributions, whose results differ between
+// standard libraries.
+void generate_corpus(corpus kind, uint64_t seed, size_t target_bytes, const corpus_sink& sink);
+
+std::string generate_corpus(corpus kind, uint64_t seed, size_t target_bytes);
+
+void write_corpus_file(corpus kind, uint64_t seed, size_t target_bytes, const std::string& filename);
+
+// Returns the default-seeded corpus of the given size, keeping the most recent
+// one around so the repeated runs google benchmark makes of the same size-swept
+// case only generate it once. Not thread safe.
+const std::string& cached_corpus(corpus kind, size_t target_bytes);
+
+// count standalone request bodies shaped like orm_like's address message: the
+// five address fields, then a "history" array of earlier addresses that pads
+// each message to a size drawn log-uniformly from [min_bytes, max_bytes].
+// Deterministic in the same way as generate_corpus.
+std::vector<std::string> generate_messages(uint64_t seed, size_t count, size_t min_bytes, size_t max_bytes);
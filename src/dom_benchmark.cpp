@@ -0,0 +1,611 @@
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/pointer.h>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "member_index.hpp"
+
+// Working with a parsed DOM rather than building one: the whole tree visited,
+// the elements along a path iterated, members looked up by key and values
+// resolved by JSON Pointer. Only the DOM work is timed; every corpus is parsed
+// once up front.
+
+using json = nlohmann::json;
+
+// Objects with at least this many members are "wide": the threshold at which
+// member_index builds a table, and the objects sampled by the wide lookups.
+static const size_t wide_members = 32;
+
+// Lookups and pointers drawn from each corpus.
+static const size_t sample_size = 4096;
+
+static std::string ReadString(const char* filename)
+{
+    std::ifstream f(filename);
+    return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+// A member name to look up, and the JSON Pointer of the object that has it.
+struct KeySample
+{
+    std::string object;
+    std::string key;
+};
+
+// Both DOMs of one corpus, and what is looked up in them. The samples are
+// drawn uniformly, with a fixed seed, from every value (pointers), every member
+// (keys) and every member of a wide object (wide_keys).
+struct Corpus
+{
+    std::string filename;
+    size_t bytes = 0;
+    rapidjson::Document rapid;
+    json nlohmann;
+    std::vector<std::string> pointers;
+    std::vector<KeySample> keys;
+    std::vector<KeySample> wide_keys;
+};
+
+// Keeps a uniform sample of at most sample_size of the items offered. Take()
+// shuffles it: until sample_size is exceeded the items are in document order,
+// and a lookup loop walking one object's members in order would favour the
+// linear scan's cache behaviour.
+template <typename T>
+class Reservoir
+{
+public:
+    explicit Reservoir(uint64_t seed)
+            :_rng(seed) { }
+
+    void Offer(const T& item)
+    {
+        ++_seen;
+        if (_items.size() < sample_size)
+        {
+            _items.push_back(item);
+        }
+        else
+        {
+            uint64_t slot = _rng() % _seen;
+            if (slot < sample_size)
+            {
+                _items[slot] = item;
+            }
+        }
+    }
+
+    std::vector<T> Take()
+    {
+        // Fisher-Yates with the same generator, rather than std::shuffle, whose
+        // order differs between standard libraries.
+        for (size_t i = _items.size(); i > 1; --i)
+        {
+            std::swap(_items[i - 1], _items[_rng() % i]);
+        }
+        return std::move(_items);
+    }
+
+private:
+    std::mt19937_64 _rng;
+    uint64_t _seen = 0;
+    std::vector<T> _items;
+};
+
+// Appends one RFC 6901 reference token.
+static void AppendToken(std::string& pointer, const char* name, size_t length)
+{
+    pointer += '/';
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (name[i] == '~')
+        {
+            pointer += "~0";
+        }
+        else if (name[i] == '/')
+        {
+            pointer += "~1";
+        }
+        else
+        {
+            pointer += name[i];
+        }
+    }
+}
+
+struct Samplers
+{
+    Reservoir<std::string> pointers{1};
+    Reservoir<KeySample> keys{2};
+    Reservoir<KeySample> wide_keys{3};
+};
+
+static void Sample(const rapidjson::Value& v, std::string& pointer, Samplers& samplers)
+{
+    samplers.pointers.Offer(pointer);
+
+    size_t length = pointer.size();
+    if (v.IsObject())
+    {
+        bool wide = v.MemberCount() >= wide_members;
+        for (const auto& member : v.GetObject())
+        {
+            KeySample key{pointer, std::string(member.name.GetString(), member.name.GetStringLength())};
+            samplers.keys.Offer(key);
+            if (wide)
+            {
+                samplers.wide_keys.Offer(key);
+            }
+
+            AppendToken(pointer, member.name.GetString(), member.name.GetStringLength());
+            Sample(member.value, pointer, samplers);
+            pointer.resize(length);
+        }
+    }
+    else if (v.IsArray())
+    {
+        for (rapidjson::SizeType i = 0; i < v.Size(); ++i)
+        {
+            pointer += '/';
+            pointer += std::to_string(i);
+            Sample(v[i], pointer, samplers);
+            pointer.resize(length);
+        }
+    }
+}
+
+// One corpus at a time: the benchmarks are registered corpus by corpus.
+static Corpus& LoadCorpus(const char* filename)
+{
+    static std::unique_ptr<Corpus> cached;
+
+    if (!cached || cached->filename != filename)
+    {
+        cached.reset();
+        auto corpus = std::make_unique<Corpus>();
+        corpus->filename = filename;
+
+        std::string str = ReadString(filename);
+        corpus->bytes = str.size();
+        corpus->rapid.Parse(str.data(), str.size());
+        corpus->nlohmann = json::parse(str);
+
+        Samplers samplers;
+        std::string pointer;
+        Sample(corpus->rapid, pointer, samplers);
+        corpus->pointers = samplers.pointers.Take();
+        corpus->keys = samplers.keys.Take();
+        corpus->wide_keys = samplers.wide_keys.Take();
+
+        cached = std::move(corpus);
+    }
+    return *cached;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// full traversal: every value of the document
+//////////////////////////////////////////////////////////////////////////////
+
+struct TraverseTotals
+{
+    size_t values = 0;
+    size_t string_bytes = 0;
+    double numbers = 0;
+};
+
+static void Traverse(const rapidjson::Value& v, TraverseTotals& totals)
+{
+    ++totals.values;
+    switch (v.GetType())
+    {
+    case rapidjson::kObjectType:
+        for (const auto& member : v.GetObject())
+        {
+            totals.string_bytes += member.name.GetStringLength();
+            Traverse(member.value, totals);
+        }
+        break;
+    case rapidjson::kArrayType:
+        for (const auto& element : v.GetArray())
+        {
+            Traverse(element, totals);
+        }
+        break;
+    case rapidjson::kStringType:
+        totals.string_bytes += v.GetStringLength();
+        break;
+    case rapidjson::kNumberType:
+        totals.numbers += v.GetDouble();
+        break;
+    default:
+        break;
+    }
+}
+
+static void Traverse(const json& j, TraverseTotals& totals)
+{
+    ++totals.values;
+    switch (j.type())
+    {
+    case json::value_t::object:
+        for (auto it = j.begin(); it != j.end(); ++it)
+        {
+            totals.string_bytes += it.key().size();
+            Traverse(it.value(), totals);
+        }
+        break;
+    case json::value_t::array:
+        for (const auto& element : j)
+        {
+            Traverse(element, totals);
+        }
+        break;
+    case json::value_t::string:
+        totals.string_bytes += j.get_ref<const std::string&>().size();
+        break;
+    case json::value_t::number_integer:
+    case json::value_t::number_unsigned:
+    case json::value_t::number_float:
+        totals.numbers += j.get<double>();
+        break;
+    default:
+        break;
+    }
+}
+
+// bytes_per_second is of the source text; items_per_second is values visited.
+template <typename Dom>
+static void TraverseDom(benchmark::State& state, const Dom& dom, size_t bytes)
+{
+    size_t values = 0;
+    while (state.KeepRunning())
+    {
+        TraverseTotals totals;
+        Traverse(dom, totals);
+        benchmark::DoNotOptimize(totals);
+        values += totals.values;
+    }
+
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.SetItemsProcessed(static_cast<int64_t>(values));
+}
+
+static void TraverseRapid(benchmark::State& state, const char* filename)
+{
+    Corpus& corpus = LoadCorpus(filename);
+    const rapidjson::Value& root = corpus.rapid;
+    TraverseDom(state, root, corpus.bytes);
+}
+
+static void TraverseNlohmann(benchmark::State& state, const char* filename)
+{
+    Corpus& corpus = LoadCorpus(filename);
+    TraverseDom(state, corpus.nlohmann, corpus.bytes);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// deep iteration: every value matching a path with "*" steps
+//////////////////////////////////////////////////////////////////////////////
+
+// "/features/*/geometry/coordinates" -> {"features", "*", "geometry", "coordinates"}.
+static std::vector<std::string> PathSteps(const char* path)
+{
+    std::vector<std::string> steps;
+    std::string p(path);
+    size_t start = 1;
+    while (start <= p.size())
+    {
+        size_t end = p.find('/', start);
+        if (end == std::string::npos)
+        {
+            end = p.size();
+        }
+        steps.push_back(p.substr(start, end - start));
+        start = end + 1;
+    }
+    return steps;
+}
+
+// Named steps are member lookups; "*" steps iterate every element or member
+// value. Returns the number of values the path matches.
+static size_t Iterate(const rapidjson::Value& v, const std::vector<std::string>& steps, size_t step)
+{
+    if (step == steps.size())
+    {
+        benchmark::DoNotOptimize(&v);
+        return 1;
+    }
+
+    size_t matched = 0;
+    if (steps[step] == "*")
+    {
+        if (v.IsArray())
+        {
+            for (const auto& element : v.GetArray())
+            {
+                matched += Iterate(element, steps, step + 1);
+            }
+        }
+        else if (v.IsObject())
+        {
+            for (const auto& member : v.GetObject())
+            {
+                matched += Iterate(member.value, steps, step + 1);
+            }
+        }
+    }
+    else if (v.IsObject())
+    {
+        auto member = v.FindMember(steps[step].c_str());
+        if (member != v.MemberEnd())
+        {
+            matched += Iterate(member->value, steps, step + 1);
+        }
+    }
+    return matched;
+}
+
+static size_t Iterate(const json& j, const std::vector<std::string>& steps, size_t step)
+{
+    if (step == steps.size())
+    {
+        benchmark::DoNotOptimize(&j);
+        return 1;
+    }
+
+    size_t matched = 0;
+    if (steps[step] == "*")
+    {
+        if (j.is_array() || j.is_object())
+        {
+            for (const auto& element : j)
+            {
+                matched += Iterate(element, steps, step + 1);
+            }
+        }
+    }
+    else if (j.is_object())
+    {
+        auto member = j.find(steps[step]);
+        if (member != j.end())
+        {
+            matched += Iterate(*member, steps, step + 1);
+        }
+    }
+    return matched;
+}
+
+// items_per_second is values matched.
+template <typename Dom>
+static void IterateDom(benchmark::State& state, const Dom& dom, const char* path)
+{
+    std::vector<std::string> steps = PathSteps(path);
+    size_t matched = 0;
+    while (state.KeepRunning())
+    {
+        matched += Iterate(dom, steps, 0);
+    }
+
+    if (matched == 0)
+    {
+        state.SkipWithError("path matches nothing");
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(matched));
+}
+
+static void IterateRapid(benchmark::State& state, const char* filename, const char* path)
+{
+    const rapidjson::Value& root = LoadCorpus(filename).rapid;
+    IterateDom(state, root, path);
+}
+
+static void IterateNlohmann(benchmark::State& state, const char* filename, const char* path)
+{
+    IterateDom(state, LoadCorpus(filename).nlohmann, path);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// key lookup: sampled members, looked up in their objects in random order
+//////////////////////////////////////////////////////////////////////////////
+
+enum class Keys { any, wide };
+
+static const std::vector<KeySample>& SampledKeys(const Corpus& corpus, Keys keys)
+{
+    return keys == Keys::wide ? corpus.wide_keys : corpus.keys;
+}
+
+// The objects are resolved beforehand; only the lookups are timed, and
+// items_per_second is lookups per second.
+static void LookupRapid(benchmark::State& state, const char* filename, Keys keys)
+{
+    Corpus& corpus = LoadCorpus(filename);
+    std::vector<std::pair<const rapidjson::Value*, const char*>> lookups;
+    for (const KeySample& sample : SampledKeys(corpus, keys))
+    {
+        lookups.emplace_back(rapidjson::Pointer(sample.object.c_str()).Get(corpus.rapid), sample.key.c_str());
+    }
+
+    size_t found = 0;
+    while (state.KeepRunning())
+    {
+        for (const auto& lookup : lookups)
+        {
+            found += lookup.first->FindMember(lookup.second) != lookup.first->MemberEnd() ? 1 : 0;
+        }
+    }
+
+    if (found != static_cast<size_t>(state.iterations()) * lookups.size())
+    {
+        state.SkipWithError("sampled key not found");
+    }
+    state.SetItemsProcessed(state.iterations() * lookups.size());
+}
+
+// Through a member_index that lives as long as the document, so its tables are
+// built during the first iteration and reused by the rest.
+static void LookupRapidIndexed(benchmark::State& state, const char* filename, Keys keys)
+{
+    Corpus& corpus = LoadCorpus(filename);
+    std::vector<std::pair<const rapidjson::Value*, std::string_view>> lookups;
+    for (const KeySample& sample : SampledKeys(corpus, keys))
+    {
+        lookups.emplace_back(rapidjson::Pointer(sample.object.c_str()).Get(corpus.rapid), sample.key);
+    }
+
+    member_index<> index(wide_members);
+    size_t found = 0;
+    while (state.KeepRunning())
+    {
+        for (const auto& lookup : lookups)
+        {
+            found += index.find(*lookup.first, lookup.second) != lookup.first->MemberEnd() ? 1 : 0;
+        }
+    }
+
+    if (found != static_cast<size_t>(state.iterations()) * lookups.size())
+    {
+        state.SkipWithError("sampled key not found");
+    }
+    state.SetItemsProcessed(state.iterations() * lookups.size());
+    state.counters["indexed_objects"] = benchmark::Counter(static_cast<double>(index.indexed()));
+}
+
+static void LookupNlohmann(benchmark::State& state, const char* filename, Keys keys)
+{
+    Corpus& corpus = LoadCorpus(filename);
+    std::vector<std::pair<const json*, const std::string*>> lookups;
+    for (const KeySample& sample : SampledKeys(corpus, keys))
+    {
+        const json& object = corpus.nlohmann.at(json::json_pointer(sample.object));
+        lookups.emplace_back(&object, &sample.key);
+    }
+
+    size_t found = 0;
+    while (state.KeepRunning())
+    {
+        for (const auto& lookup : lookups)
+        {
+            found += lookup.first->find(*lookup.second) != lookup.first->end() ? 1 : 0;
+        }
+    }
+
+    if (found != static_cast<size_t>(state.iterations()) * lookups.size())
+    {
+        state.SkipWithError("sampled key not found");
+    }
+    state.SetItemsProcessed(state.iterations() * lookups.size());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// JSON Pointer: sampled values, resolved from the root
+//////////////////////////////////////////////////////////////////////////////
+
+// Pointers are parsed beforehand; items_per_second is pointers resolved.
+static void PointerRapid(benchmark::State& state, const char* filename)
+{
+    Corpus& corpus = LoadCorpus(filename);
+    std::vector<rapidjson::Pointer> pointers;
+    for (const std::string& pointer : corpus.pointers)
+    {
+        pointers.emplace_back(pointer.c_str());
+    }
+
+    size_t found = 0;
+    while (state.KeepRunning())
+    {
+        for (const auto& pointer : pointers)
+        {
+            found += pointer.Get(corpus.rapid) != nullptr ? 1 : 0;
+        }
+    }
+
+    if (found != static_cast<size_t>(state.iterations()) * pointers.size())
+    {
+        state.SkipWithError("sampled pointer not found");
+    }
+    state.SetItemsProcessed(state.iterations() * pointers.size());
+}
+
+static void PointerRapidIndexed(benchmark::State& state, const char* filename)
+{
+    Corpus& corpus = LoadCorpus(filename);
+    std::vector<rapidjson::Pointer> pointers;
+    for (const std::string& pointer : corpus.pointers)
+    {
+        pointers.emplace_back(pointer.c_str());
+    }
+
+    member_index<> index(wide_members);
+    size_t found = 0;
+    while (state.KeepRunning())
+    {
+        for (const auto& pointer : pointers)
+        {
+            found += index.get(corpus.rapid, pointer) != nullptr ? 1 : 0;
+        }
+    }
+
+    if (found != static_cast<size_t>(state.iterations()) * pointers.size())
+    {
+        state.SkipWithError("sampled pointer not found");
+    }
+    state.SetItemsProcessed(state.iterations() * pointers.size());
+    state.counters["indexed_objects"] = benchmark::Counter(static_cast<double>(index.indexed()));
+}
+
+static void PointerNlohmann(benchmark::State& state, const char* filename)
+{
+    Corpus& corpus = LoadCorpus(filename);
+    std::vector<json::json_pointer> pointers;
+    for (const std::string& pointer : corpus.pointers)
+    {
+        pointers.emplace_back(pointer);
+    }
+
+    // at() throws for a pointer that resolves to nothing.
+    while (state.KeepRunning())
+    {
+        for (const auto& pointer : pointers)
+        {
+            benchmark::DoNotOptimize(&corpus.nlohmann.at(pointer));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * pointers.size());
+}
+
+#define DOM_CAPTURES(name, filename, path) \
+    BENCHMARK_CAPTURE(TraverseRapid,        name, filename); \
+    BENCHMARK_CAPTURE(TraverseNlohmann,     name, filename); \
+    BENCHMARK_CAPTURE(IterateRapid,         name, filename, path); \
+    BENCHMARK_CAPTURE(IterateNlohmann,      name, filename, path); \
+    BENCHMARK_CAPTURE(LookupRapid,          name, filename, Keys::any); \
+    BENCHMARK_CAPTURE(LookupRapidIndexed,   name, filename, Keys::any); \
+    BENCHMARK_CAPTURE(LookupNlohmann,       name, filename, Keys::any); \
+    BENCHMARK_CAPTURE(PointerRapid,         name, filename); \
+    BENCHMARK_CAPTURE(PointerRapidIndexed,  name, filename); \
+    BENCHMARK_CAPTURE(PointerNlohmann,      name, filename)
+
+// Only for corpora with objects of at least wide_members members.
+#define WIDE_LOOKUP_CAPTURES(name, filename) \
+    BENCHMARK_CAPTURE(LookupRapid,          name##_wide, filename, Keys::wide); \
+    BENCHMARK_CAPTURE(LookupRapidIndexed,   name##_wide, filename, Keys::wide); \
+    BENCHMARK_CAPTURE(LookupNlohmann,       name##_wide, filename, Keys::wide)
+
+DOM_CAPTURES(canada,        "../data/nativejson-benchmark/canada.json",       "/features/*/geometry/coordinates/*/*");
+DOM_CAPTURES(citm_catalog,  "../data/nativejson-benchmark/citm_catalog.json", "/performances/*/seatCategories/*/areas/*");
+WIDE_LOOKUP_CAPTURES(citm_catalog, "../data/nativejson-benchmark/citm_catalog.json");
+DOM_CAPTURES(twitter,       "../data/nativejson-benchmark/twitter.json",      "/statuses/*/user/*");
+WIDE_LOOKUP_CAPTURES(twitter, "../data/nativejson-benchmark/twitter.json");
+DOM_CAPTURES(jeopardy,      "../data/jeopardy/jeopardy.json",                 "/*/*");
+DOM_CAPTURES(features,      "../data/geojson/features.json",                  "/features/*/geometry/coordinates/*/*");
+
+BENCHMARK_MAIN();
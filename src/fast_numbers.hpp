@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/reader.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "number_parse.hpp"
+#include "profile.hpp"
+
+// number_parse behind the two libraries' DOMs. RapidJSON's Reader still does
+// the tokenizing, and with kParseNumbersAsStringsFlag it checks each number's
+// syntax but hands over the text (RawNumber) instead of converting it; the
+// handler below converts that text and forwards the event the Reader would
+// have sent. nlohmann has no such hook, since its lexer converts numbers
+// itself, so for nlohmann::json the same events are fed to a DOM builder.
+
+// Forwards every event to handler, converting RawNumber into Int, Uint, Int64,
+// Uint64 or Double with the same typing rules as Reader.
+template <typename Handler>
+class fast_number_handler {
+public:
+    explicit fast_number_handler(Handler& handler)
+            :_handler(handler) { }
+
+    bool Null() { return _handler.Null(); }
+    bool Bool(bool b) { return _handler.Bool(b); }
+    bool Int(int i) { return _handler.Int(i); }
+    bool Uint(unsigned u) { return _handler.Uint(u); }
+    bool Int64(int64_t i) { return _handler.Int64(i); }
+    bool Uint64(uint64_t u) { return _handler.Uint64(u); }
+    bool Double(double d) { return _handler.Double(d); }
+
+    bool RawNumber(const char* str, rapidjson::SizeType length, bool) {
+        parsed_number number;
+        {
+            phase_scope parse(phase::number_parse);
+            if (parse_json_number(str, str + length, number) != str + length) {
+                return false;
+            }
+        }
+        switch (number.kind) {
+        case number_kind::int64:
+            return number.i >= INT32_MIN ? _handler.Int(static_cast<int>(number.i)) : _handler.Int64(number.i);
+        case number_kind::uint64:
+            return number.u <= UINT32_MAX ? _handler.Uint(static_cast<unsigned>(number.u)) : _handler.Uint64(number.u);
+        case number_kind::floating:
+            return _handler.Double(number.d);
+        }
+        return false;
+    }
+
+    bool String(const char* str, rapidjson::SizeType length, bool copy) {
+        return _handler.String(str, length, copy);
+    }
+    bool StartObject() { return _handler.StartObject(); }
+    bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+        return _handler.Key(str, length, copy);
+    }
+    bool EndObject(rapidjson::SizeType count) { return _handler.EndObject(count); }
+    bool StartArray() { return _handler.StartArray(); }
+    bool EndArray(rapidjson::SizeType count) { return _handler.EndArray(count); }
+
+private:
+    Handler& _handler;
+};
+
+// Builds an nlohmann::json from RapidJSON Handler events, typed the way
+// json::parse types them: non-negative integers are unsigned, and the last of
+// several members with the same key wins.
+class nlohmann_builder {
+public:
+    explicit nlohmann_builder(nlohmann::json& root)
+            :_root(root) { }
+
+    bool Null() { add(nullptr); return true; }
+    bool Bool(bool b) { add(b); return true; }
+    bool Int(int i) { add(static_cast<int64_t>(i)); return true; }
+    bool Uint(unsigned u) { add(static_cast<uint64_t>(u)); return true; }
+    bool Int64(int64_t i) { add(i); return true; }
+    bool Uint64(uint64_t u) { add(u); return true; }
+    bool Double(double d) { add(d); return true; }
+
+    bool String(const char* str, rapidjson::SizeType length, bool) {
+        add(std::string(str, length));
+        return true;
+    }
+
+    bool StartObject() {
+        _open.push_back(add(nlohmann::json::object()));
+        return true;
+    }
+
+    bool Key(const char* str, rapidjson::SizeType length, bool) {
+        _key.assign(str, length);
+        return true;
+    }
+
+    bool EndObject(rapidjson::SizeType) {
+        _open.pop_back();
+        return true;
+    }
+
+    bool StartArray() {
+        _open.push_back(add(nlohmann::json::array()));
+        return true;
+    }
+
+    bool EndArray(rapidjson::SizeType) {
+        _open.pop_back();
+        return true;
+    }
+
+private:
+    // Containers only grow once their open child is complete, so the pointers
+    // on the stack stay valid.
+    template <typename T>
+    nlohmann::json* add(T&& value) {
+        if (_open.empty()) {
+            _root = std::forward<T>(value);
+            return &_root;
+        }
+        nlohmann::json& parent = *_open.back();
+        if (parent.is_array()) {
+            parent.emplace_back(std::forward<T>(value));
+            return &parent.back();
+        }
+        nlohmann::json& member = parent[_key];
+        member = std::forward<T>(value);
+        return &member;
+    }
+
+    nlohmann::json& _root;
+    std::vector<nlohmann::json*> _open;
+    std::string _key;
+};
+
+// Parses into a RapidJSON document (any GenericDocument) with numbers
+// converted by number_parse. The document is unchanged on error.
+template <unsigned parseFlags = rapidjson::kParseDefaultFlags, typename Document, typename InputStream>
+rapidjson::ParseResult parse_fast_numbers(Document& document, InputStream& is) {
+    phase_scope tokenize(phase::tokenize);
+    rapidjson::Reader reader;
+    rapidjson::ParseResult result;
+    auto generator = [&](Document& handler) {
+        phase_handler<Document> dom(handler, phase::dom_build);
+        fast_number_handler<phase_handler<Document>> numbers(dom);
+        result = reader.Parse<parseFlags | rapidjson::kParseNumbersAsStringsFlag>(is, numbers);
+        return !result.IsError();
+    };
+    document.Populate(generator);
+    return result;
+}
+
+template <unsigned parseFlags = rapidjson::kParseDefaultFlags, typename Document>
+rapidjson::ParseResult parse_fast_numbers(Document& document, const char* json) {
+    rapidjson::StringStream ss(json);
+    return parse_fast_numbers<parseFlags>(document, ss);
+}
+
+// As above, into an nlohmann::json. On error, json holds a partial tree.
+template <unsigned parseFlags = rapidjson::kParseDefaultFlags, typename InputStream>
+rapidjson::ParseResult parse_fast_numbers(nlohmann::json& json, InputStream& is) {
+    phase_scope tokenize(phase::tokenize);
+    rapidjson::Reader reader;
+    nlohmann_builder builder(json);
+    phase_handler<nlohmann_builder> dom(builder, phase::dom_build);
+    fast_number_handler<phase_handler<nlohmann_builder>> numbers(dom);
+    return reader.Parse<parseFlags | rapidjson::kParseNumbersAsStringsFlag>(is, numbers);
+}
+
+template <unsigned parseFlags = rapidjson::kParseDefaultFlags>
+rapidjson::ParseResult parse_fast_numbers(nlohmann::json& json, const char* text) {
+    rapidjson::StringStream ss(text);
+    return parse_fast_numbers<parseFlags>(json, ss);
+}
@@ -0,0 +1,75 @@
+#include "data_generator.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Accepts plain byte counts or K/M/G suffixes (powers of 1024).
+size_t parse_size(const std::string& text) {
+    size_t pos = 0;
+    unsigned long long value = std::stoull(text, &pos);
+    std::string suffix = text.substr(pos);
+    if (suffix == "K" || suffix == "k") {
+        value <<= 10;
+    } else if (suffix == "M" || suffix == "m") {
+        value <<= 20;
+    } else if (suffix == "G" || suffix == "g") {
+        value <<= 30;
+    } else if (!suffix.empty()) {
+        throw std::invalid_argument("invalid size: " + text);
+    }
+    return static_cast<size_t>(value);
+}
+
+int usage() {
+    std::cerr << "usage: generate_data [--seed N] [--size BYTES[K|M|G]] [--out DIR] [corpus...]\n"
+              << "corpora: floats signed_ints unsigned_ints small_signed_ints jeopardy features (default: all)\n";
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    uint64_t seed = default_corpus_seed;
+    size_t size = 16 << 20;
+    fs::path out_dir = "data";
+    std::vector<corpus> kinds;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--seed" && i + 1 < argc) {
+                seed = std::stoull(argv[++i]);
+            } else if (arg == "--size" && i + 1 < argc) {
+                size = parse_size(argv[++i]);
+            } else if (arg == "--out" && i + 1 < argc) {
+                out_dir = argv[++i];
+            } else {
+                corpus kind;
+                if (!parse_corpus_name(arg, kind)) {
+                    return usage();
+                }
+                kinds.push_back(kind);
+            }
+        }
+
+        if (kinds.empty()) {
+            kinds = {corpus::floats, corpus::signed_ints, corpus::unsigned_ints, corpus::small_signed_ints,
+                     corpus::jeopardy, corpus::features};
+        }
+
+        for (corpus kind : kinds) {
+            fs::path filename = out_dir / corpus_path(kind);
+            fs::create_directories(filename.parent_path());
+            write_corpus_file(kind, seed, size, filename.string());
+            std::cout << "generated " << filename.string() << " (" << fs::file_size(filename) << " bytes)\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "generate_data: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
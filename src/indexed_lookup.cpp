@@ -0,0 +1,220 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <fmt/format.h>
+#include <fstream>
+#include <rapidjson/document.h>
+#include <rapidjson/pointer.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "member_index.hpp"
+
+using namespace rapidjson;
+
+static std::string read_corpus(const char* filename) {
+    std::ifstream f(filename);
+    std::string json((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    REQUIRE(!json.empty());
+    return json;
+}
+
+static std::string_view name_of(const Value& name) {
+    return std::string_view(name.GetString(), name.GetStringLength());
+}
+
+// {"k0": 0, "k1": 1, ...} with n members.
+static void parse_object(Document& d, size_t n) {
+    std::string json = "{";
+    for (size_t i = 0; i < n; ++i) {
+        json += fmt::format("{}\"k{}\": {}", i > 0 ? ", " : "", i, i);
+    }
+    d.Parse((json + "}").c_str());
+    REQUIRE(!d.HasParseError());
+}
+
+static void collect_objects(const Value& v, std::vector<const Value*>& objects) {
+    if (v.IsObject()) {
+        objects.push_back(&v);
+        for (const auto& member : v.GetObject()) {
+            collect_objects(member.value, objects);
+        }
+    } else if (v.IsArray()) {
+        for (const auto& element : v.GetArray()) {
+            collect_objects(element, objects);
+        }
+    }
+}
+
+// Every member name of every object, and a name none of them has, looked up
+// build_after + 1 times so each lookup is made both by scan and by table.
+static void require_same_members(member_index<>& index, const Value& root, uint32_t build_after) {
+    std::vector<const Value*> objects;
+    collect_objects(root, objects);
+    for (uint32_t round = 0; round <= build_after; ++round) {
+        for (const Value* object : objects) {
+            for (const auto& member : object->GetObject()) {
+                REQUIRE(index.find(*object, name_of(member.name)) == object->FindMember(member.name));
+            }
+            REQUIRE(index.find(*object, "not a member") == object->MemberEnd());
+            REQUIRE(index.find(*object, "") == object->FindMember(""));
+        }
+    }
+}
+
+TEST_CASE("find matches FindMember on the corpora") {
+    for (const char* filename : {"../data/nativejson-benchmark/citm_catalog.json",
+            "../data/nativejson-benchmark/twitter.json"}) {
+        Document d;
+        d.Parse(read_corpus(filename).c_str());
+        REQUIRE(!d.HasParseError());
+
+        // Both have objects past the default min_members: citm_catalog.json's
+        // "events" has 184 members, and twitter.json's users about 40.
+        member_index<> defaults;
+        require_same_members(defaults, d, 4);
+        CHECK(defaults.indexed() > 0);
+
+        member_index<> every_object(0, 1);
+        require_same_members(every_object, d, 1);
+    }
+}
+
+TEST_CASE("get matches Pointer::Get on the corpora") {
+    Document d;
+    d.Parse(read_corpus("../data/nativejson-benchmark/twitter.json").c_str());
+    REQUIRE(!d.HasParseError());
+
+    member_index<> index(0, 1);
+    for (int round = 0; round < 2; ++round) {
+        for (const char* pointer : {"", "/statuses", "/statuses/0/id", "/statuses/3/user/screen_name",
+                "/statuses/99/text", "/search_metadata/count", "/statuses/7/entities/hashtags",
+                "/statuses/100", "/statuses/4294967296", "/statuses/-", "/statuses/01", "/statuses/x",
+                "/statuses/0/id/0", "/statuses/0/missing", "/missing/0", "/search_metadata/count/x"}) {
+            Pointer p(pointer);
+            REQUIRE(p.IsValid());
+            REQUIRE(index.get(d, p) == p.Get(d));
+        }
+    }
+}
+
+TEST_CASE("get follows array tokens and rejects invalid or out-of-range indices") {
+    Document d;
+    d.Parse(R"({"list": [{"x": 1}, {"x": 2}], "0": "zero", "empty": [], "nested": [[10, 11]]})");
+    member_index<> index(0, 1);
+
+    const Value* second = index.get(d, Pointer("/list/1/x"));
+    REQUIRE(second != nullptr);
+    CHECK(second->GetInt() == 2);
+    CHECK(index.get(d, Pointer("/nested/0/1"))->GetInt() == 11);
+    // A numeric token names a member of an object.
+    CHECK(index.get(d, Pointer("/0"))->GetString() == std::string("zero"));
+
+    for (const char* pointer : {"/list/2", "/list/-", "/list/x", "/list/01", "/empty/0", "/nested/0/2",
+            "/list/1/x/0", "/list/1/y"}) {
+        Pointer p(pointer);
+        CHECK(index.get(d, p) == nullptr);
+        CHECK(p.Get(d) == nullptr);
+    }
+
+    Pointer invalid("list/0");
+    REQUIRE(!invalid.IsValid());
+    CHECK(index.get(d, invalid) == nullptr);
+}
+
+TEST_CASE("the first of repeated names is found, as FindMember finds it") {
+    Document d;
+    d.Parse(R"({"a": 1, "b": 2, "a": 3, "c": 4, "b": 5, "a": 6})");
+    member_index<> index(2, 1);
+
+    for (int round = 0; round < 3; ++round) {
+        CHECK(index.find(d, "a") == d.FindMember("a"));
+        CHECK(index.find(d, "a")->value.GetInt() == 1);
+        CHECK(index.find(d, "b")->value.GetInt() == 2);
+        CHECK(index.find(d, "c")->value.GetInt() == 4);
+    }
+    CHECK(index.indexed() == 1);
+}
+
+TEST_CASE("a table is rebuilt when its object's member count changes") {
+    Document d;
+    parse_object(d, 8);
+    member_index<> index(4, 1);
+
+    CHECK(index.find(d, "k3")->value.GetInt() == 3);
+    REQUIRE(index.indexed() == 1);
+
+    d.AddMember("added", 100, d.GetAllocator());
+    CHECK(index.find(d, "added") == d.FindMember("added"));
+    CHECK(index.find(d, "added")->value.GetInt() == 100);
+
+    // RemoveMember moves the last member into the removed one's place.
+    d.RemoveMember("k2");
+    CHECK(index.find(d, "k2") == d.MemberEnd());
+    for (const auto& member : d.GetObject()) {
+        CHECK(index.find(d, name_of(member.name)) == d.FindMember(member.name));
+    }
+
+    // Dropping below min_members goes back to scanning.
+    while (d.MemberCount() > 3) {
+        d.RemoveMember(d.MemberBegin());
+    }
+    for (const auto& member : d.GetObject()) {
+        CHECK(index.find(d, name_of(member.name)) == d.FindMember(member.name));
+    }
+    CHECK(index.find(d, "k2") == d.MemberEnd());
+}
+
+TEST_CASE("only objects of at least min_members are indexed") {
+    const size_t min_members = 16;
+    Document below;
+    parse_object(below, min_members - 1);
+    Document at;
+    parse_object(at, min_members);
+    Document above;
+    parse_object(above, min_members + 1);
+
+    member_index<> index(min_members, 1);
+    for (int round = 0; round < 10; ++round) {
+        CHECK(index.find(below, "k14")->value.GetInt() == 14);
+        CHECK(index.find(below, "k15") == below.MemberEnd());
+    }
+    CHECK(index.indexed() == 0);
+
+    CHECK(index.find(at, "k15")->value.GetInt() == 15);
+    CHECK(index.indexed() == 1);
+    CHECK(index.find(above, "k16")->value.GetInt() == 16);
+    CHECK(index.find(above, "k17") == above.MemberEnd());
+    CHECK(index.indexed() == 2);
+
+    index.clear();
+    CHECK(index.indexed() == 0);
+}
+
+TEST_CASE("a table is built on the build_after-th lookup") {
+    Document d;
+    parse_object(d, 40);
+    const uint32_t build_after = 4;
+    member_index<> index(32, build_after);
+
+    for (uint32_t lookup = 1; lookup < build_after; ++lookup) {
+        CHECK(index.find(d, fmt::format("k{}", lookup)) == d.FindMember(fmt::format("k{}", lookup).c_str()));
+        CHECK(index.indexed() == 0);
+    }
+    CHECK(index.find(d, "k39")->value.GetInt() == 39);
+    CHECK(index.indexed() == 1);
+
+    for (size_t i = 0; i < 40; ++i) {
+        std::string key = fmt::format("k{}", i);
+        CHECK(index.find(d, key) == d.FindMember(key.c_str()));
+    }
+    CHECK(index.find(d, "k40") == d.MemberEnd());
+
+    // Misses count towards building as well.
+    member_index<> misses(32, build_after);
+    for (uint32_t lookup = 0; lookup < build_after; ++lookup) {
+        CHECK(misses.find(d, "missing") == d.MemberEnd());
+    }
+    CHECK(misses.indexed() == 1);
+}
@@ -0,0 +1,252 @@
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/istreamwrapper.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ingest_pipeline.hpp"
+#include "ndjson.hpp"
+#include "rapid_parse_context.hpp"
+#include "work_stealing_pool.hpp"
+
+// Size of the generated NDJSON buffer and of the chunks handed to the pool.
+static const size_t ndjson_bytes = 64 << 20;
+static const size_t chunk_bytes = 256 << 10;
+
+// 1, 2, 4, ... up to and including the number of hardware threads.
+static void ThreadCounts(benchmark::internal::Benchmark* b)
+{
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads < max_threads; threads *= 2)
+    {
+        b->Arg(threads);
+    }
+    b->Arg(max_threads);
+}
+
+static const std::string& LoadNdjson(const char* filename, const char* pointer)
+{
+    static std::string cached_key;
+    static std::string cached;
+
+    std::string key = std::string(filename) + pointer;
+    if (key != cached_key)
+    {
+        cached = make_ndjson(filename, pointer, ndjson_bytes);
+        cached_key = key;
+    }
+    return cached;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// parse NDJSON on 1..N threads
+//////////////////////////////////////////////////////////////////////////////
+
+// Each worker parses into its own parse_context, so RapidJSON documents never
+// share an allocator between threads.
+static void IngestRapid(benchmark::State& state, const char* filename, const char* pointer)
+{
+    const std::string& ndjson = LoadNdjson(filename, pointer);
+    std::vector<std::string_view> chunks = split_ndjson(ndjson, chunk_bytes);
+    work_stealing_pool pool(static_cast<size_t>(state.range(0)));
+
+    std::vector<std::unique_ptr<parse_context<>>> contexts;
+    for (size_t i = 0; i < pool.size(); ++i)
+    {
+        contexts.push_back(std::make_unique<parse_context<>>());
+    }
+
+    std::atomic<size_t> docs{0};
+    std::atomic<bool> failed{false};
+
+    while (state.KeepRunning())
+    {
+        pool.run(chunks.size(), [&](size_t chunk, size_t worker) {
+            size_t count = 0;
+            for_each_line(chunks[chunk], [&](std::string_view line) {
+                if (contexts[worker]->parse(line).HasParseError())
+                {
+                    failed = true;
+                }
+                ++count;
+            });
+            docs += count;
+        });
+    }
+
+    if (failed)
+    {
+        state.SkipWithError("failed to parse NDJSON line");
+    }
+    state.SetBytesProcessed(state.iterations() * ndjson.size());
+    state.counters["docs"] = benchmark::Counter(static_cast<double>(docs), benchmark::Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(IngestRapid, twitter_statuses,    "../data/nativejson-benchmark/twitter.json",      "/statuses")->Apply(ThreadCounts)->UseRealTime();
+BENCHMARK_CAPTURE(IngestRapid, citm_events,         "../data/nativejson-benchmark/citm_catalog.json", "/events")->Apply(ThreadCounts)->UseRealTime();
+
+// nlohmann::json allocates through std::allocator, so its per-thread
+// allocation behaviour is whatever the system malloc's thread caches give.
+static void IngestNlohmann(benchmark::State& state, const char* filename, const char* pointer)
+{
+    const std::string& ndjson = LoadNdjson(filename, pointer);
+    std::vector<std::string_view> chunks = split_ndjson(ndjson, chunk_bytes);
+    work_stealing_pool pool(static_cast<size_t>(state.range(0)));
+
+    std::atomic<size_t> docs{0};
+
+    while (state.KeepRunning())
+    {
+        pool.run(chunks.size(), [&](size_t chunk, size_t) {
+            size_t count = 0;
+            for_each_line(chunks[chunk], [&](std::string_view line) {
+                nlohmann::json j = nlohmann::json::parse(line.begin(), line.end());
+                benchmark::DoNotOptimize(j);
+                ++count;
+            });
+            docs += count;
+        });
+    }
+
+    state.SetBytesProcessed(state.iterations() * ndjson.size());
+    state.counters["docs"] = benchmark::Counter(static_cast<double>(docs), benchmark::Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(IngestNlohmann, twitter_statuses, "../data/nativejson-benchmark/twitter.json",      "/statuses")->Apply(ThreadCounts)->UseRealTime();
+BENCHMARK_CAPTURE(IngestNlohmann, citm_events,      "../data/nativejson-benchmark/citm_catalog.json", "/events")->Apply(ThreadCounts)->UseRealTime();
+
+//////////////////////////////////////////////////////////////////////////////
+// parse a directory of JSON files, one at a time or pipelined
+//////////////////////////////////////////////////////////////////////////////
+
+// The corpus: every file of the data tree up to max_file_bytes (which leaves
+// out stream_benchmark's multi-gigabyte document), listed over and over until
+// the list adds up to at least directory_bytes. After the first iteration the
+// files are in the page cache, so this measures read() and parsing, not the
+// device.
+static const size_t max_file_bytes = 64 << 20;
+static const size_t directory_bytes = size_t(256) << 20;
+
+static const std::vector<std::string>& DirectoryFiles(size_t& total_bytes)
+{
+    static size_t bytes = 0;
+    static const std::vector<std::string> files = [] {
+        std::vector<std::string> tree = list_json_files("../data", max_file_bytes);
+        std::vector<size_t> sizes;
+        for (const std::string& file : tree)
+        {
+            std::ifstream f(file, std::ios::binary | std::ios::ate);
+            sizes.push_back(static_cast<size_t>(f.tellg()));
+        }
+
+        std::vector<std::string> replicated;
+        while (bytes < directory_bytes && !tree.empty())
+        {
+            for (size_t i = 0; i < tree.size(); ++i)
+            {
+                replicated.push_back(tree[i]);
+                bytes += sizes[i];
+            }
+        }
+        return replicated;
+    }();
+    total_bytes = bytes;
+    return files;
+}
+
+// What rapid_benchmark's ParseFile does, file after file: an ifstream wrapped
+// for RapidJSON and a fresh Document, reading and parsing on one thread.
+static void IngestDirectorySequential(benchmark::State& state)
+{
+    size_t bytes = 0;
+    const std::vector<std::string>& files = DirectoryFiles(bytes);
+    bool failed = false;
+
+    while (state.KeepRunning())
+    {
+        for (const std::string& file : files)
+        {
+            std::ifstream f(file);
+            rapidjson::IStreamWrapper isw(f);
+            rapidjson::Document j;
+            if (j.ParseStream(isw).HasParseError())
+            {
+                failed = true;
+            }
+        }
+    }
+
+    if (failed)
+    {
+        state.SkipWithError("failed to parse file");
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["files"] = benchmark::Counter(static_cast<double>(state.iterations() * files.size()),
+            benchmark::Counter::kIsRate);
+}
+BENCHMARK(IngestDirectorySequential)->UseRealTime();
+
+// Reader threads fill pooled buffers while the workers parse, each into its own
+// parse_context. Args are readers, workers.
+static void IngestDirectoryPipelined(benchmark::State& state)
+{
+    size_t bytes = 0;
+    const std::vector<std::string>& files = DirectoryFiles(bytes);
+
+    ingest_options options;
+    options.readers = static_cast<size_t>(state.range(0));
+    options.workers = static_cast<size_t>(state.range(1));
+    ingest_pipeline pipeline(options);
+
+    std::vector<std::unique_ptr<parse_context<>>> contexts;
+    for (size_t i = 0; i < pipeline.workers(); ++i)
+    {
+        contexts.push_back(std::make_unique<parse_context<>>());
+    }
+
+    ingest_stats total;
+    while (state.KeepRunning())
+    {
+        ingest_stats stats = pipeline.run(files, [&](ingest_buffer& buffer, size_t worker) {
+            return !contexts[worker]->parse(buffer.view()).HasParseError();
+        });
+        total.files += stats.files;
+        total.bytes += stats.bytes;
+        total.read_errors += stats.read_errors;
+        total.rejected += stats.rejected;
+    }
+
+    if (total.read_errors != 0)
+    {
+        state.SkipWithError("failed to read file");
+    }
+    else if (total.rejected != 0)
+    {
+        state.SkipWithError("failed to parse file");
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(total.bytes));
+    state.counters["files"] = benchmark::Counter(static_cast<double>(total.files), benchmark::Counter::kIsRate);
+}
+
+// 1 and 2 readers, each with 1, 2, 4, ... workers up to the hardware threads
+// left over.
+static void ReaderWorkerCounts(benchmark::internal::Benchmark* b)
+{
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int readers = 1; readers <= 2; ++readers)
+    {
+        int max_workers = std::max(1, max_threads - readers);
+        for (int workers = 1; workers < max_workers; workers *= 2)
+        {
+            b->Args({readers, workers});
+        }
+        b->Args({readers, max_workers});
+    }
+}
+BENCHMARK(IngestDirectoryPipelined)->Apply(ReaderWorkerCounts)->UseRealTime();
+
+BENCHMARK_MAIN();
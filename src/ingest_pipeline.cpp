@@ -0,0 +1,166 @@
+#include "ingest_pipeline.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <filesystem>
+#include <thread>
+
+#include "bounded_queue.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Reads a whole file into buffer, growing it if needed. False on any error;
+// the pipeline counts those rather than stopping.
+bool read_into(const std::string& filename, ingest_buffer& buffer, size_t read_size) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+#if defined(POSIX_FADV_SEQUENTIAL)
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    size_t size = static_cast<size_t>(st.st_size);
+    if (buffer.capacity < size + 1) {
+        buffer.data = std::make_unique<char[]>(size + 1);
+        buffer.capacity = size + 1;
+    }
+
+    size_t offset = 0;
+    while (offset < size) {
+        ssize_t n = ::read(fd, buffer.data.get() + offset, std::min(read_size, size - offset));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            ::close(fd);
+            return false;
+        }
+        if (n == 0) {
+            // Truncated since the fstat; take what is there.
+            break;
+        }
+        offset += static_cast<size_t>(n);
+    }
+    ::close(fd);
+
+    buffer.data[offset] = '\0';
+    buffer.size = offset;
+    return true;
+}
+
+}
+
+ingest_pipeline::ingest_pipeline(ingest_options options)
+        :_options(options) {
+    if (_options.readers == 0) {
+        _options.readers = 1;
+    }
+    if (_options.workers == 0) {
+        size_t hardware = std::thread::hardware_concurrency();
+        _options.workers = hardware > _options.readers ? hardware - _options.readers : 1;
+    }
+    if (_options.buffers == 0) {
+        _options.buffers = 2 * _options.workers;
+    }
+    if (_options.read_size == 0) {
+        _options.read_size = 1 << 20;
+    }
+    for (size_t i = 0; i < _options.buffers; ++i) {
+        _pool.push_back(std::make_unique<ingest_buffer>());
+    }
+}
+
+ingest_stats ingest_pipeline::run(const std::vector<std::string>& files, const handler& fn) {
+    // Every buffer can be in the filled queue at once, so pushing to it never
+    // waits; only taking a buffer from the free queue does.
+    bounded_queue<ingest_buffer*> free_buffers(_pool.size());
+    bounded_queue<ingest_buffer*> filled(_pool.size());
+    for (auto& buffer : _pool) {
+        free_buffers.push(buffer.get());
+    }
+
+    std::atomic<size_t> next_file{0};
+    std::atomic<size_t> files_done{0};
+    std::atomic<size_t> bytes{0};
+    std::atomic<size_t> read_errors{0};
+    std::atomic<size_t> rejected{0};
+
+    auto read = [&] {
+        for (;;) {
+            size_t file = next_file.fetch_add(1, std::memory_order_relaxed);
+            if (file >= files.size()) {
+                return;
+            }
+
+            ingest_buffer* buffer = nullptr;
+            free_buffers.pop(buffer);
+            if (!read_into(files[file], *buffer, _options.read_size)) {
+                read_errors.fetch_add(1, std::memory_order_relaxed);
+                free_buffers.push(buffer);
+                continue;
+            }
+            buffer->file = file;
+            filled.push(buffer);
+        }
+    };
+
+    auto work = [&](size_t worker) {
+        ingest_buffer* buffer = nullptr;
+        while (filled.pop(buffer)) {
+            if (!fn(*buffer, worker)) {
+                rejected.fetch_add(1, std::memory_order_relaxed);
+            }
+            files_done.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(buffer->size, std::memory_order_relaxed);
+            free_buffers.push(buffer);
+        }
+    };
+
+    std::vector<std::thread> readers;
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < _options.workers; ++i) {
+        workers.emplace_back(work, i);
+    }
+    for (size_t i = 0; i < _options.readers; ++i) {
+        readers.emplace_back(read);
+    }
+
+    for (auto& thread : readers) {
+        thread.join();
+    }
+    filled.close();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    ingest_stats stats;
+    stats.files = files_done;
+    stats.bytes = bytes;
+    stats.read_errors = read_errors;
+    stats.rejected = rejected;
+    return stats;
+}
+
+std::vector<std::string> list_json_files(const std::string& root, size_t max_file_bytes) {
+    std::vector<std::string> files;
+    for (const auto& entry : fs::recursive_directory_iterator(root)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".json" && entry.file_size() <= max_file_bytes) {
+            files.push_back(entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One whole file, read into a buffer from the pipeline's pool. data holds size
+// bytes followed by a NUL, and is the handler's to modify (parse in situ) until
+// it returns.
+struct ingest_buffer {
+    std::unique_ptr<char[]> data;
+    size_t capacity = 0;
+    size_t size = 0;
+    // Index of the file in the list passed to run().
+    size_t file = 0;
+
+    std::string_view view() const {
+        return std::string_view(data.get(), size);
+    }
+};
+
+struct ingest_options {
+    size_t readers = 1;
+    // 0: one per hardware thread left over after the readers, at least one.
+    size_t workers = 0;
+    // Buffers in the pool, which bounds the files in flight; 0: two per worker.
+    size_t buffers = 0;
+    // Bytes asked for per read() call.
+    size_t read_size = 1 << 20;
+};
+
+struct ingest_stats {
+    size_t files = 0;
+    size_t bytes = 0;
+    size_t read_errors = 0;
+    // Files the handler returned false for.
+    size_t rejected = 0;
+};
+
+// Overlaps reading a set of files with parsing them. Reader threads claim files
+// in order and read each with large sequential read() calls into a buffer taken
+// from a fixed pool; filled buffers go through a bounded_queue to the worker
+// threads, which run the handler and give the buffer back to the pool.
+//
+// The pool is the backpressure: with every buffer filled or being handled, the
+// readers wait for a worker to finish instead of reading ahead. Buffers are
+// kept between runs and only grow, to the size of the largest file plus one.
+class ingest_pipeline {
+public:
+    // Called on a worker thread for every file read; worker is in [0, workers())
+    // and identifies the thread, for per-thread state. Must not throw.
+    using handler = std::function<bool(ingest_buffer& buffer, size_t worker)>;
+
+    explicit ingest_pipeline(ingest_options options = {});
+
+    size_t readers() const {
+        return _options.readers;
+    }
+
+    size_t workers() const {
+        return _options.workers;
+    }
+
+    // Reads and handles every file, returning once all are done. Threads are
+    // started per call. Files that fail to open or read are counted and skipped.
+    ingest_stats run(const std::vector<std::string>& files, const handler& fn);
+
+private:
+    ingest_options _options;
+    std::vector<std::unique_ptr<ingest_buffer>> _pool;
+};
+
+// Every *.json file under root of at most max_file_bytes, sorted.
+std::vector<std::string> list_json_files(const std::string& root, size_t max_file_bytes);
@@ -0,0 +1,244 @@
+#include "json_writer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <unistd.h>
+
+#if !defined(__cpp_lib_to_chars)
+#include <rapidjson/internal/dtoa.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void output_buffer::grow(size_t n) {
+    size_t capacity = std::max(_size + n, _capacity * 2);
+    std::unique_ptr<char[]> data(new char[capacity]);
+    std::memcpy(data.get(), _data.get(), _size);
+    _data = std::move(data);
+    _capacity = capacity;
+}
+
+fd_output::fd_output(int fd, size_t chunk_size, size_t chunks)
+        :_fd(fd), _chunk_size(std::max(chunk_size, max_output_reserve)), _chunks(std::max<size_t>(chunks, 1)),
+         _data(new char[_chunk_size * _chunks]) {
+    _filled.reserve(_chunks);
+    _begin = _data.get();
+    _next = _begin;
+    _end = _begin + _chunk_size;
+}
+
+void fd_output::write(const char* data, size_t length) {
+    for (;;) {
+        size_t n = std::min(length, static_cast<size_t>(_end - _next));
+        std::memcpy(_next, data, n);
+        _next += n;
+        length -= n;
+        if (length == 0) {
+            return;
+        }
+        data += n;
+        next_chunk();
+    }
+}
+
+void fd_output::flush() {
+    if (_next != _begin) {
+        _filled.push_back({_begin, static_cast<size_t>(_next - _begin)});
+    }
+    write_filled();
+}
+
+void fd_output::next_chunk() {
+    if (_next != _begin) {
+        _filled.push_back({_begin, static_cast<size_t>(_next - _begin)});
+    }
+    if (_filled.size() == _chunks) {
+        write_filled();
+        return;
+    }
+    _begin = _data.get() + _filled.size() * _chunk_size;
+    _next = _begin;
+    _end = _begin + _chunk_size;
+}
+
+void fd_output::write_filled() {
+    iovec* iov = _filled.data();
+    size_t count = _filled.size();
+    while (count != 0) {
+        ssize_t written = ::writev(_fd, iov, static_cast<int>(count));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(fmt::format("Failed to write to fd {}: {}", _fd, std::strerror(errno)));
+        }
+        _written += static_cast<uint64_t>(written);
+
+        // Skip what the kernel took; a short write resumes mid-chunk.
+        auto remaining = static_cast<size_t>(written);
+        while (count != 0 && remaining >= iov->iov_len) {
+            remaining -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count != 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + remaining;
+            iov->iov_len -= remaining;
+        }
+    }
+
+    _filled.clear();
+    _begin = _data.get();
+    _next = _begin;
+    _end = _begin + _chunk_size;
+}
+
+namespace {
+
+constexpr char digit_pairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+int digit_count(uint64_t value) {
+    int digits = 1;
+    for (;;) {
+        if (value < 10) {
+            return digits;
+        }
+        if (value < 100) {
+            return digits + 1;
+        }
+        if (value < 1000) {
+            return digits + 2;
+        }
+        if (value < 10000) {
+            return digits + 3;
+        }
+        value /= 10000;
+        digits += 4;
+    }
+}
+
+// Bytes that must be escaped in a JSON string: quote, backslash and controls.
+struct escape_table {
+    bool table[256] = {};
+
+    constexpr escape_table() {
+        for (int c = 0; c < 0x20; ++c) {
+            table[c] = true;
+        }
+        table[static_cast<uint8_t>('"')] = true;
+        table[static_cast<uint8_t>('\\')] = true;
+    }
+};
+
+constexpr escape_table needs_escape;
+
+}
+
+char* format_uint64(char* out, uint64_t value) {
+    char* end = out + digit_count(value);
+    char* p = end;
+    while (value >= 100) {
+        size_t pair = static_cast<size_t>(value % 100) * 2;
+        value /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        size_t pair = static_cast<size_t>(value) * 2;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    } else {
+        *--p = static_cast<char>('0' + value);
+    }
+    return end;
+}
+
+char* format_int64(char* out, int64_t value) {
+    auto magnitude = static_cast<uint64_t>(value);
+    if (value < 0) {
+        *out++ = '-';
+        magnitude = uint64_t(0) - magnitude;
+    }
+    return format_uint64(out, magnitude);
+}
+
+char* format_double(char* out, double value) {
+    if (value != value || value - value != 0) {
+        return nullptr;
+    }
+#if defined(__cpp_lib_to_chars)
+    char* end = std::to_chars(out, out + max_output_reserve, value).ptr;
+    // Keep integral values doubles when read back, as both libraries do.
+    if (std::find_if(out, end, [](char c) { return c == '.' || c == 'e'; }) == end) {
+        *end++ = '.';
+        *end++ = '0';
+    }
+    return end;
+#else
+    return rapidjson::internal::dtoa(value, out);
+#endif
+}
+
+char* format_escape(char* out, char c) {
+    *out++ = '\\';
+    switch (c) {
+    case '"': *out++ = '"'; break;
+    case '\\': *out++ = '\\'; break;
+    case '\b': *out++ = 'b'; break;
+    case '\f': *out++ = 'f'; break;
+    case '\n': *out++ = 'n'; break;
+    case '\r': *out++ = 'r'; break;
+    case '\t': *out++ = 't'; break;
+    default: {
+        static const char hex[] = "0123456789ABCDEF";
+        auto byte = static_cast<uint8_t>(c);
+        *out++ = 'u';
+        *out++ = '0';
+        *out++ = '0';
+        *out++ = hex[byte >> 4];
+        *out++ = hex[byte & 0xf];
+        break;
+    }
+    }
+    return out;
+}
+
+size_t unescaped_prefix(const char* data, size_t length) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        // Unsigned chunk <= 0x1f is max(chunk, 0x1f) == 0x1f.
+        __m128i special = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0) {
+            return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+#endif
+    while (i < length && !needs_escape.table[static_cast<uint8_t>(data[i])]) {
+        ++i;
+    }
+    return i;
+}
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <string_view>
+#include <sys/uio.h>
+#include <vector>
+
+// A JSON serializer that is a RapidJSON Handler, so Document::Accept,
+// tape_document::accept and write_json (for nlohmann::json) all drive it.
+// Compared with the libraries' own writers:
+//
+//   - output goes to a caller-owned buffer that keeps its capacity between
+//     documents (output_buffer), or straight to a file descriptor through a
+//     bounded set of chunks written with one writev (fd_output);
+//   - doubles are the shortest text that parses back to the same value
+//     (std::to_chars, which libstdc++ implements with Ryu; RapidJSON's
+//     Grisu2 where the standard library has no floating point to_chars);
+//   - integers are formatted two digits at a time from a lookup table;
+//   - strings are scanned for bytes that need escaping 16 at a time with SSE2,
+//     and copied in runs.
+//
+// Output matches RapidJSON's Writer (indent < 0) and PrettyWriter (indent >= 0)
+// except that doubles may be shorter. It has the same layout as nlohmann's
+// dump(), but escapes control characters in uppercase hex (\u001F) where
+// dump() uses lowercase.
+
+// Writers never reserve more than this at once.
+constexpr size_t max_output_reserve = 64;
+
+// Growable output in one contiguous block; clear() keeps the capacity.
+class output_buffer {
+public:
+    explicit output_buffer(size_t capacity = 64 * 1024)
+            :_data(new char[capacity]), _capacity(capacity) { }
+
+    // Room for at least n bytes; write them, then commit the end.
+    char* reserve(size_t n) {
+        if (_capacity - _size < n) {
+            grow(n);
+        }
+        return _data.get() + _size;
+    }
+
+    void commit(char* end) {
+        _size = static_cast<size_t>(end - _data.get());
+    }
+
+    void put(char c) {
+        *reserve(1) = c;
+        ++_size;
+    }
+
+    void write(const char* data, size_t length) {
+        std::memcpy(reserve(length), data, length);
+        _size += length;
+    }
+
+    void clear() {
+        _size = 0;
+    }
+
+    std::string_view view() const {
+        return std::string_view(_data.get(), _size);
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    size_t capacity() const {
+        return _capacity;
+    }
+
+private:
+    void grow(size_t n);
+
+    std::unique_ptr<char[]> _data;
+    size_t _size = 0;
+    size_t _capacity;
+};
+
+// Output to a file descriptor through chunks chunk_size bytes each: when the
+// last chunk fills, all of them go to the kernel in a single writev, so any
+// size of document is written with bounded memory and few system calls.
+//
+// flush() writes what is left. The destructor does not, because a failed
+// write throws std::runtime_error.
+class fd_output {
+public:
+    explicit fd_output(int fd, size_t chunk_size = 64 * 1024, size_t chunks = 16);
+
+    fd_output(const fd_output&) = delete;
+    fd_output& operator=(const fd_output&) = delete;
+
+    char* reserve(size_t n) {
+        if (static_cast<size_t>(_end - _next) < n) {
+            next_chunk();
+        }
+        return _next;
+    }
+
+    void commit(char* end) {
+        _next = end;
+    }
+
+    void put(char c) {
+        *reserve(1) = c;
+        ++_next;
+    }
+
+    void write(const char* data, size_t length);
+
+    void flush();
+
+    uint64_t bytes_written() const {
+        return _written;
+    }
+
+private:
+    void next_chunk();
+    void write_filled();
+
+    int _fd;
+    size_t _chunk_size;
+    size_t _chunks;
+    std::unique_ptr<char[]> _data;
+    std::vector<iovec> _filled;
+    char* _begin;
+    char* _next;
+    char* _end;
+    uint64_t _written = 0;
+};
+
+// Formatting primitives; each writes at most max_output_reserve bytes and
+// returns the end of its output.
+char* format_uint64(char* out, uint64_t value);
+char* format_int64(char* out, int64_t value);
+// Returns nullptr for NaN and infinity, which JSON cannot represent.
+char* format_double(char* out, double value);
+char* format_escape(char* out, char c);
+
+// Length of the longest prefix of data that can be written without escaping.
+size_t unescaped_prefix(const char* data, size_t length);
+
+template <typename Output>
+class json_writer {
+public:
+    explicit json_writer(Output& out, int indent = -1)
+            :_out(out), _indent(indent) { }
+
+    // Ready for another document, keeping the nesting stack's capacity.
+    void reset() {
+        _open.clear();
+    }
+
+    bool Null() {
+        prefix();
+        _out.write("null", 4);
+        return true;
+    }
+
+    bool Bool(bool b) {
+        prefix();
+        if (b) {
+            _out.write("true", 4);
+        } else {
+            _out.write("false", 5);
+        }
+        return true;
+    }
+
+    bool Int(int i) {
+        return Int64(i);
+    }
+
+    bool Uint(unsigned u) {
+        return Uint64(u);
+    }
+
+    bool Int64(int64_t i) {
+        prefix();
+        _out.commit(format_int64(_out.reserve(max_output_reserve), i));
+        return true;
+    }
+
+    bool Uint64(uint64_t u) {
+        prefix();
+        _out.commit(format_uint64(_out.reserve(max_output_reserve), u));
+        return true;
+    }
+
+    bool Double(double d) {
+        prefix();
+        char* end = format_double(_out.reserve(max_output_reserve), d);
+        if (end == nullptr) {
+            return false;
+        }
+        _out.commit(end);
+        return true;
+    }
+
+    bool RawNumber(const char* str, unsigned length, bool) {
+        prefix();
+        _out.write(str, length);
+        return true;
+    }
+
+    bool String(const char* str, unsigned length, bool) {
+        prefix();
+        write_string(str, length);
+        return true;
+    }
+
+    bool Key(const char* str, unsigned length, bool) {
+        return String(str, length, true);
+    }
+
+    bool StartObject() {
+        prefix();
+        _out.put('{');
+        _open.push_back({true, 0});
+        return true;
+    }
+
+    bool EndObject(unsigned = 0) {
+        close('}');
+        return true;
+    }
+
+    bool StartArray() {
+        prefix();
+        _out.put('[');
+        _open.push_back({false, 0});
+        return true;
+    }
+
+    bool EndArray(unsigned = 0) {
+        close(']');
+        return true;
+    }
+
+private:
+    struct open_container {
+        bool object;
+        // Values written so far; in an object keys count too.
+        uint32_t count;
+    };
+
+    // Separators and indentation before a value or key.
+    void prefix() {
+        if (_open.empty()) {
+            return;
+        }
+        open_container& open = _open.back();
+        if (open.object && open.count % 2 == 1) {
+            _out.put(':');
+            if (_indent >= 0) {
+                _out.put(' ');
+            }
+        } else {
+            if (open.count != 0) {
+                _out.put(',');
+            }
+            new_line(_open.size());
+        }
+        ++open.count;
+    }
+
+    void close(char bracket) {
+        bool empty = _open.back().count == 0;
+        _open.pop_back();
+        if (!empty) {
+            new_line(_open.size());
+        }
+        _out.put(bracket);
+    }
+
+    void new_line(size_t depth) {
+        if (_indent < 0) {
+            return;
+        }
+        _out.put('\n');
+        for (size_t spaces = depth * static_cast<size_t>(_indent); spaces != 0;) {
+            size_t n = spaces < max_output_reserve ? spaces : max_output_reserve;
+            char* out = _out.reserve(n);
+            std::memset(out, ' ', n);
+            _out.commit(out + n);
+            spaces -= n;
+        }
+    }
+
+    void write_string(const char* str, size_t length) {
+        _out.put('"');
+        const char* end = str + length;
+        while (str != end) {
+            size_t plain = unescaped_prefix(str, static_cast<size_t>(end - str));
+            _out.write(str, plain);
+            str += plain;
+            if (str != end) {
+                _out.commit(format_escape(_out.reserve(max_output_reserve), *str));
+                ++str;
+            }
+        }
+        _out.put('"');
+    }
+
+    Output& _out;
+    int _indent;
+    std::vector<open_container> _open;
+};
+
+// Walks an nlohmann::json into a Handler, in the member order dump() uses.
+template <typename Handler>
+bool write_json(const nlohmann::json& j, Handler& handler) {
+    switch (j.type()) {
+    case nlohmann::json::value_t::null:
+        return handler.Null();
+    case nlohmann::json::value_t::boolean:
+        return handler.Bool(j.get<bool>());
+    case nlohmann::json::value_t::number_integer:
+        return handler.Int64(j.get<int64_t>());
+    case nlohmann::json::value_t::number_unsigned:
+        return handler.Uint64(j.get<uint64_t>());
+    case nlohmann::json::value_t::number_float:
+        return handler.Double(j.get<double>());
+    case nlohmann::json::value_t::string: {
+        const auto& str = j.get_ref<const nlohmann::json::string_t&>();
+        return handler.String(str.data(), static_cast<unsigned>(str.size()), false);
+    }
+    case nlohmann::json::value_t::array:
+        if (!handler.StartArray()) {
+            return false;
+        }
+        for (const nlohmann::json& element : j) {
+            if (!write_json(element, handler)) {
+                return false;
+            }
+        }
+        return handler.EndArray(static_cast<unsigned>(j.size()));
+    case nlohmann::json::value_t::object:
+        if (!handler.StartObject()) {
+            return false;
+        }
+        for (auto member = j.begin(); member != j.end(); ++member) {
+            const std::string& key = member.key();
+            if (!handler.Key(key.data(), static_cast<unsigned>(key.size()), false) ||
+                    !write_json(member.value(), handler)) {
+                return false;
+            }
+        }
+        return handler.EndObject(static_cast<unsigned>(j.size()));
+    default:
+        // value_t::discarded has no JSON form.
+        return false;
+    }
+}
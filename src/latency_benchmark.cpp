@@ -0,0 +1,349 @@
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/schema.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+#include "benchmark_counters.hpp"
+#include "compiled_schema.hpp"
+#include "data_generator.hpp"
+#include "latency_histogram.hpp"
+#include "orm_like.hpp"
+#include "rapid_parse_context.hpp"
+
+// Per-message latency of small request bodies, as opposed to the throughput on
+// large files measured everywhere else. Every iteration takes the next message
+// of a generated corpus of address-shaped bodies (200 B to 4 KB, see
+// generate_messages) through parse -> validate -> typed access -> serialize,
+// timing it on its own. Reported per benchmark:
+//
+//   p50_ns, p99_ns, p999_ns, max_ns   latency percentiles, from a latency_histogram
+//   allocs_per_msg, alloc_bytes_per_msg
+//                                      from one untimed pass over the corpus
+//
+// The cold variants evict the CPU caches before each message, untimed, so the
+// message, the parser's buffers and the code all start out in memory.
+
+using json = nlohmann::json;
+
+using CountedStringBuffer = rapidjson::GenericStringBuffer<rapidjson::UTF8<>, counting_allocator>;
+
+static const std::vector<std::string>& Messages()
+{
+    static const std::vector<std::string> messages = generate_messages(default_corpus_seed, 4096, 200, 4096);
+    return messages;
+}
+
+enum class CpuCache { warm, cold };
+
+// Touches every cache line of a buffer twice the size of the last level cache.
+static void EvictCpuCaches()
+{
+    static std::vector<char> buffer = [] {
+        long llc = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+        llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+        return std::vector<char>(llc > 0 ? static_cast<size_t>(llc) * 2 : size_t(64) << 20);
+    }();
+
+    for (size_t i = 0; i < buffer.size(); i += 64)
+    {
+        buffer[i] += 1;
+    }
+    benchmark::ClobberMemory();
+}
+
+// What the handler reads out of each message.
+struct AddressFields
+{
+    std::string_view line_1;
+    std::string_view line_2;
+    std::string_view city;
+    std::string_view state;
+    uint32_t zip = 0;
+
+    size_t Checksum() const
+    {
+        return line_1.size() + line_2.size() + city.size() + state.size() + zip;
+    }
+};
+
+template <typename Value>
+static std::string_view RapidString(const Value& object, const char* name)
+{
+    const auto& value = object[name];
+    return std::string_view(value.GetString(), value.GetStringLength());
+}
+
+template <typename Value>
+static AddressFields ReadRapid(const Value& j)
+{
+    return {RapidString(j, "line_1"), RapidString(j, "line_2"), RapidString(j, "city"), RapidString(j, "state"),
+            j["zip"].GetUint()};
+}
+
+// nlohmann has no schema validation of its own, so its DOM is replayed into a
+// compiled validator as RapidJSON handler events.
+template <typename Handler>
+static bool AcceptNlohmann(const json& j, Handler& handler)
+{
+    switch (j.type())
+    {
+    case json::value_t::null:
+        return handler.Null();
+    case json::value_t::boolean:
+        return handler.Bool(j.get<bool>());
+    case json::value_t::number_integer:
+        return handler.Int64(j.get<int64_t>());
+    case json::value_t::number_unsigned:
+        return handler.Uint64(j.get<uint64_t>());
+    case json::value_t::number_float:
+        return handler.Double(j.get<double>());
+    case json::value_t::string:
+    {
+        const auto& str = j.get_ref<const std::string&>();
+        return handler.String(str.data(), static_cast<rapidjson::SizeType>(str.size()), false);
+    }
+    case json::value_t::object:
+        if (!handler.StartObject())
+        {
+            return false;
+        }
+        for (auto it = j.begin(); it != j.end(); ++it)
+        {
+            const std::string& key = it.key();
+            if (!handler.Key(key.data(), static_cast<rapidjson::SizeType>(key.size()), false)
+                    || !AcceptNlohmann(it.value(), handler))
+            {
+                return false;
+            }
+        }
+        return handler.EndObject(static_cast<rapidjson::SizeType>(j.size()));
+    case json::value_t::array:
+        if (!handler.StartArray())
+        {
+            return false;
+        }
+        for (const auto& element : j)
+        {
+            if (!AcceptNlohmann(element, handler))
+            {
+                return false;
+            }
+        }
+        return handler.EndArray(static_cast<rapidjson::SizeType>(j.size()));
+    default:
+        return false;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// pipelines
+//////////////////////////////////////////////////////////////////////////////
+
+// Each pipeline keeps what a request handler would keep between requests: a
+// parse arena, a validator and an output buffer. All of them allocate through
+// alloc_counter. operator() returns a checksum of what it read and wrote.
+
+// RapidJSON into a reused arena, validated by a pooled SchemaValidator.
+class RapidSchemaPipeline
+{
+public:
+    size_t operator()(const std::string& message)
+    {
+        auto& j = _context.parse(message.c_str());
+        if (j.HasParseError())
+        {
+            throw std::runtime_error("failed to parse message");
+        }
+        bool valid = j.Accept(*_validator);
+        _validator->Reset();
+        if (!valid)
+        {
+            throw std::runtime_error("failed schema validation");
+        }
+
+        AddressFields fields = ReadRapid(j);
+
+        _buffer.Clear();
+        rapidjson::Writer<CountedStringBuffer> writer(_buffer);
+        j.Accept(writer);
+        return fields.Checksum() + _buffer.GetSize();
+    }
+
+private:
+    parse_context<counting_allocator> _context;
+    validator_lease<rapidjson::SchemaValidator> _validator = acquire_validator(address::schema());
+    CountedStringBuffer _buffer;
+};
+
+// As above, validated by the schema compiled at build time.
+class RapidCompiledPipeline
+{
+public:
+    size_t operator()(const std::string& message)
+    {
+        auto& j = _context.parse(message.c_str());
+        if (j.HasParseError())
+        {
+            throw std::runtime_error("failed to parse message");
+        }
+        bool valid = j.Accept(_validator);
+        _validator.Reset();
+        if (!valid)
+        {
+            throw std::runtime_error("failed schema validation");
+        }
+
+        AddressFields fields = ReadRapid(j);
+
+        _buffer.Clear();
+        rapidjson::Writer<CountedStringBuffer> writer(_buffer);
+        j.Accept(writer);
+        return fields.Checksum() + _buffer.GetSize();
+    }
+
+private:
+    parse_context<counting_allocator> _context;
+    compiled_validator<compiled_orm_address> _validator;
+    CountedStringBuffer _buffer;
+};
+
+class NlohmannPipeline
+{
+public:
+    size_t operator()(const std::string& message)
+    {
+        json j = json::parse(message);
+        bool valid = AcceptNlohmann(j, _validator);
+        _validator.Reset();
+        if (!valid)
+        {
+            throw std::runtime_error("failed schema validation");
+        }
+
+        AddressFields fields;
+        fields.line_1 = j["line_1"].get_ref<const std::string&>();
+        fields.line_2 = j["line_2"].get_ref<const std::string&>();
+        fields.city = j["city"].get_ref<const std::string&>();
+        fields.state = j["state"].get_ref<const std::string&>();
+        fields.zip = j["zip"].get<uint32_t>();
+
+        std::string out = j.dump();
+        return fields.Checksum() + out.size();
+    }
+
+private:
+    compiled_validator<compiled_orm_address> _validator;
+};
+
+// DOM-free: decoding into typed_address is the validation, since a field of the
+// wrong type fails the decode. Only the address fields are written back.
+class TypedPipeline
+{
+public:
+    size_t operator()(const std::string& message)
+    {
+        typed_address a = typed_address::from_json(message);
+
+        AddressFields fields{a.line_1, a.line_2, a.city, a.state, a.zip};
+
+        _buffer.Clear();
+        rapidjson::Writer<CountedStringBuffer> writer(_buffer);
+        a.to_json(writer);
+        return fields.Checksum() + _buffer.GetSize();
+    }
+
+private:
+    CountedStringBuffer _buffer;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// replay the corpus
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename Pipeline>
+static void Latency(benchmark::State& state, Pipeline pipeline, CpuCache cache)
+{
+    const std::vector<std::string>& messages = Messages();
+    latency_histogram histogram;
+    size_t checksum = 0;
+    size_t next = 0;
+    int64_t bytes = 0;
+
+    // One pass first, so arenas and pools are at their steady-state size.
+    for (const std::string& message : messages)
+    {
+        checksum += pipeline(message);
+    }
+
+    while (state.KeepRunning())
+    {
+        const std::string& message = messages[next];
+        next = next + 1 == messages.size() ? 0 : next + 1;
+        if (cache == CpuCache::cold)
+        {
+            EvictCpuCaches();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        checksum += pipeline(message);
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        histogram.record(static_cast<uint64_t>(ns));
+        state.SetIterationTime(static_cast<double>(ns) * 1e-9);
+        bytes += static_cast<int64_t>(message.size());
+    }
+    benchmark::DoNotOptimize(checksum);
+
+    state.SetBytesProcessed(bytes);
+    state.SetItemsProcessed(state.iterations());
+    state.counters["p50_ns"] = benchmark::Counter(static_cast<double>(histogram.percentile(50)));
+    state.counters["p99_ns"] = benchmark::Counter(static_cast<double>(histogram.percentile(99)));
+    state.counters["p999_ns"] = benchmark::Counter(static_cast<double>(histogram.percentile(99.9)));
+    state.counters["max_ns"] = benchmark::Counter(static_cast<double>(histogram.max()));
+
+    alloc_stats before = alloc_counter::snapshot();
+    for (const std::string& message : messages)
+    {
+        checksum += pipeline(message);
+    }
+    alloc_stats allocs = alloc_counter::snapshot() - before;
+    benchmark::DoNotOptimize(checksum);
+    state.counters["allocs_per_msg"] = benchmark::Counter(
+            static_cast<double>(allocs.allocations) / static_cast<double>(messages.size()));
+    state.counters["alloc_bytes_per_msg"] = benchmark::Counter(
+            static_cast<double>(allocs.bytes) / static_cast<double>(messages.size()));
+}
+
+// Fixed iteration counts: enough samples for a stable p999, without letting
+// the untimed cache eviction of the cold runs stretch them out for minutes.
+static void Warm(benchmark::internal::Benchmark* b)
+{
+    b->UseManualTime()->Iterations(200000);
+}
+
+static void Cold(benchmark::internal::Benchmark* b)
+{
+    b->UseManualTime()->Iterations(20000);
+}
+
+BENCHMARK_CAPTURE(Latency, rapid_schema_warm,       RapidSchemaPipeline(),      CpuCache::warm)->Apply(Warm);
+BENCHMARK_CAPTURE(Latency, rapid_compiled_warm,     RapidCompiledPipeline(),    CpuCache::warm)->Apply(Warm);
+BENCHMARK_CAPTURE(Latency, nlohmann_warm,           NlohmannPipeline(),         CpuCache::warm)->Apply(Warm);
+BENCHMARK_CAPTURE(Latency, typed_warm,              TypedPipeline(),            CpuCache::warm)->Apply(Warm);
+
+BENCHMARK_CAPTURE(Latency, rapid_schema_cold,       RapidSchemaPipeline(),      CpuCache::cold)->Apply(Cold);
+BENCHMARK_CAPTURE(Latency, rapid_compiled_cold,     RapidCompiledPipeline(),    CpuCache::cold)->Apply(Cold);
+BENCHMARK_CAPTURE(Latency, nlohmann_cold,           NlohmannPipeline(),         CpuCache::cold)->Apply(Cold);
+BENCHMARK_CAPTURE(Latency, typed_cold,              TypedPipeline(),            CpuCache::cold)->Apply(Cold);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,55 @@
+#include "latency_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+latency_histogram::latency_histogram()
+        :_counts((64 - sub_bucket_bits + 2) * half_count, 0) { }
+
+size_t latency_histogram::index(uint64_t ns) {
+    if (ns < sub_bucket_count) {
+        return static_cast<size_t>(ns);
+    }
+    // The top sub_bucket_bits bits of ns select one of the upper half of the
+    // sub-buckets at this power of two.
+    unsigned shift = 63 - static_cast<unsigned>(__builtin_clzll(ns)) - (sub_bucket_bits - 1);
+    return static_cast<size_t>(shift * half_count + (ns >> shift));
+}
+
+uint64_t latency_histogram::upper_bound(size_t index) {
+    if (index < sub_bucket_count) {
+        return index;
+    }
+    uint64_t shift = index / half_count - 1;
+    uint64_t sub_bucket = index - shift * half_count;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+void latency_histogram::record(uint64_t ns) {
+    ++_counts[index(ns)];
+    ++_count;
+    _max = std::max(_max, ns);
+}
+
+void latency_histogram::clear() {
+    std::fill(_counts.begin(), _counts.end(), 0);
+    _count = 0;
+    _max = 0;
+}
+
+uint64_t latency_histogram::percentile(double percent) const {
+    if (_count == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(std::ceil(percent / 100.0 * static_cast<double>(_count)));
+    rank = std::clamp<uint64_t>(rank, 1, _count);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < _counts.size(); ++i) {
+        seen += _counts[i];
+        if (seen >= rank) {
+            return std::min(upper_bound(i), _max);
+        }
+    }
+    return _max;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Log-linear histogram of latencies in nanoseconds, after HdrHistogram. Values
+// below 256 are counted exactly; above that each power of two is split into
+// 128 equal buckets, so any recorded value is known to within 1/128 (0.8%)
+// across the whole 64-bit range, in a fixed 60 KB of counters.
+class latency_histogram {
+public:
+    latency_histogram();
+
+    void record(uint64_t ns);
+
+    void clear();
+
+    uint64_t count() const {
+        return _count;
+    }
+
+    uint64_t max() const {
+        return _max;
+    }
+
+    // The smallest bucket bound at or below which percent% of the recorded
+    // values lie, e.g. percentile(99.9) for p999. Never above max(), and 0
+    // when nothing has been recorded.
+    uint64_t percentile(double percent) const;
+
+private:
+    static constexpr unsigned sub_bucket_bits = 8;
+    static constexpr uint64_t sub_bucket_count = uint64_t(1) << sub_bucket_bits;
+    static constexpr uint64_t half_count = sub_bucket_count / 2;
+
+    static size_t index(uint64_t ns);
+
+    // Largest value that lands in the bucket.
+    static uint64_t upper_bound(size_t index);
+
+    std::vector<uint64_t> _counts;
+    uint64_t _count = 0;
+    uint64_t _max = 0;
+};
@@ -0,0 +1,209 @@
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/pointer.h>
+#include <fstream>
+
+#include "benchmark_counters.hpp"
+#include "lazy_document.hpp"
+
+using json = nlohmann::json;
+
+// Every benchmark here starts from the JSON text, so the full-DOM variants pay
+// for the whole parse and the lazy ones only for what they read.
+
+static std::string ReadString(const char* filename)
+{
+    std::ifstream f(filename);
+    return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// extract statuses[*].user.screen_name from twitter.json
+//////////////////////////////////////////////////////////////////////////////
+
+static size_t ScreenNamesLazy(const std::string& str)
+{
+    size_t length = 0;
+    lazy_document j(str);
+    j["statuses"].for_each_element([&](lazy_value& status) {
+        length += status["user"]["screen_name"].get_string().size();
+    });
+    return length;
+}
+
+static size_t ScreenNamesRapid(const std::string& str)
+{
+    size_t length = 0;
+    rapidjson::Document j;
+    j.Parse(str.data(), str.size());
+    for (const auto& status : j["statuses"].GetArray())
+    {
+        length += status["user"]["screen_name"].GetStringLength();
+    }
+    return length;
+}
+
+static size_t ScreenNamesNlohmann(const std::string& str)
+{
+    size_t length = 0;
+    json j = json::parse(str);
+    for (const auto& status : j["statuses"])
+    {
+        length += status["user"]["screen_name"].get_ref<const std::string&>().size();
+    }
+    return length;
+}
+
+static void ScreenNames(benchmark::State& state, size_t (*extract)(const std::string&))
+{
+    std::string str = ReadString("../data/nativejson-benchmark/twitter.json");
+
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(extract(str));
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_allocations(state, [&] {
+        return extract(str);
+    });
+}
+BENCHMARK_CAPTURE(ScreenNames, lazy,      ScreenNamesLazy);
+BENCHMARK_CAPTURE(ScreenNames, rapidjson, ScreenNamesRapid);
+BENCHMARK_CAPTURE(ScreenNames, nlohmann,  ScreenNamesNlohmann);
+
+//////////////////////////////////////////////////////////////////////////////
+// sum the coordinates in canada.json
+//////////////////////////////////////////////////////////////////////////////
+
+// This one reads every number in the document, so it shows the lazy document's
+// overhead rather than its savings.
+static double CoordinateSumLazy(const std::string& str)
+{
+    double sum = 0;
+    lazy_document j(str);
+    j["features"].for_each_element([&](lazy_value& feature) {
+        feature["geometry"]["coordinates"].for_each_element([&](lazy_value& ring) {
+            ring.for_each_element([&](lazy_value& point) {
+                point.for_each_element([&](lazy_value& coordinate) {
+                    sum += coordinate.get_double();
+                });
+            });
+        });
+    });
+    return sum;
+}
+
+static double CoordinateSumRapid(const std::string& str)
+{
+    double sum = 0;
+    rapidjson::Document j;
+    j.Parse(str.data(), str.size());
+    for (const auto& feature : j["features"].GetArray())
+    {
+        for (const auto& ring : feature["geometry"]["coordinates"].GetArray())
+        {
+            for (const auto& point : ring.GetArray())
+            {
+                for (const auto& coordinate : point.GetArray())
+                {
+                    sum += coordinate.GetDouble();
+                }
+            }
+        }
+    }
+    return sum;
+}
+
+static double CoordinateSumNlohmann(const std::string& str)
+{
+    double sum = 0;
+    json j = json::parse(str);
+    for (const auto& feature : j["features"])
+    {
+        for (const auto& ring : feature["geometry"]["coordinates"])
+        {
+            for (const auto& point : ring)
+            {
+                for (const auto& coordinate : point)
+                {
+                    sum += coordinate.get<double>();
+                }
+            }
+        }
+    }
+    return sum;
+}
+
+static void CoordinateSum(benchmark::State& state, double (*sum)(const std::string&))
+{
+    std::string str = ReadString("../data/nativejson-benchmark/canada.json");
+
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(sum(str));
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_allocations(state, [&] {
+        return sum(str);
+    });
+}
+BENCHMARK_CAPTURE(CoordinateSum, lazy,      CoordinateSumLazy);
+BENCHMARK_CAPTURE(CoordinateSum, rapidjson, CoordinateSumRapid);
+BENCHMARK_CAPTURE(CoordinateSum, nlohmann,  CoordinateSumNlohmann);
+
+//////////////////////////////////////////////////////////////////////////////
+// read a handful of fields by JSON Pointer
+//////////////////////////////////////////////////////////////////////////////
+
+static const char* const TwitterPointers[] = {
+    "/search_metadata/count",
+    "/statuses/0/user/screen_name",
+    "/statuses/0/retweet_count",
+    "/statuses/50/user/followers_count",
+    "/statuses/99/id_str",
+};
+
+static size_t PointersLazy(const std::string& str)
+{
+    size_t found = 0;
+    lazy_document j(str);
+    for (const char* pointer : TwitterPointers)
+    {
+        found += j.at(pointer).raw().size();
+    }
+    return found;
+}
+
+static size_t PointersRapid(const std::string& str)
+{
+    size_t found = 0;
+    rapidjson::Document j;
+    j.Parse(str.data(), str.size());
+    for (const char* pointer : TwitterPointers)
+    {
+        found += rapidjson::Pointer(pointer).Get(j) != nullptr;
+    }
+    return found;
+}
+
+static void Pointers(benchmark::State& state, size_t (*lookup)(const std::string&))
+{
+    std::string str = ReadString("../data/nativejson-benchmark/twitter.json");
+
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(lookup(str));
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_allocations(state, [&] {
+        return lookup(str);
+    });
+}
+BENCHMARK_CAPTURE(Pointers, lazy,      PointersLazy);
+BENCHMARK_CAPTURE(Pointers, rapidjson, PointersRapid);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,419 @@
+#include "lazy_document.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/format.h>
+#include <rapidjson/reader.h>
+#include <stdexcept>
+
+#include "number_parse.hpp"
+
+namespace {
+
+constexpr size_t npos = std::string_view::npos;
+
+[[noreturn]] void parse_error(const char* message, size_t offset) {
+    throw std::runtime_error(fmt::format("Failed to parse json: {} at {}", message, offset));
+}
+
+inline bool is_whitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+size_t skip_whitespace(std::string_view json, size_t offset) {
+    while (offset < json.size() && is_whitespace(json[offset])) {
+        ++offset;
+    }
+    return offset;
+}
+
+// offset is at an opening quote; returns the offset after the closing one.
+// Finds candidate quotes with memchr and counts the backslashes before each.
+size_t skip_string(std::string_view json, size_t offset) {
+    const char* data = json.data();
+    size_t from = offset + 1;
+    for (;;) {
+        const void* found = from < json.size() ? std::memchr(data + from, '"', json.size() - from) : nullptr;
+        if (found == nullptr) {
+            parse_error("unterminated string", offset);
+        }
+        size_t quote = static_cast<size_t>(static_cast<const char*>(found) - data);
+        size_t backslashes = 0;
+        while (data[quote - 1 - backslashes] == '\\') {
+            ++backslashes;
+        }
+        if (backslashes % 2 == 0) {
+            return quote + 1;
+        }
+        from = quote + 1;
+    }
+}
+
+// offset is at an opening bracket; returns the offset after its match. Only
+// brackets and strings are looked at, so the contents are not validated.
+size_t skip_container(std::string_view json, size_t offset) {
+    unsigned depth = 0;
+    for (size_t i = offset; i < json.size();) {
+        switch (json[i]) {
+        case '"':
+            i = skip_string(json, i);
+            continue;
+        case '{':
+        case '[':
+            ++depth;
+            break;
+        case '}':
+        case ']':
+            if (--depth == 0) {
+                return i + 1;
+            }
+            break;
+        }
+        ++i;
+    }
+    parse_error("unterminated container", offset);
+}
+
+// Numbers and literals end at the first byte that cannot be part of them.
+size_t skip_scalar(std::string_view json, size_t offset) {
+    size_t end = offset;
+    while (end < json.size()) {
+        char c = json[end];
+        if (c == ',' || c == '}' || c == ']' || c == ':' || is_whitespace(c)) {
+            break;
+        }
+        ++end;
+    }
+    return end;
+}
+
+size_t skip_value(std::string_view json, size_t offset) {
+    if (offset >= json.size()) {
+        parse_error("unexpected end of input", offset);
+    }
+    switch (json[offset]) {
+    case '"':
+        return skip_string(json, offset);
+    case '{':
+    case '[':
+        return skip_container(json, offset);
+    default:
+        return skip_scalar(json, offset);
+    }
+}
+
+// Unescapes a raw string (quotes included) with RapidJSON's reader.
+struct string_handler : rapidjson::BaseReaderHandler<rapidjson::UTF8<>, string_handler> {
+    bool String(const char* str, rapidjson::SizeType length, bool) {
+        value.assign(str, length);
+        return true;
+    }
+
+    bool Default() {
+        return false;
+    }
+
+    std::string value;
+};
+
+std::string unescape(std::string_view raw, size_t offset) {
+    if (raw.find('\\') == npos) {
+        return std::string(raw.substr(1, raw.size() - 2));
+    }
+    string_handler handler;
+    rapidjson::MemoryStream ms(raw.data(), raw.size());
+    rapidjson::Reader reader;
+    if (reader.Parse(ms, handler).IsError()) {
+        parse_error("invalid string", offset);
+    }
+    return handler.value;
+}
+
+// The number that is the whole of text, by JSON's grammar; anything else
+// (a sign of +, leading zeros, inf, surrounding space) is an error.
+parsed_number parse_number_token(std::string_view text, size_t offset) {
+    parsed_number number;
+    const char* last = text.data() + text.size();
+    if (parse_json_number(text.data(), last, number) != last) {
+        parse_error("invalid number", offset);
+    }
+    return number;
+}
+
+// The token's text with ~1 and ~0 unescaped, per RFC 6901.
+std::string pointer_token(std::string_view token) {
+    std::string result;
+    result.reserve(token.size());
+    for (size_t i = 0; i < token.size(); ++i) {
+        if (token[i] == '~' && i + 1 < token.size() && (token[i + 1] == '0' || token[i + 1] == '1')) {
+            result += token[i + 1] == '0' ? '~' : '/';
+            ++i;
+        } else {
+            result += token[i];
+        }
+    }
+    return result;
+}
+
+}
+
+rapidjson::Type lazy_value::type() const {
+    switch (_document->json()[_begin]) {
+    case '{':
+        return rapidjson::kObjectType;
+    case '[':
+        return rapidjson::kArrayType;
+    case '"':
+        return rapidjson::kStringType;
+    case 't':
+        return rapidjson::kTrueType;
+    case 'f':
+        return rapidjson::kFalseType;
+    case 'n':
+        return rapidjson::kNullType;
+    default:
+        return rapidjson::kNumberType;
+    }
+}
+
+size_t lazy_value::end() const {
+    if (_end == npos) {
+        _end = skip_value(_document->json(), _begin);
+    }
+    return _end;
+}
+
+std::string_view lazy_value::raw() const {
+    return _document->json().substr(_begin, end() - _begin);
+}
+
+size_t lazy_value::first_child(char open) const {
+    std::string_view json = _document->json();
+    if (json[_begin] != open) {
+        throw std::runtime_error(fmt::format("Failed to read json: expected '{}' at {}", open, _begin));
+    }
+    size_t offset = skip_whitespace(json, _begin + 1);
+    if (offset >= json.size()) {
+        parse_error("unexpected end of input", offset);
+    }
+    if (json[offset] == (open == '{' ? '}' : ']')) {
+        _end = offset + 1;
+        return npos;
+    }
+    return offset;
+}
+
+size_t lazy_value::next_child(size_t offset, char close) const {
+    std::string_view json = _document->json();
+    offset = skip_whitespace(json, offset);
+    if (offset >= json.size()) {
+        parse_error("unexpected end of input", offset);
+    }
+    if (json[offset] == close) {
+        _end = offset + 1;
+        return npos;
+    }
+    if (json[offset] != ',') {
+        parse_error(close == '}' ? "expected ',' or '}' in object" : "expected ',' or ']' in array", offset);
+    }
+    offset = skip_whitespace(json, offset + 1);
+    if (offset >= json.size()) {
+        parse_error("unexpected end of input", offset);
+    }
+    return offset;
+}
+
+size_t lazy_value::member_value(size_t offset, std::string_view& raw_key) const {
+    std::string_view json = _document->json();
+    if (json[offset] != '"') {
+        parse_error("expected object key", offset);
+    }
+    size_t key_end = skip_string(json, offset);
+    raw_key = json.substr(offset + 1, key_end - offset - 2);
+
+    size_t colon = skip_whitespace(json, key_end);
+    if (colon >= json.size() || json[colon] != ':') {
+        parse_error("expected ':' after object key", colon);
+    }
+    size_t value = skip_whitespace(json, colon + 1);
+    if (value >= json.size()) {
+        parse_error("unexpected end of input", value);
+    }
+    return value;
+}
+
+std::optional<lazy_value> lazy_value::find(std::string_view key) const {
+    for (size_t offset = first_child('{'); offset != npos;) {
+        std::string_view raw_key;
+        lazy_value value(*_document, member_value(offset, raw_key));
+        bool escaped = raw_key.find('\\') != npos;
+        if ((!escaped && raw_key == key) ||
+                (escaped && unescape(_document->json().substr(offset, raw_key.size() + 2), offset) == key)) {
+            return value;
+        }
+        offset = next_child(value.end(), '}');
+    }
+    return std::nullopt;
+}
+
+lazy_value lazy_value::operator[](std::string_view key) const {
+    std::optional<lazy_value> value = find(key);
+    if (!value) {
+        throw std::out_of_range(fmt::format("No member {} in object at {}", key, _begin));
+    }
+    return *value;
+}
+
+lazy_value lazy_value::operator[](size_t index) const {
+    size_t i = 0;
+    for (size_t offset = first_child('['); offset != npos; ++i) {
+        lazy_value element(*_document, offset);
+        if (i == index) {
+            return element;
+        }
+        offset = next_child(element.end(), ']');
+    }
+    throw std::out_of_range(fmt::format("Index {} past the end of the array at {}", index, _begin));
+}
+
+size_t lazy_value::size() const {
+    size_t count = 0;
+    if (type() == rapidjson::kObjectType) {
+        for_each_member([&](std::string_view, lazy_value&) { ++count; });
+    } else {
+        for_each_element([&](lazy_value&) { ++count; });
+    }
+    return count;
+}
+
+std::string lazy_value::get_string() const {
+    if (type() != rapidjson::kStringType) {
+        throw std::runtime_error(fmt::format("Failed to read json: expected a string at {}", _begin));
+    }
+    return unescape(raw(), _begin);
+}
+
+double lazy_value::get_double() const {
+    std::string_view text = raw();
+    double value;
+    const char* last = text.data() + text.size();
+    if (parse_json_double(text.data(), last, value) != last) {
+        parse_error("invalid number", _begin);
+    }
+    return value;
+}
+
+int64_t lazy_value::get_int64() const {
+    parsed_number number = parse_number_token(raw(), _begin);
+    if (number.kind == number_kind::int64) {
+        return number.i;
+    }
+    if (number.kind == number_kind::uint64 && number.u <= uint64_t(INT64_MAX)) {
+        return static_cast<int64_t>(number.u);
+    }
+    parse_error("invalid integer", _begin);
+}
+
+uint64_t lazy_value::get_uint64() const {
+    parsed_number number = parse_number_token(raw(), _begin);
+    if (number.kind == number_kind::uint64) {
+        return number.u;
+    }
+    if (number.kind == number_kind::int64 && number.i >= 0) {
+        return static_cast<uint64_t>(number.i);
+    }
+    parse_error("invalid unsigned integer", _begin);
+}
+
+bool lazy_value::get_bool() const {
+    std::string_view text = raw();
+    if (text == "true") {
+        return true;
+    }
+    if (text == "false") {
+        return false;
+    }
+    parse_error("expected true or false", _begin);
+}
+
+bool lazy_value::is_null() const {
+    return raw() == "null";
+}
+
+rapidjson::Document lazy_value::parse() const {
+    std::string_view text = raw();
+    rapidjson::Document document;
+    document.Parse(text.data(), text.size());
+    if (document.HasParseError()) {
+        parse_error("invalid value", _begin + document.GetErrorOffset());
+    }
+    return document;
+}
+
+lazy_document::lazy_document(std::string_view json)
+        :_json(json), _root(skip_whitespace(json, 0)) {
+    if (_root >= _json.size()) {
+        parse_error("empty document", _root);
+    }
+}
+
+lazy_value lazy_document::at(std::string_view pointer) const {
+    if (!pointer.empty() && pointer[0] != '/') {
+        throw std::out_of_range(fmt::format("Invalid JSON pointer: {}", pointer));
+    }
+
+    auto found = _resolved.find(std::string(pointer));
+    if (found != _resolved.end()) {
+        return lazy_value(*this, found->second);
+    }
+
+    // Resolve from the longest prefix already cached.
+    size_t resolved_length = 0;
+    lazy_value value = root();
+    for (size_t slash = pointer.rfind('/'); slash != npos && slash != 0; slash = pointer.rfind('/', slash - 1)) {
+        auto prefix = _resolved.find(std::string(pointer.substr(0, slash)));
+        if (prefix != _resolved.end()) {
+            resolved_length = slash;
+            value = lazy_value(*this, prefix->second);
+            break;
+        }
+    }
+
+    while (resolved_length < pointer.size()) {
+        size_t next = pointer.find('/', resolved_length + 1);
+        if (next == npos) {
+            next = pointer.size();
+        }
+        std::string token = pointer_token(pointer.substr(resolved_length + 1, next - resolved_length - 1));
+
+        if (value.type() == rapidjson::kArrayType) {
+            char* end;
+            unsigned long long index = std::strtoull(token.c_str(), &end, 10);
+            if (token.empty() || *end != '\0' || (token.size() > 1 && token[0] == '0')) {
+                throw std::out_of_range(fmt::format("Invalid array index {} in JSON pointer {}", token, pointer));
+            }
+            value = value[static_cast<size_t>(index)];
+        } else {
+            value = value[std::string_view(token)];
+        }
+
+        resolved_length = next;
+        _resolved.emplace(std::string(pointer.substr(0, resolved_length)), value.begin());
+    }
+
+    return value;
+}
+
+const rapidjson::Value& lazy_document::subtree(std::string_view pointer) const {
+    std::string key(pointer);
+    auto found = _subtrees.find(key);
+    if (found != _subtrees.end()) {
+        return *found->second;
+    }
+
+    auto document = std::make_unique<rapidjson::Document>(at(pointer).parse());
+    const rapidjson::Value& value = *document;
+    _subtrees.emplace(std::move(key), std::move(document));
+    return value;
+}
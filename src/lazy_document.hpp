@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <rapidjson/document.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class lazy_document;
+
+// A value inside a lazy_document's input, known only by where it starts.
+// Nothing is parsed until it is asked for: looking up a member or element
+// skips over the values before it by bracket matching and string bounds, and
+// scalars are converted only by the get_* calls.
+//
+// Skipped input is not validated, so malformed JSON is only reported (as
+// std::runtime_error) if the lookup actually has to read the broken part.
+class lazy_value {
+public:
+    lazy_value(const lazy_document& document, size_t begin)
+            :_document(&document), _begin(begin) { }
+
+    rapidjson::Type type() const;
+
+    // Object member by (unescaped) key; operator[] throws std::out_of_range if
+    // there is no such member.
+    std::optional<lazy_value> find(std::string_view key) const;
+    lazy_value operator[](std::string_view key) const;
+    lazy_value operator[](const char* key) const {
+        return (*this)[std::string_view(key)];
+    }
+
+    // Array element by index; throws std::out_of_range past the end.
+    lazy_value operator[](size_t index) const;
+
+    // Number of elements or members, found by skipping over all of them.
+    size_t size() const;
+
+    // Calls fn(lazy_value&) for each array element.
+    template <typename Fn>
+    void for_each_element(Fn&& fn) const;
+
+    // Calls fn(std::string_view raw_key, lazy_value&) for each object member.
+    // The key is as written in the input, escapes included.
+    template <typename Fn>
+    void for_each_member(Fn&& fn) const;
+
+    std::string get_string() const;
+    double get_double() const;
+    int64_t get_int64() const;
+    uint64_t get_uint64() const;
+    bool get_bool() const;
+    bool is_null() const;
+
+    // The value's JSON text.
+    std::string_view raw() const;
+
+    // Parses just this value into a Document.
+    rapidjson::Document parse() const;
+
+    size_t begin() const {
+        return _begin;
+    }
+
+    // Offset one past the value's last byte; skips over it the first time.
+    size_t end() const;
+
+private:
+    friend class lazy_document;
+
+    // Offset of the first element or member, or npos if the container (which
+    // must open with the given bracket) is empty.
+    size_t first_child(char open) const;
+
+    // Advances past the separator after a child ending at offset, returning
+    // the next child's offset, or npos at the closing bracket.
+    size_t next_child(size_t offset, char close) const;
+
+    // For the member whose key starts at offset: sets raw_key (without the
+    // quotes) and returns the offset of the value.
+    size_t member_value(size_t offset, std::string_view& raw_key) const;
+
+    const lazy_document* _document;
+    size_t _begin;
+    mutable size_t _end = std::string_view::npos;
+};
+
+// On-demand access to a JSON text that is never parsed as a whole. The
+// document borrows the input, which must outlive it and every lazy_value
+// taken from it.
+//
+// at() resolves JSON Pointers (RFC 6901) and caches every prefix it resolves,
+// so pointers sharing a path only skip through it once. subtree() goes one
+// step further and keeps the parsed DOM of the value. Both caches make a
+// lazy_document unsafe to share between threads.
+class lazy_document {
+public:
+    explicit lazy_document(std::string_view json);
+
+    std::string_view json() const {
+        return _json;
+    }
+
+    lazy_value root() const {
+        return lazy_value(*this, _root);
+    }
+
+    lazy_value operator[](std::string_view key) const {
+        return root()[key];
+    }
+
+    // Throws std::out_of_range if the pointer does not resolve.
+    lazy_value at(std::string_view pointer) const;
+
+    // The value at pointer, parsed on first request and cached.
+    const rapidjson::Value& subtree(std::string_view pointer) const;
+
+private:
+    std::string_view _json;
+    size_t _root;
+
+    mutable std::unordered_map<std::string, size_t> _resolved;
+    mutable std::unordered_map<std::string, std::unique_ptr<rapidjson::Document>> _subtrees;
+};
+
+template <typename Fn>
+void lazy_value::for_each_element(Fn&& fn) const {
+    for (size_t offset = first_child('['); offset != std::string_view::npos;) {
+        lazy_value element(*_document, offset);
+        fn(element);
+        offset = next_child(element.end(), ']');
+    }
+}
+
+template <typename Fn>
+void lazy_value::for_each_member(Fn&& fn) const {
+    for (size_t offset = first_child('{'); offset != std::string_view::npos;) {
+        std::string_view raw_key;
+        lazy_value value(*_document, member_value(offset, raw_key));
+        fn(raw_key, value);
+        offset = next_child(value.end(), '}');
+    }
+}
@@ -0,0 +1,210 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <fstream>
+#include <rapidjson/document.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "lazy_document.hpp"
+
+using namespace rapidjson;
+
+static std::string read_corpus(const char* filename) {
+    std::ifstream f(filename);
+    std::string json((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    REQUIRE(!json.empty());
+    return json;
+}
+
+// Compares every value, key and member order against RapidJSON's DOM, walking
+// containers with for_each_* so that long arrays are skipped through once.
+static void require_same(const Value& expected, const lazy_value& actual) {
+    REQUIRE(actual.type() == expected.GetType());
+    switch (expected.GetType()) {
+    case kObjectType: {
+        REQUIRE(actual.size() == expected.MemberCount());
+        size_t i = 0;
+        actual.for_each_member([&](std::string_view raw_key, lazy_value& value) {
+            const auto& member = expected.MemberBegin()[i++];
+            std::string_view name(member.name.GetString(), member.name.GetStringLength());
+            if (raw_key.find('\\') == std::string_view::npos) {
+                REQUIRE(raw_key == name);
+            } else {
+                REQUIRE(actual.find(name)->begin() == value.begin());
+            }
+            require_same(member.value, value);
+        });
+        break;
+    }
+    case kArrayType: {
+        REQUIRE(actual.size() == expected.Size());
+        SizeType i = 0;
+        actual.for_each_element([&](lazy_value& element) {
+            require_same(expected[i++], element);
+        });
+        break;
+    }
+    case kStringType:
+        REQUIRE(actual.get_string() == std::string(expected.GetString(), expected.GetStringLength()));
+        break;
+    case kNumberType:
+        if (expected.IsDouble()) {
+            REQUIRE(actual.get_double() == expected.GetDouble());
+        } else if (expected.IsInt64()) {
+            REQUIRE(actual.get_int64() == expected.GetInt64());
+        } else {
+            REQUIRE(actual.get_uint64() == expected.GetUint64());
+        }
+        break;
+    case kNullType:
+        REQUIRE(actual.is_null());
+        break;
+    default:
+        REQUIRE(actual.get_bool() == expected.GetBool());
+        break;
+    }
+}
+
+TEST_CASE("lazy documents match RapidJSON on the corpora") {
+    for (const char* filename : {"../data/nativejson-benchmark/canada.json",
+            "../data/nativejson-benchmark/citm_catalog.json", "../data/nativejson-benchmark/twitter.json"}) {
+        std::string json = read_corpus(filename);
+        Document expected;
+        expected.Parse<kParseFullPrecisionFlag>(json.c_str());
+        REQUIRE(!expected.HasParseError());
+
+        lazy_document actual(json);
+        require_same(expected, actual.root());
+    }
+}
+
+TEST_CASE("pointers into the corpora resolve like rapidjson::Pointer") {
+    std::string json = read_corpus("../data/nativejson-benchmark/twitter.json");
+    Document expected;
+    expected.Parse<kParseFullPrecisionFlag>(json.c_str());
+    lazy_document actual(json);
+
+    for (const char* pointer : {"/statuses/0/id", "/statuses/3/user/screen_name", "/statuses/99/text",
+            "/search_metadata/count", "/statuses/7/entities/hashtags"}) {
+        const Value* value = Pointer(pointer).Get(expected);
+        REQUIRE(value != nullptr);
+        require_same(*value, actual.at(pointer));
+    }
+}
+
+TEST_CASE("keys are matched unescaped") {
+    std::string json = R"({"plain": 1, "tab\tkey": 2, "quote\"key": 3, "été": 4, "back\\slash": 5})";
+    lazy_document d(json);
+
+    CHECK(d["plain"].get_int64() == 1);
+    CHECK(d["tab\tkey"].get_int64() == 2);
+    CHECK(d["quote\"key"].get_int64() == 3);
+    CHECK(d["\xc3\xa9t\xc3\xa9"].get_int64() == 4);
+    CHECK(d["back\\slash"].get_int64() == 5);
+    CHECK(!d.root().find("tab\\tkey"));
+    CHECK_THROWS_AS(d["missing"], std::out_of_range);
+}
+
+TEST_CASE("~0 and ~1 in pointer tokens") {
+    std::string json = R"({"a/b": {"c~d": [10, 20]}, "~1": 1, "/": 2})";
+    lazy_document d(json);
+
+    CHECK(d.at("/a~1b/c~0d/1").get_int64() == 20);
+    CHECK(d.at("/~01").get_int64() == 1);
+    CHECK(d.at("/~1").get_int64() == 2);
+    CHECK(d.at("").begin() == d.root().begin());
+    CHECK_THROWS_AS(d.at("/a/b"), std::out_of_range);
+    CHECK_THROWS_AS(d.at("a~1b"), std::out_of_range);
+}
+
+TEST_CASE("cached pointer prefixes resolve the same values") {
+    std::string json = R"({"a": {"b": [{"c": 1, "d": 2}, {"c": 3}], "bc": 4}, "ab": 5})";
+    std::vector<const char*> pointers = {"/a/b/1/c", "/a/b/0/d", "/a/b/0/c", "/a/bc", "/a/b", "/a", "/ab"};
+
+    // One document resolving every pointer from scratch, and one reusing the
+    // prefixes cached by the pointers before it, in both orders.
+    lazy_document warm(json);
+    for (const char* pointer : pointers) {
+        lazy_document cold(json);
+        CHECK(warm.at(pointer).begin() == cold.at(pointer).begin());
+        CHECK(warm.at(pointer).raw() == cold.at(pointer).raw());
+    }
+    lazy_document reversed(json);
+    for (auto it = pointers.rbegin(); it != pointers.rend(); ++it) {
+        CHECK(reversed.at(*it).begin() == warm.at(*it).begin());
+    }
+
+    CHECK(warm.at("/a/b/1/c").get_int64() == 3);
+    CHECK(warm.at("/a/bc").get_int64() == 4);
+    CHECK_THROWS_AS(warm.at("/a/b/2"), std::out_of_range);
+    CHECK_THROWS_AS(warm.at("/a/b/1/d"), std::out_of_range);
+
+    const Value& subtree = warm.subtree("/a/b/0");
+    CHECK(&warm.subtree("/a/b/0") == &subtree);
+    CHECK(subtree["d"].GetInt() == 2);
+}
+
+TEST_CASE("array indices past the end or malformed are out of range") {
+    std::string json = R"({"empty": [], "three": [1, 2, 3]})";
+    lazy_document d(json);
+
+    CHECK(d["three"][size_t(2)].get_int64() == 3);
+    CHECK_THROWS_AS(d["three"][size_t(3)], std::out_of_range);
+    CHECK_THROWS_AS(d["empty"][size_t(0)], std::out_of_range);
+    CHECK(d["empty"].size() == 0);
+    CHECK_THROWS_AS(d.at("/three/3"), std::out_of_range);
+    CHECK_THROWS_AS(d.at("/three/01"), std::out_of_range);
+    CHECK_THROWS_AS(d.at("/three/-"), std::out_of_range);
+    CHECK_THROWS_AS(d.at("/three/"), std::out_of_range);
+}
+
+TEST_CASE("malformed or truncated input is reported when read") {
+    CHECK_THROWS_AS(lazy_document(""), std::runtime_error);
+    CHECK_THROWS_AS(lazy_document("  \n"), std::runtime_error);
+
+    std::string truncated_array = R"({"a": [1, 2, {"b": 3})";
+    CHECK_THROWS_AS(lazy_document(truncated_array)["c"], std::runtime_error);
+
+    std::string truncated_string = R"({"a": "abc)";
+    CHECK_THROWS_AS(lazy_document(truncated_string)["a"].get_string(), std::runtime_error);
+
+    std::string truncated_object = R"({"a": 1,)";
+    CHECK_THROWS_AS(lazy_document(truncated_object)["b"], std::runtime_error);
+
+    std::string missing_colon = R"({"a" 1})";
+    CHECK_THROWS_AS(lazy_document(missing_colon)["a"], std::runtime_error);
+
+    std::string missing_comma = R"([1 2])";
+    CHECK_THROWS_AS(lazy_document(missing_comma).root()[size_t(1)], std::runtime_error);
+
+    std::string bad_scalars = R"({"n": 12x, "b": tru, "s": 5})";
+    lazy_document d(bad_scalars);
+    CHECK_THROWS_AS(d["n"].get_int64(), std::runtime_error);
+    CHECK_THROWS_AS(d["n"].get_double(), std::runtime_error);
+    CHECK_THROWS_AS(d["b"].get_bool(), std::runtime_error);
+    CHECK_THROWS_AS(d["s"].get_string(), std::runtime_error);
+    CHECK_THROWS_AS(d["n"].parse(), std::runtime_error);
+
+    // Numbers are read by JSON's grammar, not strtod's.
+    std::string numbers = R"({"plus": +1, "zeros": 012, "inf": inf, "nan": nan, "hex": 0x10, "dot": 1., )"
+            R"("exp": 1e, "big": 18446744073709551616, "negative": -1, "fraction": 1.5, "ok": -0.25e1})";
+    lazy_document n(numbers);
+    for (const char* key : {"plus", "zeros", "inf", "nan", "hex", "dot", "exp"}) {
+        CHECK_THROWS_AS(n[key].get_double(), std::runtime_error);
+        CHECK_THROWS_AS(n[key].get_int64(), std::runtime_error);
+        CHECK_THROWS_AS(n[key].get_uint64(), std::runtime_error);
+    }
+    CHECK_THROWS_AS(n["big"].get_int64(), std::runtime_error);
+    CHECK_THROWS_AS(n["big"].get_uint64(), std::runtime_error);
+    CHECK(n["big"].get_double() == 18446744073709551616.0);
+    CHECK(n["negative"].get_int64() == -1);
+    CHECK_THROWS_AS(n["negative"].get_uint64(), std::runtime_error);
+    CHECK_THROWS_AS(n["fraction"].get_int64(), std::runtime_error);
+    CHECK(n["ok"].get_double() == -2.5);
+
+    // The broken part is skipped unread when the lookup does not need it.
+    std::string broken_tail = R"({"a": 1, "b": [1 2 3]})";
+    CHECK(lazy_document(broken_tail)["a"].get_int64() == 1);
+}
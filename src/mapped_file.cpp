@@ -0,0 +1,125 @@
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include "profile.hpp"
+
+namespace {
+
+class file_descriptor {
+public:
+    explicit file_descriptor(const std::string& filename)
+            :_fd(::open(filename.c_str(), O_RDONLY)) {
+        if (_fd < 0) {
+            throw std::runtime_error(fmt::format("Failed to open {}: {}", filename, std::strerror(errno)));
+        }
+    }
+
+    ~file_descriptor() {
+        ::close(_fd);
+    }
+
+    int get() const {
+        return _fd;
+    }
+
+    size_t size(const std::string& filename) const {
+        struct stat st;
+        if (::fstat(_fd, &st) != 0) {
+            throw std::runtime_error(fmt::format("Failed to stat {}: {}", filename, std::strerror(errno)));
+        }
+        return static_cast<size_t>(st.st_size);
+    }
+
+private:
+    int _fd;
+};
+
+}
+
+mapped_file::mapped_file(const std::string& filename, unsigned flags) {
+    phase_scope read(phase::read);
+    file_descriptor fd(filename);
+    _size = fd.size(filename);
+    if (_size == 0) {
+        return;
+    }
+
+    int mmap_flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (flags & map_populate) {
+        mmap_flags |= MAP_POPULATE;
+    }
+#endif
+
+    void* addr = ::mmap(nullptr, _size, PROT_READ, mmap_flags, fd.get(), 0);
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error(fmt::format("Failed to map {}: {}", filename, std::strerror(errno)));
+    }
+    _data = static_cast<const char*>(addr);
+
+    ::madvise(addr, _size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    if (flags & map_huge_pages) {
+        ::madvise(addr, _size, MADV_HUGEPAGE);
+    }
+#endif
+}
+
+mapped_file::~mapped_file() {
+    if (_data != nullptr) {
+        ::munmap(const_cast<char*>(_data), _size);
+    }
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+        :_data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)) { }
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+    if (this != &other) {
+        if (_data != nullptr) {
+            ::munmap(const_cast<char*>(_data), _size);
+        }
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+    }
+    return *this;
+}
+
+std::string read_file(const std::string& filename) {
+    phase_scope read(phase::read);
+    file_descriptor fd(filename);
+    std::string result(fd.size(filename), '\0');
+
+    size_t offset = 0;
+    while (offset < result.size()) {
+        ssize_t n = ::read(fd.get(), &result[offset], result.size() - offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error(fmt::format("Failed to read {}: {}", filename,
+                    n == 0 ? "unexpected end of file" : std::strerror(errno)));
+        }
+        offset += static_cast<size_t>(n);
+    }
+
+    return result;
+}
+
+void drop_page_cache(const std::string& filename) {
+#if defined(POSIX_FADV_DONTNEED)
+    file_descriptor fd(filename);
+    ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_DONTNEED);
+#else
+    (void) filename;
+#endif
+}
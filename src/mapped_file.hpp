@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+enum mapping_flags : unsigned {
+    map_default = 0,
+    // Fault every page in up front (MAP_POPULATE) instead of on first touch.
+    map_populate = 1 << 0,
+    // Ask for transparent huge pages on the mapping (MADV_HUGEPAGE). Only takes
+    // effect where the kernel supports huge pages for page cache backed files.
+    map_huge_pages = 1 << 1,
+};
+
+// Read-only memory mapping of a whole file, advised for sequential access. The
+// mapping is not NUL terminated; hand parsers data() and size().
+class mapped_file {
+public:
+    explicit mapped_file(const std::string& filename, unsigned flags = map_default);
+    ~mapped_file();
+
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(mapped_file&& other) noexcept;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    const char* data() const {
+        return _data;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    std::string_view view() const {
+        return std::string_view(_data, _size);
+    }
+
+private:
+    const char* _data = nullptr;
+    size_t _size = 0;
+};
+
+// Reads a whole file into a string with a single sized read.
+std::string read_file(const std::string& filename);
+
+// Evicts the file's clean pages from the page cache so the next read comes from
+// the device. Best effort: a no-op where posix_fadvise is unavailable.
+void drop_page_cache(const std::string& filename);
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <rapidjson/document.h>
+#include <rapidjson/pointer.h>
+
+// Hashed member lookup for wide RapidJSON objects. FindMember compares the key
+// against each member in turn, which is fine for records of a dozen fields and
+// slow for objects used as maps: citm_catalog.json "events" has 184 members.
+// member_index answers the same lookups and, once an object of at least
+// min_members has been searched build_after times, builds a key -> member
+// table for it so later lookups are O(1). Narrow or rarely searched objects
+// keep the linear scan and cost no memory beyond a lookup count.
+//
+// Tables are kept by object address and hold views of the member names, so
+// they are only valid while the document is unchanged. A table whose object
+// has since gained or lost members is rebuilt; after any other change, or
+// once the document is gone, call clear(). One per thread.
+template <typename Value = rapidjson::Value>
+class member_index {
+public:
+    using const_member_iterator = typename Value::ConstMemberIterator;
+    using pointer_type = rapidjson::GenericPointer<Value>;
+
+    explicit member_index(size_t min_members = 32, uint32_t build_after = 4)
+            :_min_members(min_members), _build_after(build_after) { }
+
+    // As object.FindMember(key): the first member named key, or MemberEnd().
+    const_member_iterator find(const Value& object, std::string_view key) {
+        if (object.MemberCount() < _min_members) {
+            return scan(object, key);
+        }
+
+        table& t = _tables[&object];
+        if (t.built && t.members != object.MemberCount()) {
+            t = table();
+        }
+        if (!t.built) {
+            if (++t.lookups < _build_after) {
+                return scan(object, key);
+            }
+            build(t, object);
+        }
+
+        auto slot = t.slots.find(key);
+        return slot == t.slots.end() ? object.MemberEnd() : object.MemberBegin() + slot->second;
+    }
+
+    // As pointer.Get(root), with object members found through find().
+    const Value* get(const Value& root, const pointer_type& pointer) {
+        if (!pointer.IsValid()) {
+            return nullptr;
+        }
+
+        const Value* v = &root;
+        for (size_t i = 0; i < pointer.GetTokenCount(); ++i) {
+            const auto& token = pointer.GetTokens()[i];
+            if (v->IsObject()) {
+                auto member = find(*v, std::string_view(token.name, token.length));
+                if (member == v->MemberEnd()) {
+                    return nullptr;
+                }
+                v = &member->value;
+            } else if (v->IsArray()) {
+                if (token.index == rapidjson::kPointerInvalidIndex || token.index >= v->Size()) {
+                    return nullptr;
+                }
+                v = &(*v)[token.index];
+            } else {
+                return nullptr;
+            }
+        }
+        return v;
+    }
+
+    // Objects that have a table.
+    size_t indexed() const {
+        size_t count = 0;
+        for (const auto& entry : _tables) {
+            count += entry.second.built ? 1 : 0;
+        }
+        return count;
+    }
+
+    void clear() {
+        _tables.clear();
+    }
+
+private:
+    struct table {
+        uint32_t lookups = 0;
+        bool built = false;
+        rapidjson::SizeType members = 0;
+        std::unordered_map<std::string_view, rapidjson::SizeType> slots;
+    };
+
+    static const_member_iterator scan(const Value& object, std::string_view key) {
+        for (auto member = object.MemberBegin(); member != object.MemberEnd(); ++member) {
+            if (member->name.GetStringLength() == key.size()
+                    && std::memcmp(member->name.GetString(), key.data(), key.size()) == 0) {
+                return member;
+            }
+        }
+        return object.MemberEnd();
+    }
+
+    static void build(table& t, const Value& object) {
+        t.members = object.MemberCount();
+        t.slots.reserve(t.members);
+        rapidjson::SizeType slot = 0;
+        for (auto member = object.MemberBegin(); member != object.MemberEnd(); ++member, ++slot) {
+            // emplace keeps the first of repeated names, as FindMember finds it.
+            t.slots.emplace(std::string_view(member->name.GetString(), member->name.GetStringLength()), slot);
+        }
+        t.built = true;
+    }
+
+    size_t _min_members;
+    uint32_t _build_after;
+    std::unordered_map<const Value*, table> _tables;
+};
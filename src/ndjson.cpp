@@ -0,0 +1,72 @@
+#include "ndjson.hpp"
+
+#include <fmt/format.h>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <rapidjson/document.h>
+#include <rapidjson/pointer.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+std::string make_ndjson(const char* filename, const char* container_pointer, size_t target_bytes) {
+    std::ifstream f(filename);
+    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    rapidjson::Document doc;
+    doc.Parse(str.data());
+    if (doc.HasParseError()) {
+        throw std::runtime_error(fmt::format("Failed to parse {}: {} at {}", filename, doc.GetParseError(),
+                doc.GetErrorOffset()));
+    }
+
+    const rapidjson::Value* container = rapidjson::Pointer(container_pointer).Get(doc);
+    if (container == nullptr || !(container->IsArray() || container->IsObject())) {
+        throw std::runtime_error(fmt::format("{} has no array or object at {}", filename, container_pointer));
+    }
+
+    std::string lines;
+    rapidjson::StringBuffer buffer;
+    auto append = [&](const rapidjson::Value& element) {
+        buffer.Clear();
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        element.Accept(writer);
+        lines.append(buffer.GetString(), buffer.GetSize());
+        lines.push_back('\n');
+    };
+
+    if (container->IsArray()) {
+        for (const auto& element : container->GetArray()) {
+            append(element);
+        }
+    } else {
+        for (const auto& member : container->GetObject()) {
+            append(member.value);
+        }
+    }
+
+    if (lines.empty()) {
+        throw std::runtime_error(fmt::format("{} has no elements at {}", filename, container_pointer));
+    }
+
+    std::string result;
+    result.reserve(target_bytes + lines.size());
+    do {
+        result.append(lines);
+    } while (result.size() < target_bytes);
+    return result;
+}
+
+std::vector<std::string_view> split_ndjson(std::string_view buffer, size_t chunk_bytes) {
+    std::vector<std::string_view> chunks;
+    while (!buffer.empty()) {
+        size_t end = buffer.size();
+        if (chunk_bytes < buffer.size()) {
+            end = buffer.find('\n', chunk_bytes);
+            end = end == std::string_view::npos ? buffer.size() : end + 1;
+        }
+        chunks.push_back(buffer.substr(0, end));
+        buffer.remove_prefix(end);
+    }
+    return chunks;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Builds a newline-delimited JSON buffer out of the elements of one container
+// in a JSON file: an array (twitter.json "/statuses") or an object whose member
+// values are the documents (citm_catalog.json "/events"). Each element is
+// written compactly on its own line, and the set is repeated until the buffer
+// holds at least target_bytes.
+std::string make_ndjson(const char* filename, const char* container_pointer, size_t target_bytes);
+
+// Splits an NDJSON buffer into chunks of roughly chunk_bytes that end on line
+// boundaries. Every line lands in exactly one chunk.
+std::vector<std::string_view> split_ndjson(std::string_view buffer, size_t chunk_bytes);
+
+// Calls fn(line) for every non-empty line of an NDJSON chunk.
+template <typename Fn>
+void for_each_line(std::string_view chunk, Fn&& fn) {
+    while (!chunk.empty()) {
+        size_t end = chunk.find('\n');
+        if (end == std::string_view::npos) {
+            end = chunk.size();
+        }
+        if (end != 0) {
+            fn(chunk.substr(0, end));
+        }
+        chunk.remove_prefix(end == chunk.size() ? end : end + 1);
+    }
+}
@@ -2,6 +2,10 @@
 #include <nlohmann/json.hpp>
 #include <fstream>
 
+#include "benchmark_counters.hpp"
+#include "data_generator.hpp"
+#include "mapped_file.hpp"
+
 using json = nlohmann::json;
 
 //////////////////////////////////////////////////////////////////////////////
@@ -10,23 +14,30 @@ using json = nlohmann::json;
 
 static void ParseFile(benchmark::State& state, const char* filename)
 {
+    profile_session profile;
     while (state.KeepRunning())
     {
-        state.PauseTiming();
+        profile.pause(state);
         auto* f = new std::ifstream(filename);
         auto* j = new json();
-        state.ResumeTiming();
+        profile.resume(state);
 
-        *j = json::parse(*f);
+        *j = profiled_parse(*f);
 
-        state.PauseTiming();
+        profile.pause(state);
         delete f;
         delete j;
-        state.ResumeTiming();
+        profile.resume(state);
     }
+    profile.report(state);
 
     std::ifstream file(filename, std::ios::binary | std::ios::ate);
     state.SetBytesProcessed(state.iterations() * file.tellg());
+
+    std::ifstream in(filename);
+    report_dom_allocations(state, static_cast<size_t>(file.tellg()), [&] {
+        return json::parse(in);
+    });
 }
 BENCHMARK_CAPTURE(ParseFile, jeopardy,              "../data/jeopardy/jeopardy.json");
 BENCHMARK_CAPTURE(ParseFile, canada,                "../data/nativejson-benchmark/canada.json");
@@ -38,28 +49,131 @@ BENCHMARK_CAPTURE(ParseFile, unsigned_ints,         "../data/numbers/unsigned_in
 BENCHMARK_CAPTURE(ParseFile, small_signed_ints,     "../data/numbers/small_signed_ints.json");
 
 //////////////////////////////////////////////////////////////////////////////
-// parse JSON from string
+// parse JSON from file, by input strategy, with a warm or cold page cache
 //////////////////////////////////////////////////////////////////////////////
 
-static void ParseString(benchmark::State& state, const char* filename)
+enum class PageCache { warm, cold };
+
+static void PreparePageCache(benchmark::State& state, const char* filename, PageCache cache)
 {
-    std::ifstream f(filename);
-    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    if (cache == PageCache::cold)
+    {
+        state.PauseTiming();
+        drop_page_cache(filename);
+        state.ResumeTiming();
+    }
+}
 
+static void ParseFileIStream(benchmark::State& state, const char* filename, PageCache cache)
+{
     while (state.KeepRunning())
     {
+        PreparePageCache(state, filename, cache);
         state.PauseTiming();
+        auto* f = new std::ifstream(filename);
         auto* j = new json();
         state.ResumeTiming();
 
-        *j = json::parse(str);
+        *j = json::parse(*f);
+
+        state.PauseTiming();
+        delete f;
+        delete j;
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(state.iterations() * mapped_file(filename).size());
+}
+
+static void ParseFileWhole(benchmark::State& state, const char* filename, PageCache cache)
+{
+    profile_session profile;
+    while (state.KeepRunning())
+    {
+        PreparePageCache(state, filename, cache);
+        profile.pause(state);
+        auto* j = new json();
+        profile.resume(state);
+
+        std::string str = read_file(filename);
+        *j = profiled_parse(str);
+
+        profile.pause(state);
+        delete j;
+        profile.resume(state);
+    }
+    profile.report(state);
+
+    state.SetBytesProcessed(state.iterations() * mapped_file(filename).size());
+}
+
+// Mapping and unmapping are timed: they are the mmap equivalent of the read.
+static void ParseFileMapped(benchmark::State& state, const char* filename, unsigned flags, PageCache cache)
+{
+    while (state.KeepRunning())
+    {
+        PreparePageCache(state, filename, cache);
+        state.PauseTiming();
+        auto* j = new json();
+        state.ResumeTiming();
+
+        {
+            mapped_file file(filename, flags);
+            *j = json::parse(file.data(), file.data() + file.size());
+        }
 
         state.PauseTiming();
         delete j;
         state.ResumeTiming();
     }
 
+    state.SetBytesProcessed(state.iterations() * mapped_file(filename).size());
+}
+
+#define FILE_STRATEGY_CAPTURES(name, filename) \
+    BENCHMARK_CAPTURE(ParseFileIStream, name / warm,          filename, PageCache::warm); \
+    BENCHMARK_CAPTURE(ParseFileIStream, name / cold,          filename, PageCache::cold); \
+    BENCHMARK_CAPTURE(ParseFileWhole,   name / warm,          filename, PageCache::warm); \
+    BENCHMARK_CAPTURE(ParseFileWhole,   name / cold,          filename, PageCache::cold); \
+    BENCHMARK_CAPTURE(ParseFileMapped,  name / warm,          filename, map_default,    PageCache::warm); \
+    BENCHMARK_CAPTURE(ParseFileMapped,  name / cold,          filename, map_default,    PageCache::cold); \
+    BENCHMARK_CAPTURE(ParseFileMapped,  name / populate/warm, filename, map_populate,   PageCache::warm); \
+    BENCHMARK_CAPTURE(ParseFileMapped,  name / populate/cold, filename, map_populate,   PageCache::cold); \
+    BENCHMARK_CAPTURE(ParseFileMapped,  name / huge/warm,     filename, map_huge_pages, PageCache::warm); \
+    BENCHMARK_CAPTURE(ParseFileMapped,  name / huge/cold,     filename, map_huge_pages, PageCache::cold)
+
+FILE_STRATEGY_CAPTURES(canada,       "../data/nativejson-benchmark/canada.json");
+FILE_STRATEGY_CAPTURES(citm_catalog, "../data/nativejson-benchmark/citm_catalog.json");
+FILE_STRATEGY_CAPTURES(twitter,      "../data/nativejson-benchmark/twitter.json");
+
+//////////////////////////////////////////////////////////////////////////////
+// parse JSON from string
+//////////////////////////////////////////////////////////////////////////////
+
+static void ParseString(benchmark::State& state, const char* filename)
+{
+    std::ifstream f(filename);
+    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    profile_session profile;
+    while (state.KeepRunning())
+    {
+        profile.pause(state);
+        auto* j = new json();
+        profile.resume(state);
+
+        *j = profiled_parse(str);
+
+        profile.pause(state);
+        delete j;
+        profile.resume(state);
+    }
+    profile.report(state);
+
     state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        return json::parse(str);
+    });
 }
 BENCHMARK_CAPTURE(ParseString, jeopardy,            "../data/jeopardy/jeopardy.json");
 BENCHMARK_CAPTURE(ParseString, canada,              "../data/nativejson-benchmark/canada.json");
@@ -70,6 +184,38 @@ BENCHMARK_CAPTURE(ParseString, signed_ints,         "../data/numbers/signed_ints
 BENCHMARK_CAPTURE(ParseString, unsigned_ints,       "../data/numbers/unsigned_ints.json");
 BENCHMARK_CAPTURE(ParseString, small_signed_ints,   "../data/numbers/small_signed_ints.json");
 
+//////////////////////////////////////////////////////////////////////////////
+// parse generated JSON of increasing size
+//////////////////////////////////////////////////////////////////////////////
+
+static void ParseSweep(benchmark::State& state, corpus kind)
+{
+    const std::string& str = cached_corpus(kind, static_cast<size_t>(state.range(0)));
+
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        auto* j = new json();
+        state.ResumeTiming();
+
+        *j = json::parse(str);
+
+        state.PauseTiming();
+        delete j;
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        return json::parse(str);
+    });
+}
+BENCHMARK_CAPTURE(ParseSweep, jeopardy,             corpus::jeopardy)->RangeMultiplier(8)->Range(1 << 10, JSON_COMPARISON_SWEEP_MAX);
+BENCHMARK_CAPTURE(ParseSweep, floats,               corpus::floats)->RangeMultiplier(8)->Range(1 << 10, JSON_COMPARISON_SWEEP_MAX);
+BENCHMARK_CAPTURE(ParseSweep, signed_ints,          corpus::signed_ints)->RangeMultiplier(8)->Range(1 << 10, JSON_COMPARISON_SWEEP_MAX);
+BENCHMARK_CAPTURE(ParseSweep, unsigned_ints,        corpus::unsigned_ints)->RangeMultiplier(8)->Range(1 << 10, JSON_COMPARISON_SWEEP_MAX);
+BENCHMARK_CAPTURE(ParseSweep, small_signed_ints,    corpus::small_signed_ints)->RangeMultiplier(8)->Range(1 << 10, JSON_COMPARISON_SWEEP_MAX);
+
 
 //////////////////////////////////////////////////////////////////////////////
 // serialize JSON
@@ -81,12 +227,18 @@ static void Dump(benchmark::State& state, const char* filename, int indent)
     std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
     json j = json::parse(str);
 
+    profile_session profile;
     while (state.KeepRunning())
     {
+        phase_scope serialize(phase::serialize);
         j.dump(indent);
     }
+    profile.report(state);
 
     state.SetBytesProcessed(state.iterations() * j.dump(indent).size());
+    report_allocations(state, [&] {
+        return j.dump(indent);
+    });
 }
 BENCHMARK_CAPTURE(Dump, jeopardy / -,      "../data/jeopardy/jeopardy.json",                 -1);
 BENCHMARK_CAPTURE(Dump, jeopardy / 4,      "../data/jeopardy/jeopardy.json",                 4);
@@ -0,0 +1,224 @@
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/reader.h>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "benchmark_counters.hpp"
+#include "fast_numbers.hpp"
+#include "number_parse.hpp"
+#include "tape.hpp"
+
+using namespace rapidjson;
+using json = nlohmann::json;
+
+// How RapidJSON converts numbers: its default (fast, but not always correctly
+// rounded), kParseFullPrecisionFlag (correctly rounded, with a big-integer
+// slow path), or with number_parse through fast_number_handler.
+enum class Numbers { standard, full_precision, fast };
+
+static std::string ReadString(const char* filename)
+{
+    std::ifstream f(filename);
+    return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// parse JSON from string, RapidJSON
+//////////////////////////////////////////////////////////////////////////////
+
+static void RapidParse(Document& d, const std::string& str, Numbers numbers)
+{
+    switch (numbers)
+    {
+    case Numbers::standard:
+        d.Parse(str.c_str());
+        break;
+    case Numbers::full_precision:
+        d.Parse<kParseFullPrecisionFlag>(str.c_str());
+        break;
+    case Numbers::fast:
+        parse_fast_numbers(d, str.c_str());
+        break;
+    }
+}
+
+static void RapidString(benchmark::State& state, const char* filename, Numbers numbers)
+{
+    std::string str = ReadString(filename);
+
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        auto* d = new Document();
+        state.ResumeTiming();
+
+        RapidParse(*d, str, numbers);
+
+        state.PauseTiming();
+        delete d;
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        Document d;
+        RapidParse(d, str, numbers);
+        return d;
+    });
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// parse JSON from string, nlohmann
+//////////////////////////////////////////////////////////////////////////////
+
+static void NlohmannParse(json& j, const std::string& str, Numbers numbers)
+{
+    if (numbers == Numbers::fast)
+    {
+        parse_fast_numbers(j, str.c_str());
+    }
+    else
+    {
+        j = json::parse(str);
+    }
+}
+
+static void NlohmannString(benchmark::State& state, const char* filename, Numbers numbers)
+{
+    std::string str = ReadString(filename);
+
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        auto* j = new json();
+        state.ResumeTiming();
+
+        NlohmannParse(*j, str, numbers);
+
+        state.PauseTiming();
+        delete j;
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        json j;
+        NlohmannParse(j, str, numbers);
+        return j;
+    });
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// parse JSON from string, tape (number_parse built in)
+//////////////////////////////////////////////////////////////////////////////
+
+static void TapeString(benchmark::State& state, const char* filename)
+{
+    std::string str = ReadString(filename);
+    tape_parser parser;
+    tape_document document;
+
+    while (state.KeepRunning())
+    {
+        parser.parse(str, document);
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    state.SetLabel(simd_level_name(parser.level()));
+}
+
+#define NUMBER_PARSE_CAPTURES(name, filename) \
+    BENCHMARK_CAPTURE(RapidString,    name / standard,       filename, Numbers::standard); \
+    BENCHMARK_CAPTURE(RapidString,    name / full_precision, filename, Numbers::full_precision); \
+    BENCHMARK_CAPTURE(RapidString,    name / fast,           filename, Numbers::fast); \
+    BENCHMARK_CAPTURE(NlohmannString, name / standard,       filename, Numbers::standard); \
+    BENCHMARK_CAPTURE(NlohmannString, name / fast,           filename, Numbers::fast); \
+    BENCHMARK_CAPTURE(TapeString,     name,                  filename)
+
+NUMBER_PARSE_CAPTURES(canada,            "../data/nativejson-benchmark/canada.json");
+NUMBER_PARSE_CAPTURES(floats,            "../data/numbers/floats.json");
+NUMBER_PARSE_CAPTURES(signed_ints,       "../data/numbers/signed_ints.json");
+NUMBER_PARSE_CAPTURES(unsigned_ints,     "../data/numbers/unsigned_ints.json");
+NUMBER_PARSE_CAPTURES(small_signed_ints, "../data/numbers/small_signed_ints.json");
+
+//////////////////////////////////////////////////////////////////////////////
+// convert number tokens alone
+//////////////////////////////////////////////////////////////////////////////
+
+// Collects the text of every number in a document, NUL terminated for strtod.
+struct NumberCollector : BaseReaderHandler<UTF8<>, NumberCollector>
+{
+    bool RawNumber(const char* str, SizeType length, bool)
+    {
+        tokens.emplace_back(str, length);
+        return true;
+    }
+
+    std::vector<std::string> tokens;
+};
+
+static std::vector<std::string> ReadNumbers(const char* filename)
+{
+    std::string str = ReadString(filename);
+    StringStream ss(str.c_str());
+    NumberCollector collector;
+    Reader().Parse<kParseNumbersAsStringsFlag>(ss, collector);
+    return std::move(collector.tokens);
+}
+
+static void ConvertStrtod(benchmark::State& state, const char* filename)
+{
+    std::vector<std::string> tokens = ReadNumbers(filename);
+    size_t bytes = 0;
+    for (const std::string& token : tokens)
+    {
+        bytes += token.size();
+    }
+
+    while (state.KeepRunning())
+    {
+        for (const std::string& token : tokens)
+        {
+            benchmark::DoNotOptimize(std::strtod(token.c_str(), nullptr));
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.SetItemsProcessed(state.iterations() * tokens.size());
+}
+
+static void ConvertFast(benchmark::State& state, const char* filename)
+{
+    std::vector<std::string> tokens = ReadNumbers(filename);
+    size_t bytes = 0;
+    for (const std::string& token : tokens)
+    {
+        bytes += token.size();
+    }
+
+    while (state.KeepRunning())
+    {
+        for (const std::string& token : tokens)
+        {
+            parsed_number number;
+            parse_json_number(token.data(), token.data() + token.size(), number);
+            benchmark::DoNotOptimize(number);
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.SetItemsProcessed(state.iterations() * tokens.size());
+}
+
+BENCHMARK_CAPTURE(ConvertStrtod, canada,            "../data/nativejson-benchmark/canada.json");
+BENCHMARK_CAPTURE(ConvertStrtod, floats,            "../data/numbers/floats.json");
+BENCHMARK_CAPTURE(ConvertStrtod, signed_ints,       "../data/numbers/signed_ints.json");
+BENCHMARK_CAPTURE(ConvertFast,   canada,            "../data/nativejson-benchmark/canada.json");
+BENCHMARK_CAPTURE(ConvertFast,   floats,            "../data/numbers/floats.json");
+BENCHMARK_CAPTURE(ConvertFast,   signed_ints,       "../data/numbers/signed_ints.json");
+
+BENCHMARK_MAIN();
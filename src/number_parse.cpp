@@ -0,0 +1,339 @@
+#include "number_parse.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+inline bool is_digit(char c) {
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+// SWAR digit handling: eight ASCII digits in one little-endian word.
+
+inline uint64_t read8(const char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+inline bool is_eight_digits(uint64_t value) {
+    return (((value + 0x4646464646464646ULL) | (value - 0x3030303030303030ULL)) & 0x8080808080808080ULL) == 0;
+}
+
+inline uint32_t parse_eight_digits(uint64_t value) {
+    const uint64_t mask = 0x000000ff000000ffULL;
+    const uint64_t mul1 = 0x000f424000000064ULL; // 100 + (1000000 << 32)
+    const uint64_t mul2 = 0x0000271000000001ULL; // 1 + (10000 << 32)
+    value -= 0x3030303030303030ULL;
+    value = (value * 10) + (value >> 8);
+    value = (((value & mask) * mul1) + (((value >> 16) & mask) * mul2)) >> 32;
+    return static_cast<uint32_t>(value);
+}
+
+// Accumulates the digits at p into mantissa (wrapping past 19 digits, which
+// the caller detects from the count) and returns the end of the run.
+inline const char* parse_digits(const char* p, const char* last, uint64_t& mantissa) {
+    while (last - p >= 8) {
+        uint64_t chunk = read8(p);
+        if (!is_eight_digits(chunk)) {
+            break;
+        }
+        mantissa = mantissa * 100000000 + parse_eight_digits(chunk);
+        p += 8;
+    }
+    while (p != last && is_digit(*p)) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        ++p;
+    }
+    return p;
+}
+
+// The pieces of a decimal number, after syntax checking.
+struct decimal {
+    bool negative = false;
+    bool integer = true;
+    // The first 19 significant digits, and whether there were more.
+    uint64_t mantissa = 0;
+    bool truncated = false;
+    // value = mantissa * 10^exponent, approximately if truncated.
+    int64_t exponent = 0;
+};
+
+// Exact powers of ten as doubles, for Clinger's fast path.
+constexpr double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+const char* parse_decimal(const char* first, const char* last, decimal& number) {
+    const char* p = first;
+    if (p != last && *p == '-') {
+        number.negative = true;
+        ++p;
+    }
+    if (p == last || !is_digit(*p)) {
+        return nullptr;
+    }
+
+    const char* integer_begin = p;
+    if (*p == '0') {
+        ++p;
+    } else {
+        p = parse_digits(p, last, number.mantissa);
+    }
+    const char* integer_end = p;
+    int64_t digit_count = integer_end - integer_begin;
+
+    const char* fraction_begin = nullptr;
+    const char* fraction_end = nullptr;
+    if (p != last && *p == '.') {
+        ++p;
+        fraction_begin = p;
+        p = parse_digits(p, last, number.mantissa);
+        fraction_end = p;
+        if (fraction_begin == fraction_end) {
+            return nullptr;
+        }
+        number.exponent = -(fraction_end - fraction_begin);
+        digit_count += fraction_end - fraction_begin;
+        number.integer = false;
+    }
+
+    if (p != last && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negative_exponent = false;
+        if (p != last && (*p == '+' || *p == '-')) {
+            negative_exponent = *p == '-';
+            ++p;
+        }
+        if (p == last || !is_digit(*p)) {
+            return nullptr;
+        }
+        int64_t exponent = 0;
+        while (p != last && is_digit(*p)) {
+            // Anything this large is already zero or infinity.
+            if (exponent < 0x10000) {
+                exponent = exponent * 10 + (*p - '0');
+            }
+            ++p;
+        }
+        number.exponent += negative_exponent ? -exponent : exponent;
+        number.integer = false;
+    }
+
+    if (digit_count > 19) {
+        // Leading zeros (as in 0.000...) are not significant.
+        const char* q = integer_begin;
+        while (q != p && (*q == '0' || *q == '.')) {
+            digit_count -= *q == '0';
+            ++q;
+        }
+    }
+    if (digit_count > 19) {
+        // Keep the first 19 significant digits, and scale the exponent for
+        // the ones dropped.
+        number.truncated = true;
+        const uint64_t minimal_nineteen_digits = 1000000000000000000ULL;
+        uint64_t mantissa = 0;
+        const char* q = integer_begin;
+        while (mantissa < minimal_nineteen_digits && q != integer_end) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*q - '0');
+            ++q;
+        }
+        int64_t exponent_adjust;
+        if (mantissa >= minimal_nineteen_digits) {
+            exponent_adjust = integer_end - q;
+        } else {
+            q = fraction_begin;
+            while (mantissa < minimal_nineteen_digits && q != fraction_end) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*q - '0');
+                ++q;
+            }
+            exponent_adjust = fraction_begin - q;
+        }
+        number.exponent += (fraction_end - fraction_begin) + exponent_adjust;
+        number.mantissa = mantissa;
+    }
+    return p;
+}
+
+struct adjusted_mantissa {
+    uint64_t mantissa = 0;
+    // Biased binary exponent.
+    int32_t power2 = 0;
+
+    bool operator==(const adjusted_mantissa& other) const {
+        return mantissa == other.mantissa && power2 == other.power2;
+    }
+};
+
+constexpr int mantissa_explicit_bits = 52;
+constexpr int minimum_exponent = -1023;
+constexpr int infinite_power = 0x7ff;
+
+struct value128 {
+    uint64_t low;
+    uint64_t high;
+};
+
+inline value128 full_multiplication(uint64_t a, uint64_t b) {
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return value128{static_cast<uint64_t>(product), static_cast<uint64_t>(product >> 64)};
+}
+
+// floor(log2(10^q)) + 63, exact over the table's range.
+inline int32_t binary_power(int32_t q) {
+    return (((152170 + 65536) * q) >> 16) + 63;
+}
+
+// Eisel-Lemire: w * 10^q as a binary64 mantissa and exponent, from the high
+// bits of w * 5^q. The 128-bit product is always enough for w < 10^19
+// (Mushtak & Lemire, "Fast number parsing without fallback").
+adjusted_mantissa compute_float(int64_t q, uint64_t w) {
+    adjusted_mantissa answer;
+    if (w == 0 || q < smallest_power_of_ten) {
+        return answer;
+    }
+    if (q > largest_power_of_ten) {
+        answer.power2 = infinite_power;
+        return answer;
+    }
+
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+
+    const int bit_precision = mantissa_explicit_bits + 3;
+    const uint64_t precision_mask = ~uint64_t(0) >> bit_precision;
+    size_t index = 2 * static_cast<size_t>(q - smallest_power_of_ten);
+    value128 product = full_multiplication(w, power_of_five_128[index]);
+    if ((product.high & precision_mask) == precision_mask) {
+        value128 second = full_multiplication(w, power_of_five_128[index + 1]);
+        product.low += second.high;
+        if (second.high > product.low) {
+            ++product.high;
+        }
+    }
+
+    int upperbit = static_cast<int>(product.high >> 63);
+    int shift = upperbit + 64 - mantissa_explicit_bits - 3;
+    answer.mantissa = product.high >> shift;
+    answer.power2 = binary_power(static_cast<int32_t>(q)) + upperbit - lz - minimum_exponent;
+
+    if (answer.power2 <= 0) {
+        // Subnormal, or zero.
+        if (-answer.power2 + 1 >= 64) {
+            answer.power2 = 0;
+            answer.mantissa = 0;
+            return answer;
+        }
+        answer.mantissa >>= -answer.power2 + 1;
+        answer.mantissa += answer.mantissa & 1;
+        answer.mantissa >>= 1;
+        answer.power2 = answer.mantissa < (uint64_t(1) << mantissa_explicit_bits) ? 0 : 1;
+        return answer;
+    }
+
+    // Exactly halfway between two doubles can only happen for small q; round
+    // to even there.
+    if (product.low <= 1 && q >= -4 && q <= 23 && (answer.mantissa & 3) == 1 &&
+            (answer.mantissa << shift) == product.high) {
+        answer.mantissa &= ~uint64_t(1);
+    }
+
+    answer.mantissa += answer.mantissa & 1;
+    answer.mantissa >>= 1;
+    if (answer.mantissa >= (uint64_t(2) << mantissa_explicit_bits)) {
+        answer.mantissa = uint64_t(1) << mantissa_explicit_bits;
+        ++answer.power2;
+    }
+    answer.mantissa &= ~(uint64_t(1) << mantissa_explicit_bits);
+    if (answer.power2 >= infinite_power) {
+        answer.power2 = infinite_power;
+        answer.mantissa = 0;
+    }
+    return answer;
+}
+
+double strtod_fallback(const char* first, const char* last) {
+    std::string text(first, last);
+    return std::strtod(text.c_str(), nullptr);
+}
+
+double to_double(const decimal& number, const char* first, const char* last) {
+    if (!number.truncated && number.exponent >= -22 && number.exponent <= 22 &&
+            number.mantissa <= (uint64_t(1) << 53)) {
+        auto value = static_cast<double>(number.mantissa);
+        if (number.exponent < 0) {
+            value /= exact_powers_of_ten[-number.exponent];
+        } else {
+            value *= exact_powers_of_ten[number.exponent];
+        }
+        return number.negative ? -value : value;
+    }
+
+    adjusted_mantissa am = compute_float(number.exponent, number.mantissa);
+    if (number.truncated && !(am == compute_float(number.exponent, number.mantissa + 1))) {
+        return strtod_fallback(first, last);
+    }
+
+    uint64_t bits = am.mantissa | (static_cast<uint64_t>(am.power2) << mantissa_explicit_bits);
+    if (number.negative) {
+        bits |= uint64_t(1) << 63;
+    }
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+}
+
+const char* parse_json_number(const char* first, const char* last, parsed_number& number) {
+    decimal parsed;
+    const char* end = parse_decimal(first, last, parsed);
+    if (end == nullptr) {
+        return nullptr;
+    }
+
+    if (parsed.integer && !parsed.truncated) {
+        // At most 19 digits, so the mantissa is exact.
+        if (!parsed.negative) {
+            number.kind = number_kind::uint64;
+            number.u = parsed.mantissa;
+            return end;
+        }
+        if (parsed.mantissa <= uint64_t(1) << 63) {
+            number.kind = number_kind::int64;
+            number.i = static_cast<int64_t>(uint64_t(0) - parsed.mantissa);
+            return end;
+        }
+    } else if (parsed.integer && !parsed.negative && parsed.mantissa >= 1000000000000000000ULL &&
+            parsed.exponent == 1) {
+        // Twenty digits: fits if the full value does not overflow.
+        uint64_t value;
+        uint64_t last_digit = static_cast<uint64_t>(end[-1] - '0');
+        if (!__builtin_mul_overflow(parsed.mantissa, 10, &value) &&
+                !__builtin_add_overflow(value, last_digit, &value)) {
+            number.kind = number_kind::uint64;
+            number.u = value;
+            return end;
+        }
+    }
+
+    number.kind = number_kind::floating;
+    number.d = to_double(parsed, first, end);
+    return end;
+}
+
+const char* parse_json_double(const char* first, const char* last, double& value) {
+    decimal parsed;
+    const char* end = parse_decimal(first, last, parsed);
+    if (end != nullptr) {
+        value = to_double(parsed, first, end);
+    }
+    return end;
+}
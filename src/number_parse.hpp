@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Number parsing for the JSON readers, independent of any JSON library.
+//
+// Doubles are correctly rounded (bit-identical to a correct strtod): decimal
+// mantissas of up to 19 digits go through Clinger's exact fast path when they
+// can, and otherwise through the Eisel-Lemire algorithm, one 128-bit multiply
+// against a table of powers of five. Longer mantissas are truncated to 19
+// digits and bracketed; only when the bracket straddles a rounding boundary
+// does parsing fall back to strtod. Integer
+// digits are consumed eight at a time with SWAR arithmetic where the input
+// allows it.
+
+enum class number_kind {
+    int64,
+    uint64,
+    floating,
+};
+
+// A parsed JSON number, typed the way RapidJSON's Reader types them: integers
+// that fit stay integers (unsigned when non-negative), everything else, and
+// every number with a fraction or exponent, is a double.
+struct parsed_number {
+    number_kind kind;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+    };
+};
+
+// Parses one JSON number starting at first, reading no further than last.
+// Returns the end of the number, or nullptr if [first, last) does not start
+// with a valid JSON number. Trailing input is not examined.
+const char* parse_json_number(const char* first, const char* last, parsed_number& number);
+
+// As parse_json_number, always producing a double.
+const char* parse_json_double(const char* first, const char* last, double& value);
+
+// Eisel-Lemire's table.
+constexpr int smallest_power_of_ten = -342;
+constexpr int largest_power_of_ten = 308;
+extern const uint64_t power_of_five_128[];
@@ -0,0 +1,143 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <rapidjson/document.h>
+#include <string>
+
+#include "fast_numbers.hpp"
+#include "number_parse.hpp"
+
+using namespace rapidjson;
+
+static uint64_t bits_of(double d) {
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+static double fast_double(const std::string& text) {
+    double value = 0;
+    REQUIRE(parse_json_double(text.data(), text.data() + text.size(), value) == text.data() + text.size());
+    return value;
+}
+
+// glibc's strtod is correctly rounded, so it is the reference throughout.
+static void require_same_as_strtod(const std::string& text) {
+    CAPTURE(text);
+    REQUIRE(bits_of(fast_double(text)) == bits_of(std::strtod(text.c_str(), nullptr)));
+}
+
+TEST_CASE("doubles round trip bit for bit") {
+    std::mt19937_64 rng(1);
+    char buffer[64];
+    for (int i = 0; i < 200000; ++i) {
+        double d;
+        uint64_t bits = rng();
+        std::memcpy(&d, &bits, sizeof(d));
+        if (d != d || d - d != 0) {
+            continue;
+        }
+        // 17 significant digits always identify the double.
+        std::snprintf(buffer, sizeof(buffer), "%.17g", d);
+        CAPTURE(buffer);
+        REQUIRE(bits_of(fast_double(buffer)) == bits);
+
+        // Shorter forms land between doubles and must round correctly.
+        std::snprintf(buffer, sizeof(buffer), "%.*g", static_cast<int>(rng() % 16) + 1, d);
+        require_same_as_strtod(buffer);
+    }
+}
+
+TEST_CASE("hard doubles") {
+    for (const char* text : {"0", "-0.0", "0.1", "1e-400", "1e400", "9007199254740993", "9007199254740992.5",
+            "2.2250738585072011e-308", "2.2250738585072012e-308", "4.9406564584124654e-324",
+            "2.4703282292062327e-324", "2.4703282292062328e-324", "1.7976931348623157e308",
+            "1.7976931348623158e308", "1.7976931348623159e308", "7.3177701707893310e+15",
+            "0.000000000000000000000000000000000000000000001e-10", "123456789012345678901234567890e-30",
+            "9007199254740993.0000000000000000000000000000001", "1.00000000000000011102230246251565404236316680908203125",
+            "1.00000000000000011102230246251565404236316680908203124",
+            "1.00000000000000011102230246251565404236316680908203126"}) {
+        require_same_as_strtod(text);
+    }
+
+    std::mt19937_64 rng(2);
+    for (int i = 0; i < 100000; ++i) {
+        std::string text = "1";
+        for (int digits = static_cast<int>(rng() % 30); digits > 0; --digits) {
+            text += static_cast<char>('0' + rng() % 10);
+        }
+        text += '.';
+        for (int digits = static_cast<int>(rng() % 30) + 1; digits > 0; --digits) {
+            text += static_cast<char>('0' + rng() % 10);
+        }
+        text += "e" + std::to_string(static_cast<int>(rng() % 700) - 350);
+        require_same_as_strtod(text);
+    }
+}
+
+TEST_CASE("integers keep their type at the boundaries") {
+    struct expectation {
+        const char* text;
+        number_kind kind;
+    };
+    for (expectation e : {expectation{"0", number_kind::uint64}, {"-0", number_kind::int64},
+            {"18446744073709551615", number_kind::uint64}, {"18446744073709551616", number_kind::floating},
+            {"99999999999999999999", number_kind::floating}, {"10000000000000000000", number_kind::uint64},
+            {"-9223372036854775808", number_kind::int64}, {"-9223372036854775809", number_kind::floating},
+            {"1.0", number_kind::floating}, {"1e2", number_kind::floating}}) {
+        CAPTURE(e.text);
+        parsed_number number;
+        REQUIRE(parse_json_number(e.text, e.text + std::strlen(e.text), number) == e.text + std::strlen(e.text));
+        REQUIRE(number.kind == e.kind);
+    }
+
+    parsed_number number;
+    std::string text = "18446744073709551615";
+    parse_json_number(text.data(), text.data() + text.size(), number);
+    REQUIRE(number.u == UINT64_MAX);
+    text = "-9223372036854775808";
+    parse_json_number(text.data(), text.data() + text.size(), number);
+    REQUIRE(number.i == INT64_MIN);
+    text = "12345678901234567";
+    parse_json_number(text.data(), text.data() + text.size(), number);
+    REQUIRE(number.u == 12345678901234567ULL);
+}
+
+TEST_CASE("invalid numbers are rejected") {
+    for (const char* text : {"", "-", "+1", ".5", "1.", "1e", "1e+", "-a", "1.e5"}) {
+        CAPTURE(text);
+        double value;
+        REQUIRE(parse_json_double(text, text + std::strlen(text), value) == nullptr);
+    }
+
+    // A leading zero ends the number; the caller rejects what follows.
+    const char* text = "01";
+    double value;
+    REQUIRE(parse_json_double(text, text + 2, value) == text + 1);
+}
+
+TEST_CASE("adapters match full precision parsing") {
+    for (const char* filename : {"../data/nativejson-benchmark/canada.json",
+            "../data/nativejson-benchmark/citm_catalog.json", "../data/nativejson-benchmark/twitter.json"}) {
+        CAPTURE(filename);
+        std::ifstream f(filename);
+        std::string json((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        REQUIRE(!json.empty());
+
+        Document expected;
+        expected.Parse<kParseFullPrecisionFlag>(json.c_str());
+        Document fast;
+        REQUIRE(!parse_fast_numbers(fast, json.c_str()).IsError());
+        REQUIRE(fast == expected);
+
+        nlohmann::json built;
+        REQUIRE(!parse_fast_numbers(built, json.c_str()).IsError());
+        REQUIRE(built == nlohmann::json::parse(json));
+    }
+}
@@ -0,0 +1,249 @@
+#include <benchmark/benchmark.h>
+#include <string>
+
+#include "benchmark_counters.hpp"
+#include "orm_like.hpp"
+
+static const std::string address_json =
+        R"({"line_1":"111 W. 2nd St.","line_2":"#452","city":"Kansas City","state":"MO","zip":64111})";
+
+// Fails validation on its first member.
+static const std::string invalid_address_json =
+        R"({"line_1":111,"line_2":"#452","city":"Kansas City","state":"MO","zip":64111})";
+
+//////////////////////////////////////////////////////////////////////////////
+// decode and read every field
+//////////////////////////////////////////////////////////////////////////////
+
+static void FromJsonDom(benchmark::State& state)
+{
+    auto decode = [] {
+        address a = address::from_json(address_json);
+        benchmark::DoNotOptimize(a.line_1());
+        benchmark::DoNotOptimize(a.line_2());
+        benchmark::DoNotOptimize(a.city());
+        benchmark::DoNotOptimize(a.state());
+        benchmark::DoNotOptimize(a.zip());
+    };
+
+    while (state.KeepRunning())
+    {
+        decode();
+    }
+
+    state.SetBytesProcessed(state.iterations() * address_json.size());
+    report_allocations(state, decode);
+}
+BENCHMARK(FromJsonDom);
+
+static void FromJsonDomTwoPass(benchmark::State& state)
+{
+    auto decode = [] {
+        address a = address::from_json_two_pass(address_json);
+        benchmark::DoNotOptimize(a.line_1());
+        benchmark::DoNotOptimize(a.line_2());
+        benchmark::DoNotOptimize(a.city());
+        benchmark::DoNotOptimize(a.state());
+        benchmark::DoNotOptimize(a.zip());
+    };
+
+    while (state.KeepRunning())
+    {
+        decode();
+    }
+
+    state.SetBytesProcessed(state.iterations() * address_json.size());
+    report_allocations(state, decode);
+}
+BENCHMARK(FromJsonDomTwoPass);
+
+static void FromJsonDomCompiled(benchmark::State& state)
+{
+    auto decode = [] {
+        address a = address::from_json_compiled(address_json);
+        benchmark::DoNotOptimize(a.line_1());
+        benchmark::DoNotOptimize(a.line_2());
+        benchmark::DoNotOptimize(a.city());
+        benchmark::DoNotOptimize(a.state());
+        benchmark::DoNotOptimize(a.zip());
+    };
+
+    while (state.KeepRunning())
+    {
+        decode();
+    }
+
+    state.SetBytesProcessed(state.iterations() * address_json.size());
+    report_allocations(state, decode);
+}
+BENCHMARK(FromJsonDomCompiled);
+
+//////////////////////////////////////////////////////////////////////////////
+// reject invalid input
+//////////////////////////////////////////////////////////////////////////////
+
+static void FromJsonInvalid(benchmark::State& state, address (*from_json)(const std::string&))
+{
+    auto decode = [&] {
+        try
+        {
+            from_json(invalid_address_json);
+        }
+        catch (const std::runtime_error&)
+        {
+            return;
+        }
+        throw std::logic_error("invalid address was accepted");
+    };
+
+    while (state.KeepRunning())
+    {
+        decode();
+    }
+
+    state.SetBytesProcessed(state.iterations() * invalid_address_json.size());
+    report_allocations(state, decode);
+}
+BENCHMARK_CAPTURE(FromJsonInvalid, single_pass,     &address::from_json);
+BENCHMARK_CAPTURE(FromJsonInvalid, two_pass,        &address::from_json_two_pass);
+BENCHMARK_CAPTURE(FromJsonInvalid, compiled,        &address::from_json_compiled);
+
+static void FromJsonTyped(benchmark::State& state)
+{
+    auto decode = [] {
+        typed_address a = typed_address::from_json(address_json);
+        benchmark::DoNotOptimize(a.line_1);
+        benchmark::DoNotOptimize(a.line_2);
+        benchmark::DoNotOptimize(a.city);
+        benchmark::DoNotOptimize(a.state);
+        benchmark::DoNotOptimize(a.zip);
+    };
+
+    while (state.KeepRunning())
+    {
+        decode();
+    }
+
+    state.SetBytesProcessed(state.iterations() * address_json.size());
+    report_allocations(state, decode);
+}
+BENCHMARK(FromJsonTyped);
+
+//////////////////////////////////////////////////////////////////////////////
+// encode
+//////////////////////////////////////////////////////////////////////////////
+
+static void ToJsonDom(benchmark::State& state)
+{
+    address a = address::from_json(address_json);
+    auto encode = [&] {
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        a.to_json().Accept(writer);
+        benchmark::DoNotOptimize(buffer.GetString());
+    };
+
+    while (state.KeepRunning())
+    {
+        encode();
+    }
+
+    state.SetBytesProcessed(state.iterations() * address_json.size());
+    report_allocations(state, encode);
+}
+BENCHMARK(ToJsonDom);
+
+static void ToJsonTyped(benchmark::State& state)
+{
+    typed_address a = typed_address::from_json(address_json);
+    auto encode = [&] {
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        a.to_json(writer);
+        benchmark::DoNotOptimize(buffer.GetString());
+    };
+
+    while (state.KeepRunning())
+    {
+        encode();
+    }
+
+    state.SetBytesProcessed(state.iterations() * address_json.size());
+    report_allocations(state, encode);
+}
+BENCHMARK(ToJsonTyped);
+
+//////////////////////////////////////////////////////////////////////////////
+// change one field and encode again
+//////////////////////////////////////////////////////////////////////////////
+
+// Each iteration alternates zip between two values, so every setter call is a
+// real change.
+
+static void UpdateToJsonDom(benchmark::State& state)
+{
+    address a = address::from_json(address_json);
+    rapidjson::StringBuffer buffer;
+    uint32_t zip = 64111;
+    auto update = [&] {
+        zip ^= 1;
+        a.zip(zip);
+        buffer.Clear();
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        a.to_json().Accept(writer);
+        benchmark::DoNotOptimize(buffer.GetString());
+    };
+
+    while (state.KeepRunning())
+    {
+        update();
+    }
+
+    state.SetBytesProcessed(state.iterations() * address_json.size());
+    report_allocations(state, update);
+}
+BENCHMARK(UpdateToJsonDom);
+
+static void UpdateToJsonTyped(benchmark::State& state)
+{
+    typed_address a = typed_address::from_json(address_json);
+    rapidjson::StringBuffer buffer;
+    auto update = [&] {
+        a.zip ^= 1;
+        buffer.Clear();
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        a.to_json(writer);
+        benchmark::DoNotOptimize(buffer.GetString());
+    };
+
+    while (state.KeepRunning())
+    {
+        update();
+    }
+
+    state.SetBytesProcessed(state.iterations() * address_json.size());
+    report_allocations(state, update);
+}
+BENCHMARK(UpdateToJsonTyped);
+
+// Only zip is re-encoded; the rest of the cached text is reused.
+static void UpdateToJsonMutable(benchmark::State& state)
+{
+    mutable_address a = mutable_address::from_json(address_json);
+    a.to_json();
+    auto update = [&] {
+        a.zip(a.zip() ^ 1);
+        benchmark::DoNotOptimize(a.to_json().data());
+    };
+
+    while (state.KeepRunning())
+    {
+        update();
+    }
+
+    state.SetBytesProcessed(state.iterations() * address_json.size());
+    report_allocations(state, update);
+}
+BENCHMARK(UpdateToJsonMutable);
+
+BENCHMARK_MAIN();
@@ -1,109 +1,7 @@
 #define CATCH_CONFIG_MAIN
 #include <catch2/catch.hpp>
 
-#include <fmt/format.h>
-#include <string>
-#include <string_view>
-#include <rapidjson/document.h>
-#include <rapidjson/schema.h>
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/writer.h>
-#include <boost/preprocessor.hpp>
-
-const char* address_schema = R"({
-    "type": "object",
-    "properties": {
-        "line_1": {
-            "type": "string"
-        },
-        "line_2": {
-            "type": "string"
-        },
-        "city": {
-            "type": "string"
-        },
-        "state": {
-            "type": "string"
-        },
-        "zip": {
-            "type": "integer",
-            "minimum": "10000"
-        }
-    }
-})";
-
-rapidjson::SchemaDocument parse_schema_document(const char* schema) {
-    rapidjson::Document doc;
-    doc.Parse(schema);
-    if (doc.HasParseError()) {
-        throw std::runtime_error(fmt::format("Failed to parse json schema document: {} at {}", doc.GetParseError(),
-                doc.GetErrorOffset()));
-    }
-
-    return rapidjson::SchemaDocument(doc);
-}
-
-class message {
-public:
-    message()
-            :_document(rapidjson::kObjectType) { }
-
-    rapidjson::Document& to_json() {
-        return _document;
-    }
-
-protected:
-    rapidjson::Document _document;
-};
-
-#define MSG_PROP_STRING(name)\
-    std::string_view name() const {\
-        const auto& val = _document[#name];\
-        return std::string_view(val.GetString(), val.GetStringLength());\
-    }\
-    void name(const std::string& name) {\
-        _document.AddMember(#name, name, _document.GetAllocator());\
-    }\
-
-#define MSG_PROP_UINT32(name)\
-    uint32_t name() const {\
-        return _document[#name].GetInt();\
-    }\
-    void name(uint32_t name) {\
-        _document.AddMember(#name, name, _document.GetAllocator());\
-    }\
-
-class address : public message {
-public:
-
-    MSG_PROP_STRING(line_1);
-    MSG_PROP_STRING(line_2);
-    MSG_PROP_STRING(city);
-    MSG_PROP_STRING(state);
-    MSG_PROP_UINT32(zip);
-
-    static address from_json(const std::string& data) {
-        static const rapidjson::SchemaDocument schema = parse_schema_document(address_schema);
-
-        rapidjson::Document doc;
-        doc.Parse(data.data());
-        if (doc.HasParseError()) {
-            throw std::runtime_error(fmt::format("Failed to parse json schema document: {} at {}", doc.GetParseError(),
-                    doc.GetErrorOffset()));
-        }
-
-        rapidjson::SchemaValidator validator(schema);
-        if (!doc.Accept(validator)) {
-            rapidjson::StringBuffer buf;
-            validator.GetInvalidSchemaPointer().StringifyUriFragment(buf);
-            throw std::runtime_error(fmt::format("Failed to validate json document at: {}", buf.GetString()));
-        }
-
-        address a;
-        a._document = std::move(doc);
-        return a;
-    }
-};
+#include "orm_like.hpp"
 
 TEST_CASE("basic address") {
     const char* data = R"({
@@ -122,6 +20,58 @@ TEST_CASE("basic address") {
     REQUIRE(a.zip() == 64111);
 }
 
+TEST_CASE("invalid address") {
+    const char* data = R"({
+        "line_1": "111 W. 2nd St.",
+        "zip": "64111"
+    })";
+
+    REQUIRE_THROWS_WITH(address::from_json(data), "Failed to validate json document at: #/properties/zip");
+    REQUIRE_THROWS_WITH(address::from_json_two_pass(data), "Failed to validate json document at: #/properties/zip");
+    REQUIRE_THROWS_WITH(address::from_json_compiled(data), "Failed to validate json document at: #/properties/zip");
+    REQUIRE_THROWS_AS(address::from_json(R"({"line_1": )"), std::runtime_error);
+    REQUIRE_THROWS_AS(address::from_json_compiled(R"({"line_1": )"), std::runtime_error);
+}
+
+TEST_CASE("compiled address schema") {
+    const char* data = R"({"line_1": "111 W. 2nd St.", "country": {"code": "US"}, "zip": 64111})";
+    address a = address::from_json_compiled(data);
+    REQUIRE(a.line_1() == "111 W. 2nd St.");
+    REQUIRE(a.zip() == 64111);
+
+    // Failures name the same schema keyword and document location as
+    // SchemaValidator's.
+    const char* invalid[] = {
+        R"({"zip": "64111"})",
+        R"({"zip": 64111.5})",
+        R"({"city": ["Kansas City"]})",
+        R"(["111 W. 2nd St."])",
+    };
+    for (const char* json : invalid) {
+        rapidjson::Document expected_doc;
+        validation_result expected = validating_parse(expected_doc, json, address::schema());
+        rapidjson::Document actual_doc;
+        validation_result actual = compiled_validating_parse<compiled_orm_address>(actual_doc, json);
+        REQUIRE(!expected.valid);
+        REQUIRE(!actual.valid);
+        REQUIRE(actual.schema_pointer == expected.schema_pointer);
+        REQUIRE(actual.keyword == expected.keyword);
+        REQUIRE(actual.document_pointer == expected.document_pointer);
+    }
+}
+
+TEST_CASE("pooled validators are reset between uses") {
+    const char* invalid = R"({"zip": "64111"})";
+    const char* valid = R"({"city": "Kansas City", "zip": 64111})";
+
+    for (int i = 0; i < 2; ++i) {
+        REQUIRE_THROWS(address::from_json(invalid));
+        REQUIRE(address::from_json(valid).zip() == 64111);
+        REQUIRE_THROWS(address::from_json_two_pass(invalid));
+        REQUIRE(address::from_json_two_pass(valid).city() == "Kansas City");
+    }
+}
+
 TEST_CASE("set address") {
     const char* expected_data = R"({
         "line_1": "111 W. 2nd St.",
@@ -143,3 +93,96 @@ TEST_CASE("set address") {
 
     REQUIRE(actual == expected);
 }
+
+TEST_CASE("basic typed address") {
+    const char* data = R"({
+        "line_1": "111 W. 2nd St.",
+        "line_2": "#452",
+        "city": "Kansas City",
+        "state": "MO",
+        "country": {"code": "US", "aliases": ["USA", "United States"]},
+        "zip": 64111
+    })";
+
+    typed_address a = typed_address::from_json(data);
+    REQUIRE(a.line_1 == "111 W. 2nd St.");
+    REQUIRE(a.line_2 == "#452");
+    REQUIRE(a.city == "Kansas City");
+    REQUIRE(a.state == "MO");
+    REQUIRE(a.zip == 64111);
+}
+
+TEST_CASE("typed address round trip") {
+    typed_address a;
+    a.line_1 = "111 W. 2nd St.";
+    a.line_2 = "#452";
+    a.city = "Kansas City";
+    a.state = "MO";
+    a.zip = 64111;
+
+    rapidjson::Document actual;
+    actual.Parse(a.to_json().c_str());
+    rapidjson::Document expected;
+    expected.Parse(R"({"line_1":"111 W. 2nd St.","line_2":"#452","city":"Kansas City","state":"MO","zip":64111})");
+    REQUIRE(actual == expected);
+
+    typed_address b = typed_address::from_json(a.to_json());
+    REQUIRE(b.to_json() == a.to_json());
+}
+
+TEST_CASE("typed address rejects mistyped fields") {
+    REQUIRE_THROWS(typed_address::from_json(R"({"zip": "64111"})"));
+    REQUIRE_THROWS(typed_address::from_json(R"({"zip": -1})"));
+    REQUIRE_THROWS(typed_address::from_json(R"({"city": ["Kansas City"]})"));
+    REQUIRE_THROWS(typed_address::from_json(R"({"city": "Kansas City")"));
+}
+
+TEST_CASE("setting an address field twice replaces it") {
+    address a;
+    a.city("Kansas City");
+    a.zip(64111);
+    a.city("Overland Park");
+    a.zip(66204);
+
+    rapidjson::Document expected;
+    expected.Parse(R"({"city":"Overland Park","zip":66204})");
+    REQUIRE(a.to_json() == expected);
+    REQUIRE(a.to_json().MemberCount() == 2);
+}
+
+TEST_CASE("mutable address re-serializes changed fields") {
+    mutable_address a = mutable_address::from_json(
+            R"({"line_1":"111 W. 2nd St.","line_2":"#452","city":"Kansas City","state":"MO","zip":64111})");
+    REQUIRE(a.dirty());
+    REQUIRE(a.to_json() == R"({"line_1":"111 W. 2nd St.","line_2":"#452","city":"Kansas City","state":"MO","zip":64111})");
+    REQUIRE(!a.dirty());
+
+    a.zip(64111);
+    REQUIRE(!a.dirty());
+
+    a.line_2("Suite \"B\"");
+    a.zip(7);
+    REQUIRE(a.dirty());
+    REQUIRE(a.to_json() == R"({"line_1":"111 W. 2nd St.","line_2":"Suite \"B\"","city":"Kansas City","state":"MO","zip":7})");
+
+    a.line_1("");
+    a.state("Missouri");
+    REQUIRE(a.to_json() == R"({"line_1":"","line_2":"Suite \"B\"","city":"Kansas City","state":"Missouri","zip":7})");
+    REQUIRE(a.line_1().empty());
+    REQUIRE(a.zip() == 7);
+
+    typed_address round_trip = typed_address::from_json(a.to_json());
+    REQUIRE(round_trip.line_2 == "Suite \"B\"");
+    REQUIRE(round_trip.state == "Missouri");
+}
+
+TEST_CASE("mutable address copies keep their own cache") {
+    mutable_address a;
+    a.city("Kansas City");
+    std::string before = a.to_json();
+
+    mutable_address b = a;
+    b.city("Overland Park");
+    REQUIRE(b.to_json() == R"({"line_1":"","line_2":"","city":"Overland Park","state":"","zip":0})");
+    REQUIRE(a.to_json() == before);
+}
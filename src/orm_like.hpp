@@ -0,0 +1,146 @@
+#pragma once
+
+#include <fmt/format.h>
+#include <string>
+#include <string_view>
+#include <rapidjson/document.h>
+#include <rapidjson/schema.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include "compiled_schema.hpp"
+#include "compiled_schema/orm/address.hpp"
+#include "orm_mutable.hpp"
+#include "orm_struct.hpp"
+#include "schema_registry.hpp"
+#include "validating_parse.hpp"
+
+// schema/orm/address.json, also compiled into compiled_orm_address at build time.
+inline const char* address_schema = compiled_orm_address::source;
+
+class message {
+public:
+    message()
+            :_document(rapidjson::kObjectType) { }
+
+    rapidjson::Document& to_json() {
+        return _document;
+    }
+
+protected:
+    rapidjson::Document _document;
+};
+
+// Setters overwrite the member in place when it is already present.
+#define MSG_PROP_STRING(name)\
+    std::string_view name() const {\
+        const auto& val = _document[#name];\
+        return std::string_view(val.GetString(), val.GetStringLength());\
+    }\
+    void name(const std::string& name) {\
+        auto member = _document.FindMember(#name);\
+        if (member != _document.MemberEnd()) {\
+            member->value.SetString(name, _document.GetAllocator());\
+        } else {\
+            _document.AddMember(#name, name, _document.GetAllocator());\
+        }\
+    }\
+
+#define MSG_PROP_UINT32(name)\
+    uint32_t name() const {\
+        return _document[#name].GetInt();\
+    }\
+    void name(uint32_t name) {\
+        auto member = _document.FindMember(#name);\
+        if (member != _document.MemberEnd()) {\
+            member->value.SetUint(name);\
+        } else {\
+            _document.AddMember(#name, name, _document.GetAllocator());\
+        }\
+    }\
+
+class address : public message {
+public:
+
+    MSG_PROP_STRING(line_1);
+    MSG_PROP_STRING(line_2);
+    MSG_PROP_STRING(city);
+    MSG_PROP_STRING(state);
+    MSG_PROP_UINT32(zip);
+
+    // Registered in the global schema_registry as "orm/address" on first use.
+    static const rapidjson::SchemaDocument& schema() {
+        static const rapidjson::SchemaDocument& schema = schema_registry::global().add("orm/address", address_schema);
+        return schema;
+    }
+
+    // Validates while parsing, so invalid input is rejected at the first
+    // violation without building the rest of the document. The validator
+    // comes from the calling thread's pool rather than being built per call.
+    static address from_json(const std::string& data) {
+        auto pooled = acquire_validator<validating_document>(schema());
+
+        address a;
+        validation_result result = validating_parse(a._document, data.c_str(), *pooled);
+        if (!result.valid) {
+            throw std::runtime_error(fmt::format("Failed to validate json document at: {}", result.schema_pointer));
+        }
+        if (result.parse.IsError()) {
+            throw std::runtime_error(fmt::format("Failed to parse json schema document: {} at {}",
+                    result.parse.Code(), result.parse.Offset()));
+        }
+        return a;
+    }
+
+    // As from_json, validated by the schema compiled at build time instead of
+    // a SchemaValidator. Errors are reported the same way.
+    static address from_json_compiled(const std::string& data) {
+        address a;
+        validation_result result = compiled_validating_parse<compiled_orm_address>(a._document, data.c_str());
+        if (!result.valid) {
+            throw std::runtime_error(fmt::format("Failed to validate json document at: {}", result.schema_pointer));
+        }
+        if (result.parse.IsError()) {
+            throw std::runtime_error(fmt::format("Failed to parse json schema document: {} at {}",
+                    result.parse.Code(), result.parse.Offset()));
+        }
+        return a;
+    }
+
+    // Parses the whole document, then validates the DOM in a second pass.
+    static address from_json_two_pass(const std::string& data) {
+        rapidjson::Document doc;
+        doc.Parse(data.data());
+        if (doc.HasParseError()) {
+            throw std::runtime_error(fmt::format("Failed to parse json schema document: {} at {}", doc.GetParseError(),
+                    doc.GetErrorOffset()));
+        }
+
+        auto validator = acquire_validator(schema());
+        if (!doc.Accept(*validator)) {
+            rapidjson::StringBuffer buf;
+            validator->GetInvalidSchemaPointer().StringifyUriFragment(buf);
+            throw std::runtime_error(fmt::format("Failed to validate json document at: {}", buf.GetString()));
+        }
+
+        address a;
+        a._document = std::move(doc);
+        return a;
+    }
+};
+
+// The same message as address, decoded straight into typed fields.
+MSG_STRUCT(typed_address,
+    (std::string, line_1),
+    (std::string, line_2),
+    (std::string, city),
+    (std::string, state),
+    (uint32_t, zip))
+
+// The same message again, with dirty tracking and incremental re-serialization.
+MSG_MUTABLE(mutable_address,
+    (std::string, line_1),
+    (std::string, line_2),
+    (std::string, city),
+    (std::string, state),
+    (uint32_t, zip))
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <boost/preprocessor.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include "orm_struct.hpp"
+
+// Mutable messages for update-heavy use. Like MSG_STRUCT, each field has a
+// fixed, typed slot, but fields are reached through accessors so that setters
+// can track what changed:
+//
+//     MSG_MUTABLE(mutable_address,
+//         (std::string, line_1),
+//         (uint32_t, zip))
+//
+//     a.zip(64112);               // overwrites the slot, marks zip dirty
+//     const std::string& json = a.to_json();
+//
+// to_json() keeps the serialized form between calls, along with where each
+// field's value sits in it. Only the fields set since the last call are
+// re-encoded, and each is spliced over its old value; the rest of the text is
+// left as it was. A setter that stores the value a field already holds does
+// not mark it dirty.
+//
+// Field types are those of MSG_STRUCT, at most 64 per message. The JSON always
+// has every field, in declaration order, and from_json decodes as MSG_STRUCT's
+// does.
+
+// The serialized form of a MSG_MUTABLE message and the span of each field's
+// value within it.
+template <size_t FieldCount>
+class msg_json_cache {
+public:
+    bool built() const {
+        return !_json.empty();
+    }
+
+    const std::string& json() const {
+        return _json;
+    }
+
+    void begin() {
+        _json.assign(1, '{');
+    }
+
+    // Field names are C++ identifiers, so they need no escaping.
+    template <typename Value>
+    void append(size_t field, const char* name, const Value& value) {
+        if (field != 0) {
+            _json += ',';
+        }
+        _json += '"';
+        _json += name;
+        _json += "\":";
+        std::string_view encoded = encode(value);
+        _offsets[field] = _json.size();
+        _lengths[field] = encoded.size();
+        _json.append(encoded.data(), encoded.size());
+    }
+
+    void end() {
+        _json += '}';
+    }
+
+    // Re-encodes one field and splices it over the old value, moving the
+    // spans of the fields after it.
+    template <typename Value>
+    void replace(size_t field, const Value& value) {
+        std::string_view encoded = encode(value);
+        _json.replace(_offsets[field], _lengths[field], encoded.data(), encoded.size());
+        for (size_t i = field + 1; i < FieldCount; ++i) {
+            _offsets[i] = _offsets[i] + encoded.size() - _lengths[field];
+        }
+        _lengths[field] = encoded.size();
+    }
+
+private:
+    // Encodes into a per-thread buffer, valid until the next call.
+    template <typename Value>
+    static std::string_view encode(const Value& value) {
+        thread_local rapidjson::StringBuffer scratch;
+        scratch.Clear();
+        rapidjson::Writer<rapidjson::StringBuffer> writer(scratch);
+        msg_write(writer, value);
+        return std::string_view(scratch.GetString(), scratch.GetSize());
+    }
+
+    std::string _json;
+    size_t _offsets[FieldCount] = {};
+    size_t _lengths[FieldCount] = {};
+};
+
+#define MSG_MUTABLE_SLOT(field) BOOST_PP_CAT(_, MSG_STRUCT_FIELD_NAME(field))
+
+#define MSG_MUTABLE_ACCESSORS(r, data, i, field)\
+    const MSG_STRUCT_FIELD_TYPE(field)& MSG_STRUCT_FIELD_NAME(field)() const {\
+        return MSG_MUTABLE_SLOT(field);\
+    }\
+    void MSG_STRUCT_FIELD_NAME(field)(const MSG_STRUCT_FIELD_TYPE(field)& value) {\
+        if (!(MSG_MUTABLE_SLOT(field) == value)) {\
+            MSG_MUTABLE_SLOT(field) = value;\
+            _dirty |= uint64_t(1) << i;\
+        }\
+    }
+
+#define MSG_MUTABLE_DECLARE(r, data, field)\
+    MSG_STRUCT_FIELD_TYPE(field) MSG_MUTABLE_SLOT(field){};
+
+#define MSG_MUTABLE_CASE(r, data, i, field)\
+    case i: return fn(MSG_MUTABLE_SLOT(field));
+
+#define MSG_MUTABLE_APPEND(r, data, i, field)\
+    _json.append(i, BOOST_PP_STRINGIZE(MSG_STRUCT_FIELD_NAME(field)), MSG_MUTABLE_SLOT(field));
+
+#define MSG_MUTABLE_SPLICE(r, data, i, field)\
+    if (_dirty & (uint64_t(1) << i)) {\
+        _json.replace(i, MSG_MUTABLE_SLOT(field));\
+    }
+
+#define MSG_MUTABLE_IMPL(type, fields)\
+    class type {\
+    public:\
+        static constexpr size_t field_count = BOOST_PP_SEQ_SIZE(fields);\
+        static_assert(field_count <= 64, "MSG_MUTABLE messages have at most 64 fields");\
+        \
+        static constexpr const char* field_names[] = {\
+            BOOST_PP_SEQ_FOR_EACH_I(MSG_STRUCT_NAME, _, fields)\
+        };\
+        \
+        static int field_index(const char* key, size_t length) {\
+            BOOST_PP_SEQ_FOR_EACH_I(MSG_STRUCT_INDEX, _, fields)\
+            return -1;\
+        }\
+        \
+        BOOST_PP_SEQ_FOR_EACH_I(MSG_MUTABLE_ACCESSORS, _, fields)\
+        \
+        /* Whether any field was set since the last to_json(). */\
+        bool dirty() const {\
+            return _dirty != 0 || !_json.built();\
+        }\
+        \
+        static type from_json(const char* data) {\
+            type message;\
+            rapidjson::StringStream ss(data);\
+            msg_decode(ss, message);\
+            return message;\
+        }\
+        \
+        static type from_json(const std::string& data) {\
+            return from_json(data.c_str());\
+        }\
+        \
+        /* Valid until the message is next changed or destroyed. */\
+        const std::string& to_json() {\
+            if (!_json.built()) {\
+                _json.begin();\
+                BOOST_PP_SEQ_FOR_EACH_I(MSG_MUTABLE_APPEND, _, fields)\
+                _json.end();\
+            } else if (_dirty != 0) {\
+                BOOST_PP_SEQ_FOR_EACH_I(MSG_MUTABLE_SPLICE, _, fields)\
+            }\
+            _dirty = 0;\
+            return _json.json();\
+        }\
+        \
+    private:\
+        template <typename>\
+        friend class msg_reader_handler;\
+        \
+        /* For the decoder, which fills a message whose cache is not built yet. */\
+        template <typename Fn>\
+        bool with_field(int index, Fn&& fn) {\
+            switch (index) {\
+            BOOST_PP_SEQ_FOR_EACH_I(MSG_MUTABLE_CASE, _, fields)\
+            default: return false;\
+            }\
+        }\
+        \
+        BOOST_PP_SEQ_FOR_EACH(MSG_MUTABLE_DECLARE, _, fields)\
+        uint64_t _dirty = 0;\
+        msg_json_cache<field_count> _json;\
+    };
+
+#define MSG_MUTABLE(type, ...) MSG_MUTABLE_IMPL(type, BOOST_PP_VARIADIC_TO_SEQ(__VA_ARGS__))
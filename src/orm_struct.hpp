@@ -0,0 +1,357 @@
+#pragma once
+
+#include <boost/preprocessor.hpp>
+#include <cstdint>
+#include <cstring>
+#include <fmt/format.h>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <rapidjson/reader.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+// DOM-free successor to MSG_PROP_*: a message is a plain struct with typed
+// fields, decoded straight from RapidJSON's SAX Reader into the fields and
+// encoded straight to a Writer. There is no intermediate Document and no
+// string-keyed lookup on access.
+//
+//     MSG_STRUCT(typed_address,
+//         (std::string, line_1),
+//         (uint32_t, zip))
+//
+// Fields may be std::string, bool, int32_t, uint32_t, int64_t, uint64_t or
+// double. Unknown keys in the input are skipped, missing ones keep their
+// default value, and a value of the wrong JSON type (or out of range for the
+// field) fails the decode.
+
+// Field assignment, one function per SAX value kind. The templates are the
+// type-mismatch fallbacks; the exact overloads below win for supported fields.
+
+template <typename Field>
+bool msg_assign_string(Field&, std::string_view) { return false; }
+
+template <typename Field>
+bool msg_assign_bool(Field&, bool) { return false; }
+
+template <typename Field>
+bool msg_assign_signed(Field&, int64_t) { return false; }
+
+template <typename Field>
+bool msg_assign_unsigned(Field&, uint64_t) { return false; }
+
+template <typename Field>
+bool msg_assign_double(Field&, double) { return false; }
+
+inline bool msg_assign_string(std::string& field, std::string_view value) {
+    field.assign(value.data(), value.size());
+    return true;
+}
+
+inline bool msg_assign_bool(bool& field, bool value) {
+    field = value;
+    return true;
+}
+
+inline bool msg_assign_signed(int32_t& field, int64_t value) {
+    if (value < std::numeric_limits<int32_t>::min() || value > std::numeric_limits<int32_t>::max()) {
+        return false;
+    }
+    field = static_cast<int32_t>(value);
+    return true;
+}
+
+inline bool msg_assign_unsigned(int32_t& field, uint64_t value) {
+    return value <= static_cast<uint64_t>(std::numeric_limits<int32_t>::max()) && msg_assign_signed(field, static_cast<int64_t>(value));
+}
+
+inline bool msg_assign_unsigned(uint32_t& field, uint64_t value) {
+    if (value > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+    field = static_cast<uint32_t>(value);
+    return true;
+}
+
+inline bool msg_assign_signed(uint32_t& field, int64_t value) {
+    return value >= 0 && msg_assign_unsigned(field, static_cast<uint64_t>(value));
+}
+
+inline bool msg_assign_signed(int64_t& field, int64_t value) {
+    field = value;
+    return true;
+}
+
+inline bool msg_assign_unsigned(int64_t& field, uint64_t value) {
+    if (value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+        return false;
+    }
+    field = static_cast<int64_t>(value);
+    return true;
+}
+
+inline bool msg_assign_signed(uint64_t& field, int64_t value) {
+    if (value < 0) {
+        return false;
+    }
+    field = static_cast<uint64_t>(value);
+    return true;
+}
+
+inline bool msg_assign_unsigned(uint64_t& field, uint64_t value) {
+    field = value;
+    return true;
+}
+
+inline bool msg_assign_signed(double& field, int64_t value) {
+    field = static_cast<double>(value);
+    return true;
+}
+
+inline bool msg_assign_unsigned(double& field, uint64_t value) {
+    field = static_cast<double>(value);
+    return true;
+}
+
+inline bool msg_assign_double(double& field, double value) {
+    field = value;
+    return true;
+}
+
+// Field encoding.
+
+template <typename Writer>
+void msg_write(Writer& writer, const std::string& value) {
+    writer.String(value.data(), static_cast<rapidjson::SizeType>(value.size()));
+}
+
+template <typename Writer>
+void msg_write(Writer& writer, bool value) {
+    writer.Bool(value);
+}
+
+template <typename Writer>
+void msg_write(Writer& writer, int32_t value) {
+    writer.Int(value);
+}
+
+template <typename Writer>
+void msg_write(Writer& writer, uint32_t value) {
+    writer.Uint(value);
+}
+
+template <typename Writer>
+void msg_write(Writer& writer, int64_t value) {
+    writer.Int64(value);
+}
+
+template <typename Writer>
+void msg_write(Writer& writer, uint64_t value) {
+    writer.Uint64(value);
+}
+
+template <typename Writer>
+void msg_write(Writer& writer, double value) {
+    writer.Double(value);
+}
+
+// SAX handler that decodes one top-level object into a MSG_STRUCT. Nested
+// values under unknown keys are skipped by depth counting.
+template <typename Message>
+class msg_reader_handler {
+public:
+    explicit msg_reader_handler(Message& message)
+            :_message(message) { }
+
+    bool Null() {
+        return skipping() || unknown_field() || mismatch();
+    }
+
+    bool Bool(bool b) {
+        return scalar([&](auto& field) { return msg_assign_bool(field, b); });
+    }
+
+    bool Int(int i) {
+        return scalar([&](auto& field) { return msg_assign_signed(field, i); });
+    }
+
+    bool Uint(unsigned u) {
+        return scalar([&](auto& field) { return msg_assign_unsigned(field, u); });
+    }
+
+    bool Int64(int64_t i) {
+        return scalar([&](auto& field) { return msg_assign_signed(field, i); });
+    }
+
+    bool Uint64(uint64_t u) {
+        return scalar([&](auto& field) { return msg_assign_unsigned(field, u); });
+    }
+
+    bool Double(double d) {
+        return scalar([&](auto& field) { return msg_assign_double(field, d); });
+    }
+
+    bool RawNumber(const char*, rapidjson::SizeType, bool) {
+        return false;
+    }
+
+    bool String(const char* str, rapidjson::SizeType length, bool) {
+        return scalar([&](auto& field) { return msg_assign_string(field, std::string_view(str, length)); });
+    }
+
+    bool StartObject() {
+        return start_container();
+    }
+
+    bool Key(const char* str, rapidjson::SizeType length, bool) {
+        if (_depth == 1) {
+            _field = Message::field_index(str, length);
+        }
+        return true;
+    }
+
+    bool EndObject(rapidjson::SizeType) {
+        --_depth;
+        return true;
+    }
+
+    bool StartArray() {
+        return _depth != 0 && start_container();
+    }
+
+    bool EndArray(rapidjson::SizeType) {
+        --_depth;
+        return true;
+    }
+
+    // Name of the field whose value had the wrong type, if that ended the parse.
+    const char* mismatched_field() const {
+        return _mismatched;
+    }
+
+private:
+    bool skipping() const {
+        return _depth > 1;
+    }
+
+    bool unknown_field() const {
+        return _depth == 1 && _field < 0;
+    }
+
+    bool mismatch() {
+        _mismatched = _depth == 1 ? Message::field_names[_field] : "(root)";
+        return false;
+    }
+
+    template <typename Assign>
+    bool scalar(Assign&& assign) {
+        if (skipping() || unknown_field()) {
+            return true;
+        }
+        if (_depth == 0 || !_message.with_field(_field, assign)) {
+            return mismatch();
+        }
+        return true;
+    }
+
+    bool start_container() {
+        if (_depth == 1 && _field >= 0) {
+            return mismatch();
+        }
+        ++_depth;
+        return true;
+    }
+
+    Message& _message;
+    unsigned _depth = 0;
+    int _field = -1;
+    const char* _mismatched = nullptr;
+};
+
+template <typename Message, typename InputStream>
+void msg_decode(InputStream& is, Message& message) {
+    msg_reader_handler<Message> handler(message);
+    rapidjson::Reader reader;
+    rapidjson::ParseResult result = reader.Parse(is, handler);
+    if (result.IsError()) {
+        if (handler.mismatched_field() != nullptr) {
+            throw std::runtime_error(fmt::format("Failed to decode json message: invalid value for {} at {}",
+                    handler.mismatched_field(), result.Offset()));
+        }
+        throw std::runtime_error(fmt::format("Failed to parse json message: {} at {}", result.Code(),
+                result.Offset()));
+    }
+}
+
+#define MSG_STRUCT_FIELD_TYPE(field) BOOST_PP_TUPLE_ELEM(2, 0, field)
+#define MSG_STRUCT_FIELD_NAME(field) BOOST_PP_TUPLE_ELEM(2, 1, field)
+
+#define MSG_STRUCT_DECLARE(r, data, field)\
+    MSG_STRUCT_FIELD_TYPE(field) MSG_STRUCT_FIELD_NAME(field){};
+
+#define MSG_STRUCT_NAME(r, data, i, field)\
+    BOOST_PP_COMMA_IF(i) BOOST_PP_STRINGIZE(MSG_STRUCT_FIELD_NAME(field))
+
+#define MSG_STRUCT_INDEX(r, data, i, field)\
+    if (length == sizeof(BOOST_PP_STRINGIZE(MSG_STRUCT_FIELD_NAME(field))) - 1 &&\
+            std::memcmp(key, BOOST_PP_STRINGIZE(MSG_STRUCT_FIELD_NAME(field)), length) == 0) {\
+        return i;\
+    }
+
+#define MSG_STRUCT_CASE(r, data, i, field)\
+    case i: return fn(MSG_STRUCT_FIELD_NAME(field));
+
+#define MSG_STRUCT_WRITE(r, data, field)\
+    writer.Key(BOOST_PP_STRINGIZE(MSG_STRUCT_FIELD_NAME(field)),\
+            sizeof(BOOST_PP_STRINGIZE(MSG_STRUCT_FIELD_NAME(field))) - 1);\
+    msg_write(writer, MSG_STRUCT_FIELD_NAME(field));
+
+#define MSG_STRUCT_IMPL(type, fields)\
+    struct type {\
+        BOOST_PP_SEQ_FOR_EACH(MSG_STRUCT_DECLARE, _, fields)\
+        \
+        static constexpr const char* field_names[] = {\
+            BOOST_PP_SEQ_FOR_EACH_I(MSG_STRUCT_NAME, _, fields)\
+        };\
+        \
+        static int field_index(const char* key, size_t length) {\
+            BOOST_PP_SEQ_FOR_EACH_I(MSG_STRUCT_INDEX, _, fields)\
+            return -1;\
+        }\
+        \
+        template <typename Fn>\
+        bool with_field(int index, Fn&& fn) {\
+            switch (index) {\
+            BOOST_PP_SEQ_FOR_EACH_I(MSG_STRUCT_CASE, _, fields)\
+            default: return false;\
+            }\
+        }\
+        \
+        static type from_json(const char* data) {\
+            type message;\
+            rapidjson::StringStream ss(data);\
+            msg_decode(ss, message);\
+            return message;\
+        }\
+        \
+        static type from_json(const std::string& data) {\
+            return from_json(data.c_str());\
+        }\
+        \
+        template <typename Writer>\
+        void to_json(Writer& writer) const {\
+            writer.StartObject();\
+            BOOST_PP_SEQ_FOR_EACH(MSG_STRUCT_WRITE, _, fields)\
+            writer.EndObject();\
+        }\
+        \
+        std::string to_json() const {\
+            rapidjson::StringBuffer buffer;\
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);\
+            to_json(writer);\
+            return std::string(buffer.GetString(), buffer.GetSize());\
+        }\
+    };
+
+#define MSG_STRUCT(type, ...) MSG_STRUCT_IMPL(type, BOOST_PP_VARIADIC_TO_SEQ(__VA_ARGS__))
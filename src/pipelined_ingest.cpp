@@ -0,0 +1,250 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "data_generator.hpp"
+#include "ingest_pipeline.hpp"
+
+namespace fs = std::filesystem;
+
+TEST_CASE("every item pushed by several producers is popped exactly once") {
+    const size_t producers = 4;
+    const size_t consumers = 4;
+    const size_t per_producer = 50000;
+
+    // Small, so producers and consumers keep meeting a full or empty queue.
+    bounded_queue<size_t> queue(16);
+    std::vector<std::atomic<unsigned>> seen(producers * per_producer);
+    std::atomic<size_t> popped{0};
+
+    std::vector<std::thread> consuming;
+    for (size_t c = 0; c < consumers; ++c) {
+        consuming.emplace_back([&] {
+            size_t item;
+            while (queue.pop(item)) {
+                seen[item].fetch_add(1, std::memory_order_relaxed);
+                popped.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    std::vector<std::thread> producing;
+    for (size_t p = 0; p < producers; ++p) {
+        producing.emplace_back([&, p] {
+            for (size_t i = 0; i < per_producer; ++i) {
+                queue.push(p * per_producer + i);
+            }
+        });
+    }
+
+    for (auto& thread : producing) {
+        thread.join();
+    }
+    queue.close();
+    for (auto& thread : consuming) {
+        thread.join();
+    }
+
+    REQUIRE(popped == producers * per_producer);
+    size_t wrong = 0;
+    for (const auto& count : seen) {
+        wrong += count != 1;
+    }
+    CHECK(wrong == 0);
+}
+
+TEST_CASE("try_push and try_pop fail at the capacity bounds") {
+    // Rounded up to 4.
+    bounded_queue<std::unique_ptr<int>> queue(3);
+    std::unique_ptr<int> value;
+    CHECK(!queue.try_pop(value));
+
+    for (int i = 0; i < 4; ++i) {
+        auto item = std::make_unique<int>(i);
+        REQUIRE(queue.try_push(std::move(item)));
+        CHECK(!item);
+    }
+    auto extra = std::make_unique<int>(4);
+    CHECK(!queue.try_push(std::move(extra)));
+    // Not moved from when the push fails.
+    REQUIRE(extra);
+    CHECK(*extra == 4);
+
+    // First in, first out, and the slots are reusable.
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.try_pop(value));
+        CHECK(*value == i);
+        REQUIRE(queue.try_push(std::make_unique<int>(10 + i)));
+    }
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.try_pop(value));
+        CHECK(*value == 10 + i);
+    }
+    CHECK(!queue.try_pop(value));
+}
+
+TEST_CASE("pop drains a closed queue, then returns false") {
+    bounded_queue<int> queue(8);
+    queue.push(1);
+    queue.push(2);
+    queue.push(3);
+    queue.close();
+
+    int value = 0;
+    for (int expected = 1; expected <= 3; ++expected) {
+        REQUIRE(queue.pop(value));
+        CHECK(value == expected);
+    }
+    CHECK(!queue.pop(value));
+    CHECK(!queue.pop(value));
+}
+
+TEST_CASE("closing wakes consumers waiting on an empty queue") {
+    bounded_queue<int> queue(4);
+    std::atomic<int> finished{0};
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < 3; ++i) {
+        consumers.emplace_back([&] {
+            int value;
+            while (queue.pop(value)) {
+            }
+            finished.fetch_add(1);
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(finished == 0);
+    queue.close();
+    for (auto& thread : consumers) {
+        thread.join();
+    }
+    CHECK(finished == 3);
+}
+
+// A directory tree of generated messages, removed again on destruction.
+class message_tree {
+public:
+    message_tree() {
+        char name[] = "/tmp/pipelined_ingestXXXXXX";
+        REQUIRE(mkdtemp(name) != nullptr);
+        _root = name;
+
+        std::vector<std::string> messages = generate_messages(default_corpus_seed, 120, 64, 256 << 10);
+        for (size_t i = 0; i < messages.size(); ++i) {
+            fs::path directory = _root / fmt::format("{}", i % 5) / fmt::format("{}", i % 3);
+            fs::create_directories(directory);
+            std::ofstream(directory / fmt::format("message_{}.json", i), std::ios::binary) << messages[i];
+        }
+        // Empty, and not JSON: the first is listed, the second is not.
+        std::ofstream(_root / "empty.json");
+        std::ofstream(_root / "notes.txt") << "not listed";
+    }
+
+    ~message_tree() {
+        fs::remove_all(_root);
+    }
+
+    std::string root() const {
+        return _root.string();
+    }
+
+private:
+    fs::path _root;
+};
+
+static std::string read_file(const std::string& filename) {
+    std::ifstream f(filename, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+TEST_CASE("pipelined ingest sees the same files and bytes as reading them in turn") {
+    message_tree tree;
+    std::vector<std::string> files = list_json_files(tree.root(), 64 << 20);
+    REQUIRE(files.size() == 121);
+
+    std::vector<std::string> expected;
+    size_t expected_bytes = 0;
+    for (const std::string& file : files) {
+        expected.push_back(read_file(file));
+        expected_bytes += expected.back().size();
+    }
+
+    struct shape {
+        size_t readers, workers, buffers, read_size;
+    };
+    for (shape s : {shape{1, 1, 0, 0}, shape{1, 4, 0, 0}, shape{2, 3, 0, 4096}, shape{3, 2, 1, 0},
+            shape{2, 0, 0, 0}}) {
+        ingest_options options;
+        options.readers = s.readers;
+        options.workers = s.workers;
+        options.buffers = s.buffers;
+        options.read_size = s.read_size;
+        ingest_pipeline pipeline(options);
+
+        // Twice, so the second run reuses buffers grown by the first.
+        for (int run = 0; run < 2; ++run) {
+            std::vector<std::string> actual(files.size());
+            std::vector<std::atomic<unsigned>> handled(files.size());
+            std::atomic<bool> bad_worker{false};
+            ingest_stats stats = pipeline.run(files, [&](ingest_buffer& buffer, size_t worker) {
+                if (worker >= pipeline.workers() || buffer.data[buffer.size] != '\0') {
+                    bad_worker = true;
+                }
+                handled[buffer.file].fetch_add(1, std::memory_order_relaxed);
+                actual[buffer.file].assign(buffer.view());
+                return true;
+            });
+
+            CHECK(stats.files == files.size());
+            CHECK(stats.bytes == expected_bytes);
+            CHECK(stats.read_errors == 0);
+            CHECK(stats.rejected == 0);
+            CHECK(!bad_worker);
+            for (size_t i = 0; i < files.size(); ++i) {
+                REQUIRE(handled[i] == 1);
+                REQUIRE(actual[i] == expected[i]);
+            }
+        }
+    }
+}
+
+TEST_CASE("unreadable and rejected files are counted, not fatal") {
+    message_tree tree;
+    std::vector<std::string> files = list_json_files(tree.root(), 64 << 20);
+    files.insert(files.begin() + 10, tree.root() + "/missing.json");
+    files.push_back(tree.root() + "/also_missing.json");
+
+    ingest_options options;
+    options.workers = 2;
+    ingest_pipeline pipeline(options);
+    ingest_stats stats = pipeline.run(files, [](ingest_buffer& buffer, size_t) {
+        return buffer.size != 0;
+    });
+
+    // The empty file is read, and rejected by the handler.
+    CHECK(stats.read_errors == 2);
+    CHECK(stats.files == files.size() - 2);
+    CHECK(stats.rejected == 1);
+}
+
+TEST_CASE("list_json_files skips files over the size limit") {
+    message_tree tree;
+    std::vector<std::string> all = list_json_files(tree.root(), 64 << 20);
+    std::vector<std::string> small = list_json_files(tree.root(), 1024);
+    CHECK(!small.empty());
+    CHECK(small.size() < all.size());
+    for (const std::string& file : small) {
+        CHECK(fs::file_size(file) <= 1024);
+    }
+}
@@ -0,0 +1,219 @@
+#include "profile.hpp"
+
+#include <chrono>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef JSON_COMPARISON_PROFILE
+#if defined(__x86_64__) || defined(__i386__)
+
+// TSC ticks per nanosecond, measured once against steady_clock. Any processor
+// recent enough to run these benchmarks has an invariant TSC, so the rate is
+// fixed whatever the core's frequency does.
+double ticks_per_ns() {
+    static const double rate = [] {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t start_ticks = __rdtsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t end_ticks = __rdtsc();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        return static_cast<double>(end_ticks - start_ticks) / static_cast<double>(ns);
+    }();
+    return rate;
+}
+
+#else
+
+double ticks_per_ns() {
+    return 1.0;
+}
+
+#endif
+#endif
+
+#ifdef __linux__
+
+struct counter_config {
+    uint32_t type;
+    uint64_t config;
+};
+
+// In hw_counter order.
+const counter_config counter_configs[hw_counter_count] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+int open_counter(const counter_config& config) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = config.type;
+    attr.config = config.config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+#endif
+
+}
+
+const char* phase_name(phase p) {
+    switch (p) {
+    case phase::read:
+        return "read";
+    case phase::tokenize:
+        return "tokenize";
+    case phase::number_parse:
+        return "number_parse";
+    case phase::dom_build:
+        return "dom_build";
+    case phase::validate:
+        return "validate";
+    case phase::serialize:
+        return "serialize";
+    }
+    return "unknown";
+}
+
+phase_totals thread_phase_totals() {
+    phase_totals totals;
+#ifdef JSON_COMPARISON_PROFILE
+    double rate = ticks_per_ns();
+    for (size_t i = 0; i < phase_count; ++i) {
+        totals.ns[i] = static_cast<uint64_t>(static_cast<double>(phase_scope::_state.ticks[i]) / rate);
+    }
+#endif
+    return totals;
+}
+
+void reset_thread_phases() {
+#ifdef JSON_COMPARISON_PROFILE
+    // Calibrate now rather than in the middle of a measurement.
+    ticks_per_ns();
+    int current = phase_scope::_state.current;
+    phase_scope::_state = {};
+    phase_scope::_state.current = current;
+    phase_scope::_state.since = phase_scope::ticks();
+#endif
+}
+
+const char* hw_counter_name(hw_counter c) {
+    switch (c) {
+    case hw_counter::cycles:
+        return "cycles";
+    case hw_counter::instructions:
+        return "instructions";
+    case hw_counter::branch_misses:
+        return "branch_misses";
+    case hw_counter::l1d_misses:
+        return "l1d_misses";
+    case hw_counter::llc_misses:
+        return "llc_misses";
+    }
+    return "unknown";
+}
+
+perf_counters::perf_counters() {
+    for (size_t i = 0; i < hw_counter_count; ++i) {
+#ifdef __linux__
+        _fds[i] = open_counter(counter_configs[i]);
+#else
+        _fds[i] = -1;
+#endif
+    }
+}
+
+perf_counters::~perf_counters() {
+#ifdef __linux__
+    for (int fd : _fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+bool perf_counters::available() const {
+    for (int fd : _fds) {
+        if (fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void perf_counters::start() {
+#ifdef __linux__
+    for (int fd : _fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+void perf_counters::stop() {
+    pause();
+#ifdef __linux__
+    for (size_t i = 0; i < hw_counter_count; ++i) {
+        // value, time enabled, time running
+        uint64_t read_values[3] = {};
+        _values[i] = 0;
+        if (_fds[i] < 0 || read(_fds[i], read_values, sizeof(read_values)) != sizeof(read_values)) {
+            continue;
+        }
+        if (read_values[2] > 0 && read_values[2] < read_values[1]) {
+            double scale = static_cast<double>(read_values[1]) / static_cast<double>(read_values[2]);
+            _values[i] = static_cast<uint64_t>(static_cast<double>(read_values[0]) * scale);
+        } else {
+            _values[i] = read_values[0];
+        }
+    }
+#endif
+}
+
+void perf_counters::pause() {
+#ifdef __linux__
+    for (int fd : _fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+#endif
+}
+
+void perf_counters::resume() {
+#ifdef __linux__
+    for (int fd : _fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+std::optional<uint64_t> perf_counters::value(hw_counter c) const {
+    auto i = static_cast<size_t>(c);
+    if (_fds[i] < 0) {
+        return std::nullopt;
+    }
+    return _values[i];
+}
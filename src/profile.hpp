@@ -0,0 +1,264 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <rapidjson/document.h>
+#include <rapidjson/reader.h>
+#include <string>
+
+#ifdef JSON_COMPARISON_PROFILE
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+// Where parse and serialize time goes. Code on the hot paths marks the phase
+// it is in with a phase_scope, and each thread accumulates the time spent in
+// every phase. Phases nest exclusively: entering number_parse from tokenize
+// stops tokenize's clock until number_parse ends, so the phases of a run add
+// up to the time spent inside any of them.
+//
+// Timing is compiled in only with JSON_COMPARISON_PROFILE (the CMake option of
+// the same name). Without it phase_scope is an empty object and phase_handler
+// a plain forwarder, so the instrumented code is unchanged. With it every
+// phase switch reads the clock, which slows fine-grained phases (a switch per
+// number or per DOM event) noticeably: compare phases within a profiled run,
+// not profiled runs with unprofiled ones.
+enum class phase {
+    read,
+    tokenize,
+    number_parse,
+    dom_build,
+    validate,
+    serialize,
+};
+
+constexpr size_t phase_count = 6;
+
+const char* phase_name(phase p);
+
+struct phase_totals {
+    uint64_t ns[phase_count] = {};
+};
+
+// The calling thread's totals since the last reset; all zero without
+// JSON_COMPARISON_PROFILE.
+phase_totals thread_phase_totals();
+void reset_thread_phases();
+
+#ifdef JSON_COMPARISON_PROFILE
+
+class phase_scope {
+public:
+    explicit phase_scope(phase p)
+            :_previous(_state.current) {
+        switch_to(static_cast<int>(p));
+    }
+
+    ~phase_scope() {
+        switch_to(_previous);
+    }
+
+    phase_scope(const phase_scope&) = delete;
+    phase_scope& operator=(const phase_scope&) = delete;
+
+private:
+    friend phase_totals thread_phase_totals();
+    friend void reset_thread_phases();
+
+    struct thread_state {
+        int current = -1;
+        uint64_t since = 0;
+        uint64_t ticks[phase_count] = {};
+    };
+
+    static inline thread_local thread_state _state;
+
+    // Raw clock ticks: the TSC on x86, nanoseconds elsewhere.
+    static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    // Charges the time since the last switch to the current phase.
+    static void switch_to(int next) {
+        uint64_t now = ticks();
+        if (_state.current >= 0) {
+            _state.ticks[_state.current] += now - _state.since;
+        }
+        _state.since = now;
+        _state.current = next;
+    }
+
+    int _previous;
+};
+
+#else
+
+class phase_scope {
+public:
+    explicit phase_scope(phase) { }
+
+    phase_scope(const phase_scope&) = delete;
+    phase_scope& operator=(const phase_scope&) = delete;
+};
+
+#endif
+
+// Forwards RapidJSON Handler events, each inside a phase_scope: wrap the
+// Document a Reader feeds to charge DOM building to dom_build, or a
+// SchemaValidator to charge it to validate.
+template <typename Handler>
+class phase_handler {
+public:
+    phase_handler(Handler& handler, phase p)
+            :_handler(handler), _phase(p) { }
+
+    bool Null() { phase_scope s(_phase); return _handler.Null(); }
+    bool Bool(bool b) { phase_scope s(_phase); return _handler.Bool(b); }
+    bool Int(int i) { phase_scope s(_phase); return _handler.Int(i); }
+    bool Uint(unsigned u) { phase_scope s(_phase); return _handler.Uint(u); }
+    bool Int64(int64_t i) { phase_scope s(_phase); return _handler.Int64(i); }
+    bool Uint64(uint64_t u) { phase_scope s(_phase); return _handler.Uint64(u); }
+    bool Double(double d) { phase_scope s(_phase); return _handler.Double(d); }
+
+    bool RawNumber(const char* str, rapidjson::SizeType length, bool copy) {
+        phase_scope s(_phase);
+        return _handler.RawNumber(str, length, copy);
+    }
+    bool String(const char* str, rapidjson::SizeType length, bool copy) {
+        phase_scope s(_phase);
+        return _handler.String(str, length, copy);
+    }
+    bool StartObject() { phase_scope s(_phase); return _handler.StartObject(); }
+    bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+        phase_scope s(_phase);
+        return _handler.Key(str, length, copy);
+    }
+    bool EndObject(rapidjson::SizeType count) { phase_scope s(_phase); return _handler.EndObject(count); }
+    bool StartArray() { phase_scope s(_phase); return _handler.StartArray(); }
+    bool EndArray(rapidjson::SizeType count) { phase_scope s(_phase); return _handler.EndArray(count); }
+
+private:
+    Handler& _handler;
+    phase _phase;
+};
+
+// Document::ParseStream, split into tokenize (the Reader, including its number
+// conversion) and dom_build when profiling; ParseStream itself otherwise.
+template <unsigned parseFlags = rapidjson::kParseDefaultFlags, typename Document, typename InputStream>
+void profiled_parse(Document& document, InputStream& is) {
+#ifdef JSON_COMPARISON_PROFILE
+    phase_scope tokenize(phase::tokenize);
+    rapidjson::Reader reader;
+    auto generator = [&](Document& handler) {
+        phase_handler<Document> dom(handler, phase::dom_build);
+        return !reader.Parse<parseFlags>(is, dom).IsError();
+    };
+    document.Populate(generator);
+#else
+    document.template ParseStream<parseFlags>(is);
+#endif
+}
+
+// json::parse, split into tokenize (nlohmann's lexer, including its number
+// conversion) and dom_build when profiling; json::parse itself otherwise.
+template <typename Input>
+nlohmann::json profiled_parse(Input&& input) {
+#ifdef JSON_COMPARISON_PROFILE
+    nlohmann::json result;
+    nlohmann::detail::json_sax_dom_parser<nlohmann::json> dom(result);
+
+    // nlohmann's SAX interface, each event charged to dom_build.
+    struct dom_events {
+        nlohmann::detail::json_sax_dom_parser<nlohmann::json>& dom;
+
+        bool null() { phase_scope s(phase::dom_build); return dom.null(); }
+        bool boolean(bool b) { phase_scope s(phase::dom_build); return dom.boolean(b); }
+        bool number_integer(nlohmann::json::number_integer_t i) {
+            phase_scope s(phase::dom_build);
+            return dom.number_integer(i);
+        }
+        bool number_unsigned(nlohmann::json::number_unsigned_t u) {
+            phase_scope s(phase::dom_build);
+            return dom.number_unsigned(u);
+        }
+        bool number_float(nlohmann::json::number_float_t d, const nlohmann::json::string_t& text) {
+            phase_scope s(phase::dom_build);
+            return dom.number_float(d, text);
+        }
+        bool string(nlohmann::json::string_t& str) { phase_scope s(phase::dom_build); return dom.string(str); }
+        template <typename Binary>
+        bool binary(Binary& b) { phase_scope s(phase::dom_build); return dom.binary(b); }
+        bool start_object(std::size_t n) { phase_scope s(phase::dom_build); return dom.start_object(n); }
+        bool key(nlohmann::json::string_t& str) { phase_scope s(phase::dom_build); return dom.key(str); }
+        bool end_object() { phase_scope s(phase::dom_build); return dom.end_object(); }
+        bool start_array(std::size_t n) { phase_scope s(phase::dom_build); return dom.start_array(n); }
+        bool end_array() { phase_scope s(phase::dom_build); return dom.end_array(); }
+        template <typename Exception>
+        bool parse_error(std::size_t position, const std::string& token, const Exception& e) {
+            return dom.parse_error(position, token, e);
+        }
+    } events{dom};
+
+    phase_scope tokenize(phase::tokenize);
+    nlohmann::json::sax_parse(std::forward<Input>(input), &events);
+    return result;
+#else
+    return nlohmann::json::parse(std::forward<Input>(input));
+#endif
+}
+
+// Hardware counters for the calling thread, read through perf_event_open. Each
+// counter is opened on its own, so one the machine lacks (cache events in
+// most VMs) is simply missing, and all are scaled for the time the kernel
+// had them scheduled when there are more counters than the PMU holds. Nothing
+// is available off Linux, or where perf_event_paranoid forbids user counting.
+enum class hw_counter {
+    cycles,
+    instructions,
+    branch_misses,
+    l1d_misses,
+    llc_misses,
+};
+
+constexpr size_t hw_counter_count = 5;
+
+const char* hw_counter_name(hw_counter c);
+
+class perf_counters {
+public:
+    perf_counters();
+    ~perf_counters();
+
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    // Whether any counter could be opened.
+    bool available() const;
+
+    // Resets and enables, and disables and reads, every open counter.
+    void start();
+    void stop();
+
+    // Stop and resume counting between start() and stop(), as around a
+    // benchmark's untimed setup.
+    void pause();
+    void resume();
+
+    // The count between start() and stop(), or nullopt if the counter could
+    // not be opened.
+    std::optional<uint64_t> value(hw_counter c) const;
+
+private:
+    int _fds[hw_counter_count];
+    uint64_t _values[hw_counter_count] = {};
+};
@@ -1,36 +1,62 @@
 #include <benchmark/benchmark.h>
 #include <rapidjson/document.h>
+#include <rapidjson/encodedstream.h>
+#include <rapidjson/filereadstream.h>
 #include <rapidjson/istreamwrapper.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/prettywriter.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
+#include <cstdio>
 #include <fstream>
+#include <vector>
+
+#include "benchmark_counters.hpp"
+#include "data_generator.hpp"
+#include "mapped_file.hpp"
+#include "rapid_parse_context.hpp"
 
 using namespace rapidjson;
 
+// Same allocation behaviour as Document and StringBuffer, with every malloc
+// counted. Only used for the untimed allocation report of each benchmark.
+using CountedDocument = GenericDocument<UTF8<>, MemoryPoolAllocator<counting_allocator>, counting_allocator>;
+using CountedStringBuffer = GenericStringBuffer<UTF8<>, counting_allocator>;
+
 //////////////////////////////////////////////////////////////////////////////
 // parse JSON from file
 //////////////////////////////////////////////////////////////////////////////
 
 static void ParseFile(benchmark::State& state, const char* filename)
 {
+    profile_session profile;
     while (state.KeepRunning())
     {
-        state.PauseTiming();
+        profile.pause(state);
         auto* f = new std::ifstream(filename);
         auto* j = new Document();
-        state.ResumeTiming();
+        profile.resume(state);
 
         IStreamWrapper isw(*f);
-        j->ParseStream(isw);
+        profiled_parse(*j, isw);
 
-        state.PauseTiming();
+        profile.pause(state);
         delete f;
         delete j;
-        state.ResumeTiming();
+        profile.resume(state);
     }
+    profile.report(state);
 
     std::ifstream file(filename, std::ios::binary | std::ios::ate);
     state.SetBytesProcessed(state.iterations() * file.tellg());
+
+    std::ifstream in(filename);
+    report_dom_allocations(state, static_cast<size_t>(file.tellg()), [&] {
+        IStreamWrapper isw(in);
+        CountedDocument j;
+        j.ParseStream(isw);
+        return j;
+    });
 }
 BENCHMARK_CAPTURE(ParseFile, jeopardy,              "../data/jeopardy/jeopardy.json");
 BENCHMARK_CAPTURE(ParseFile, canada,                "../data/nativejson-benchmark/canada.json");
@@ -42,28 +68,178 @@ BENCHMARK_CAPTURE(ParseFile, unsigned_ints,         "../data/numbers/unsigned_in
 BENCHMARK_CAPTURE(ParseFile, small_signed_ints,     "../data/numbers/small_signed_ints.json");
 
 //////////////////////////////////////////////////////////////////////////////
-// parse JSON from string
+// parse JSON from file, by input strategy, with a warm or cold page cache
 //////////////////////////////////////////////////////////////////////////////
 
-static void ParseString(benchmark::State& state, const char* filename)
+enum class PageCache { warm, cold };
+
+static void PreparePageCache(benchmark::State& state, const char* filename, PageCache cache)
 {
-    std::ifstream f(filename);
-    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    if (cache == PageCache::cold)
+    {
+        state.PauseTiming();
+        drop_page_cache(filename);
+        state.ResumeTiming();
+    }
+}
 
+static void ParseFileIStream(benchmark::State& state, const char* filename, PageCache cache)
+{
     while (state.KeepRunning())
     {
+        PreparePageCache(state, filename, cache);
         state.PauseTiming();
+        auto* f = new std::ifstream(filename);
         auto* j = new Document();
         state.ResumeTiming();
 
-        j->Parse(str.data());
+        IStreamWrapper isw(*f);
+        j->ParseStream(isw);
+
+        state.PauseTiming();
+        delete f;
+        delete j;
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(state.iterations() * mapped_file(filename).size());
+}
+
+// What Document::Parse(str, length) does, through profiled_parse: the whole
+// and mapped strategies both parse a sized buffer this way, so they differ only
+// in how the bytes got there. ParseString keeps the NUL terminated path, which
+// is the one compared against the other libraries.
+static void ParseBuffer(Document& j, const char* data, size_t size)
+{
+    MemoryStream ms(data, size);
+    EncodedInputStream<UTF8<>, MemoryStream> is(ms);
+    profiled_parse(j, is);
+}
+
+// state.range(0) is the FileReadStream buffer size.
+static void ParseFileReadStream(benchmark::State& state, const char* filename, PageCache cache)
+{
+    std::vector<char> buffer(static_cast<size_t>(state.range(0)));
+
+    while (state.KeepRunning())
+    {
+        PreparePageCache(state, filename, cache);
+        state.PauseTiming();
+        FILE* f = std::fopen(filename, "rb");
+        if (f == nullptr)
+        {
+            state.SkipWithError("failed to open file");
+            return;
+        }
+        auto* j = new Document();
+        state.ResumeTiming();
+
+        FileReadStream frs(f, buffer.data(), buffer.size());
+        j->ParseStream(frs);
+
+        state.PauseTiming();
+        std::fclose(f);
+        delete j;
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(state.iterations() * mapped_file(filename).size());
+}
+
+static void ParseFileWhole(benchmark::State& state, const char* filename, PageCache cache)
+{
+    profile_session profile;
+    while (state.KeepRunning())
+    {
+        PreparePageCache(state, filename, cache);
+        profile.pause(state);
+        auto* j = new Document();
+        profile.resume(state);
+
+        std::string str = read_file(filename);
+        ParseBuffer(*j, str.data(), str.size());
+
+        profile.pause(state);
+        delete j;
+        profile.resume(state);
+    }
+    profile.report(state);
+
+    state.SetBytesProcessed(state.iterations() * mapped_file(filename).size());
+}
+
+// Mapping and unmapping are timed: they are the mmap equivalent of the read.
+static void ParseFileMapped(benchmark::State& state, const char* filename, unsigned flags, PageCache cache)
+{
+    while (state.KeepRunning())
+    {
+        PreparePageCache(state, filename, cache);
+        state.PauseTiming();
+        auto* j = new Document();
+        state.ResumeTiming();
+
+        {
+            mapped_file file(filename, flags);
+            ParseBuffer(*j, file.data(), file.size());
+        }
 
         state.PauseTiming();
         delete j;
         state.ResumeTiming();
     }
 
+    state.SetBytesProcessed(state.iterations() * mapped_file(filename).size());
+}
+
+#define FILE_STRATEGY_CAPTURES(name, filename) \
+    BENCHMARK_CAPTURE(ParseFileIStream,    name / warm,          filename, PageCache::warm); \
+    BENCHMARK_CAPTURE(ParseFileIStream,    name / cold,          filename, PageCache::cold); \
+    BENCHMARK_CAPTURE(ParseFileReadStream, name / warm,          filename, PageCache::warm)->Arg(4 << 10)->Arg(64 << 10)->Arg(1 << 20); \
+    BENCHMARK_CAPTURE(ParseFileReadStream, name / cold,          filename, PageCache::cold)->Arg(4 << 10)->Arg(64 << 10)->Arg(1 << 20); \
+    BENCHMARK_CAPTURE(ParseFileWhole,      name / warm,          filename, PageCache::warm); \
+    BENCHMARK_CAPTURE(ParseFileWhole,      name / cold,          filename, PageCache::cold); \
+    BENCHMARK_CAPTURE(ParseFileMapped,     name / warm,          filename, map_default,    PageCache::warm); \
+    BENCHMARK_CAPTURE(ParseFileMapped,     name / cold,          filename, map_default,    PageCache::cold); \
+    BENCHMARK_CAPTURE(ParseFileMapped,     name / populate/warm, filename, map_populate,   PageCache::warm); \
+    BENCHMARK_CAPTURE(ParseFileMapped,     name / populate/cold, filename, map_populate,   PageCache::cold); \
+    BENCHMARK_CAPTURE(ParseFileMapped,     name / huge/warm,     filename, map_huge_pages, PageCache::warm); \
+    BENCHMARK_CAPTURE(ParseFileMapped,     name / huge/cold,     filename, map_huge_pages, PageCache::cold)
+
+FILE_STRATEGY_CAPTURES(canada,       "../data/nativejson-benchmark/canada.json");
+FILE_STRATEGY_CAPTURES(citm_catalog, "../data/nativejson-benchmark/citm_catalog.json");
+FILE_STRATEGY_CAPTURES(twitter,      "../data/nativejson-benchmark/twitter.json");
+
+//////////////////////////////////////////////////////////////////////////////
+// parse JSON from string
+//////////////////////////////////////////////////////////////////////////////
+
+static void ParseString(benchmark::State& state, const char* filename)
+{
+    std::ifstream f(filename);
+    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    profile_session profile;
+    while (state.KeepRunning())
+    {
+        profile.pause(state);
+        auto* j = new Document();
+        profile.resume(state);
+
+        StringStream ss(str.data());
+        profiled_parse(*j, ss);
+
+        profile.pause(state);
+        delete j;
+        profile.resume(state);
+    }
+    profile.report(state);
+
     state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        CountedDocument j;
+        j.Parse(str.data());
+        return j;
+    });
 }
 BENCHMARK_CAPTURE(ParseString, jeopardy,            "../data/jeopardy/jeopardy.json");
 BENCHMARK_CAPTURE(ParseString, canada,              "../data/nativejson-benchmark/canada.json");
@@ -74,11 +250,142 @@ BENCHMARK_CAPTURE(ParseString, signed_ints,         "../data/numbers/signed_ints
 BENCHMARK_CAPTURE(ParseString, unsigned_ints,       "../data/numbers/unsigned_ints.json");
 BENCHMARK_CAPTURE(ParseString, small_signed_ints,   "../data/numbers/small_signed_ints.json");
 
+//////////////////////////////////////////////////////////////////////////////
+// parse generated JSON of increasing size
+//////////////////////////////////////////////////////////////////////////////
+
+static void ParseSweep(benchmark::State& state, corpus kind)
+{
+    const std::string& str = cached_corpus(kind, static_cast<size_t>(state.range(0)));
+
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        auto* j = new Document();
+        state.ResumeTiming();
+
+        j->Parse(str.data());
+
+        state.PauseTiming();
+        delete j;
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        CountedDocument j;
+        j.Parse(str.data());
+        return j;
+    });
+}
+BENCHMARK_CAPTURE(ParseSweep, jeopardy,             corpus::jeopardy)->RangeMultiplier(8)->Range(1 << 10, JSON_COMPARISON_SWEEP_MAX);
+BENCHMARK_CAPTURE(ParseSweep, floats,               corpus::floats)->RangeMultiplier(8)->Range(1 << 10, JSON_COMPARISON_SWEEP_MAX);
+BENCHMARK_CAPTURE(ParseSweep, signed_ints,          corpus::signed_ints)->RangeMultiplier(8)->Range(1 << 10, JSON_COMPARISON_SWEEP_MAX);
+BENCHMARK_CAPTURE(ParseSweep, unsigned_ints,        corpus::unsigned_ints)->RangeMultiplier(8)->Range(1 << 10, JSON_COMPARISON_SWEEP_MAX);
+BENCHMARK_CAPTURE(ParseSweep, small_signed_ints,    corpus::small_signed_ints)->RangeMultiplier(8)->Range(1 << 10, JSON_COMPARISON_SWEEP_MAX);
+
+//////////////////////////////////////////////////////////////////////////////
+// parse JSON from string, fresh vs reused allocators
+//////////////////////////////////////////////////////////////////////////////
+
+// A new Document for every parse, as ParseString, but without the profiler so
+// that the three rows of this section differ only in their allocators.
+static void ParseStringFresh(benchmark::State& state, const char* filename)
+{
+    std::ifstream f(filename);
+    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        auto* j = new Document();
+        state.ResumeTiming();
+
+        j->Parse(str.data());
+
+        state.PauseTiming();
+        delete j;
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        CountedDocument j;
+        j.Parse(str.data());
+        return j;
+    });
+}
+BENCHMARK_CAPTURE(ParseStringFresh, canada,         "../data/nativejson-benchmark/canada.json");
+BENCHMARK_CAPTURE(ParseStringFresh, citm_catalog,   "../data/nativejson-benchmark/citm_catalog.json");
+BENCHMARK_CAPTURE(ParseStringFresh, twitter,        "../data/nativejson-benchmark/twitter.json");
+
+static void ParseStringReuse(benchmark::State& state, const char* filename)
+{
+    std::ifstream f(filename);
+    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    parse_context<counting_allocator> context;
+    context.parse(str.data());
+
+    while (state.KeepRunning())
+    {
+        context.parse(str.data());
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_allocations(state, [&] {
+        context.parse(str.data());
+    });
+}
+BENCHMARK_CAPTURE(ParseStringReuse, canada,         "../data/nativejson-benchmark/canada.json");
+BENCHMARK_CAPTURE(ParseStringReuse, citm_catalog,   "../data/nativejson-benchmark/citm_catalog.json");
+BENCHMARK_CAPTURE(ParseStringReuse, twitter,        "../data/nativejson-benchmark/twitter.json");
+
+static void ParseStringInsitu(benchmark::State& state, const char* filename)
+{
+    std::ifstream f(filename);
+    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    parse_context<counting_allocator> context;
+    context.parse_insitu(str);
+
+    // Includes copying the input into the context's mutable buffer, which a
+    // caller that owns its receive buffer could skip.
+    while (state.KeepRunning())
+    {
+        context.parse_insitu(str);
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_allocations(state, [&] {
+        context.parse_insitu(str);
+    });
+}
+BENCHMARK_CAPTURE(ParseStringInsitu, canada,        "../data/nativejson-benchmark/canada.json");
+BENCHMARK_CAPTURE(ParseStringInsitu, citm_catalog,  "../data/nativejson-benchmark/citm_catalog.json");
+BENCHMARK_CAPTURE(ParseStringInsitu, twitter,       "../data/nativejson-benchmark/twitter.json");
+
 
 //////////////////////////////////////////////////////////////////////////////
 // serialize JSON
 //////////////////////////////////////////////////////////////////////////////
 
+template <typename Buffer>
+static void Write(const Document& j, Buffer& buffer, int indent)
+{
+    if (indent < 0)
+    {
+        Writer<Buffer> writer(buffer);
+        j.Accept(writer);
+    }
+    else
+    {
+        PrettyWriter<Buffer> writer(buffer);
+        writer.SetIndent(' ', static_cast<unsigned>(indent));
+        j.Accept(writer);
+    }
+}
+
+// The buffer is reused, as a server writing response after response would;
+// the allocation report is for a fresh buffer.
 static void Dump(benchmark::State& state, const char* filename, int indent)
 {
     std::ifstream f(filename);
@@ -86,17 +393,21 @@ static void Dump(benchmark::State& state, const char* filename, int indent)
     Document j;
     j.Parse(str.data());
 
+    StringBuffer buffer;
+    profile_session profile;
     while (state.KeepRunning())
     {
-        StringBuffer buffer;
-        Writer<StringBuffer> writer(buffer);
-        j.Accept(writer);
+        buffer.Clear();
+        phase_scope serialize(phase::serialize);
+        Write(j, buffer, indent);
     }
+    profile.report(state);
 
-    StringBuffer buffer;
-    Writer<StringBuffer> writer(buffer);
-    j.Accept(writer);
     state.SetBytesProcessed(state.iterations() * buffer.GetSize());
+    report_allocations(state, [&] {
+        CountedStringBuffer counted;
+        Write(j, counted, indent);
+    });
 }
 BENCHMARK_CAPTURE(Dump, jeopardy / -,      "../data/jeopardy/jeopardy.json",                 -1);
 BENCHMARK_CAPTURE(Dump, jeopardy / 4,      "../data/jeopardy/jeopardy.json",                 4);
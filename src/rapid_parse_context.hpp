@@ -0,0 +1,113 @@
+#pragma once
+
+#include <rapidjson/allocators.h>
+#include <rapidjson/document.h>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Parses one document after another into the same pre-sized arena, the way a
+// connection handler would. rapidjson::Document on its own allocates fresh
+// pool chunks and a fresh parse stack for every document; here both live in
+// user buffers that survive between documents. When a document overflows the
+// arena, the next reset() grows the buffers to the high-water mark so steady
+// state parses never touch malloc.
+//
+// The returned document (and, for the in situ modes, the strings in it) stays
+// valid until the next parse call. One context per thread.
+template <typename BaseAllocator = rapidjson::CrtAllocator>
+class parse_context {
+public:
+    using allocator_type = rapidjson::MemoryPoolAllocator<BaseAllocator>;
+    using document_type = rapidjson::GenericDocument<rapidjson::UTF8<>, allocator_type, allocator_type>;
+
+    explicit parse_context(size_t value_capacity = 64 * 1024, size_t stack_capacity = 16 * 1024)
+            :_value_buffer(value_capacity), _stack_buffer(stack_capacity) {
+        rebuild();
+    }
+
+    parse_context(const parse_context&) = delete;
+    parse_context& operator=(const parse_context&) = delete;
+
+    // Parses a NUL terminated string; strings are copied into the arena.
+    document_type& parse(const char* json) {
+        reset();
+        _document->Parse(json);
+        return *_document;
+    }
+
+    document_type& parse(std::string_view json) {
+        reset();
+        _document->Parse(json.data(), json.size());
+        return *_document;
+    }
+
+    // Copies json into a mutable buffer owned by the context and parses it in
+    // situ, so strings are decoded in place instead of copied into the arena.
+    document_type& parse_insitu(std::string_view json) {
+        reset();
+        _insitu.assign(json.begin(), json.end());
+        _insitu.push_back('\0');
+        _document->ParseInsitu(_insitu.data());
+        return *_document;
+    }
+
+    // Parses a caller-owned, mutable, NUL terminated buffer in place. The buffer
+    // must outlive the returned document.
+    document_type& parse_insitu(char* json) {
+        reset();
+        _document->ParseInsitu(json);
+        return *_document;
+    }
+
+    document_type& document() {
+        return *_document;
+    }
+
+    size_t value_capacity() const {
+        return _value_buffer.size();
+    }
+
+    size_t stack_capacity() const {
+        return _stack_buffer.size();
+    }
+
+private:
+    void reset() {
+        size_t value_high_water = _values->Capacity();
+        size_t stack_high_water = _stack->Capacity();
+
+        if (value_high_water <= _value_buffer.size() && stack_high_water <= _stack_buffer.size()) {
+            _document->SetNull();
+            _values->Clear();
+            _stack->Clear();
+            return;
+        }
+
+        // The allocators write to their buffers when destroyed, so they have
+        // to go before the buffers are reallocated.
+        _document.reset();
+        _stack.reset();
+        _values.reset();
+        if (value_high_water > _value_buffer.size()) {
+            _value_buffer.resize(value_high_water + value_high_water / 4);
+        }
+        if (stack_high_water > _stack_buffer.size()) {
+            _stack_buffer.resize(stack_high_water + stack_high_water / 4);
+        }
+        rebuild();
+    }
+
+    void rebuild() {
+        _values.emplace(_value_buffer.data(), _value_buffer.size(), _value_buffer.size());
+        _stack.emplace(_stack_buffer.data(), _stack_buffer.size(), _stack_buffer.size());
+        _document.emplace(&*_values, _stack_buffer.size() / 2, &*_stack);
+    }
+
+    std::vector<char> _value_buffer;
+    std::vector<char> _stack_buffer;
+    std::vector<char> _insitu;
+    std::optional<allocator_type> _values;
+    std::optional<allocator_type> _stack;
+    std::optional<document_type> _document;
+};
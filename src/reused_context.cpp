@@ -0,0 +1,82 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <fstream>
+#include <rapidjson/document.h>
+#include <string>
+
+#include "rapid_parse_context.hpp"
+
+using namespace rapidjson;
+
+// Built with AddressSanitizer (see CMakeLists.txt): growing the arena replaces
+// the buffers the previous allocators were given, which must not be touched
+// once freed.
+
+static std::string read_corpus(const char* filename) {
+    std::ifstream f(filename);
+    std::string json((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    REQUIRE(!json.empty());
+    return json;
+}
+
+static Document reference(const std::string& json) {
+    Document d;
+    d.Parse(json.c_str());
+    REQUIRE(!d.HasParseError());
+    return d;
+}
+
+TEST_CASE("documents larger than the arena grow it and parse again") {
+    std::string json = read_corpus("../data/nativejson-benchmark/canada.json");
+    Document expected = reference(json);
+
+    parse_context<> context(1024, 256);
+    for (int i = 0; i < 3; ++i) {
+        auto& d = context.parse(json.c_str());
+        REQUIRE(!d.HasParseError());
+        CHECK(d == expected);
+    }
+    CHECK(context.value_capacity() > 1024);
+    CHECK(context.stack_capacity() > 256);
+
+    // Grown to the high-water mark, so a further parse keeps the arena.
+    size_t value_capacity = context.value_capacity();
+    size_t stack_capacity = context.stack_capacity();
+    CHECK(context.parse(json.c_str()) == expected);
+    CHECK(context.value_capacity() == value_capacity);
+    CHECK(context.stack_capacity() == stack_capacity);
+}
+
+TEST_CASE("every parse mode survives the arena growing") {
+    std::string small = R"({"a": [1, 2, 3], "b": "text"})";
+    std::string large = read_corpus("../data/nativejson-benchmark/citm_catalog.json");
+    std::string larger = read_corpus("../data/nativejson-benchmark/twitter.json");
+    Document expected_small = reference(small);
+    Document expected_large = reference(large);
+    Document expected_larger = reference(larger);
+
+    parse_context<> sized(512, 128);
+    CHECK(sized.parse(std::string_view(small)) == expected_small);
+    CHECK(sized.parse(std::string_view(large)) == expected_large);
+    CHECK(sized.parse(std::string_view(larger)) == expected_larger);
+    CHECK(sized.parse(std::string_view(small)) == expected_small);
+
+    parse_context<> insitu(512, 128);
+    CHECK(insitu.parse_insitu(std::string_view(small)) == expected_small);
+    CHECK(insitu.parse_insitu(std::string_view(large)) == expected_large);
+    CHECK(insitu.parse_insitu(std::string_view(larger)) == expected_larger);
+    std::string buffer = large;
+    CHECK(insitu.parse_insitu(&buffer[0]) == expected_large);
+}
+
+TEST_CASE("a failed parse leaves the context usable") {
+    std::string json = read_corpus("../data/nativejson-benchmark/canada.json");
+    Document expected = reference(json);
+
+    parse_context<> context(1024, 256);
+    // Truncated partway, after filling more than the initial arena.
+    CHECK(context.parse(std::string_view(json).substr(0, json.size() / 2)).HasParseError());
+    CHECK(context.parse(json.c_str()) == expected);
+    CHECK(context.parse(json.c_str()) == expected);
+}
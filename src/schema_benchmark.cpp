@@ -3,72 +3,248 @@
 #include <rapidjson/istreamwrapper.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
+#include <algorithm>
 #include <fstream>
 #include <rapidjson/schema.h>
+#include <thread>
+
+#include "benchmark_counters.hpp"
+#include "compiled_schema.hpp"
+#include "compiled_schema/nativejson-benchmark/canada.hpp"
+#include "compiled_schema/numbers/floats.hpp"
+#include "compiled_schema/numbers/signed_ints.hpp"
+#include "compiled_schema/numbers/small_signed_ints.hpp"
+#include "compiled_schema/numbers/unsigned_ints.hpp"
+#include "schema_registry.hpp"
+#include "validating_parse.hpp"
 
 using namespace rapidjson;
 
-SchemaDocument load_schema(const char* schema_filename) {
-    std::ifstream in(schema_filename);
-    IStreamWrapper isw(in);
-    Document json;
-    if (json.ParseStream(isw).HasParseError()) {
-        throw std::runtime_error("had schema parse error");
-    }
+// Same allocation behaviour as Document, with every malloc counted. Only used
+// for the untimed allocation report of each benchmark.
+using CountedDocument = GenericDocument<UTF8<>, MemoryPoolAllocator<counting_allocator>, counting_allocator>;
 
-    return SchemaDocument(json);
+// Every schema under ../schema, loaded once and shared by all benchmarks and
+// threads. Captures name schemas by their path below schema/.
+static const SchemaDocument& GetSchema(const char* schema_name)
+{
+    static schema_registry& registry = []() -> schema_registry& {
+        schema_registry::global().load_directory("../schema");
+        return schema_registry::global();
+    }();
+    return registry.get(schema_name);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 // parse JSON from file
 //////////////////////////////////////////////////////////////////////////////
 
-static void ParseFile(benchmark::State& state, const char* filename, const char* schema_filename)
+static void ParseFile(benchmark::State& state, const char* filename, const char* schema_name)
 {
-    SchemaDocument schema = load_schema(schema_filename);
-    SchemaValidator validator(schema);
+    const SchemaDocument& schema = GetSchema(schema_name);
+    auto validator = acquire_validator(schema);
 
+    profile_session profile;
     while (state.KeepRunning())
     {
-        state.PauseTiming();
+        profile.pause(state);
         auto* f = new std::ifstream(filename);
         auto* j = new Document();
-        state.ResumeTiming();
+        profile.resume(state);
 
         IStreamWrapper isw(*f);
-        j->ParseStream(isw);
-        if (!j->Accept(validator)) {
-            throw std::runtime_error("failed schema validation");
+        profiled_parse(*j, isw);
+        {
+            phase_scope validate(phase::validate);
+            if (!j->Accept(*validator)) {
+                throw std::runtime_error("failed schema validation");
+            }
         }
 
-        state.PauseTiming();
+        profile.pause(state);
+        validator->Reset();
         delete f;
         delete j;
-        state.ResumeTiming();
+        profile.resume(state);
     }
+    profile.report(state);
 
     std::ifstream file(filename, std::ios::binary | std::ios::ate);
     state.SetBytesProcessed(state.iterations() * file.tellg());
+
+    std::ifstream in(filename);
+    report_dom_allocations(state, static_cast<size_t>(file.tellg()), [&] {
+        IStreamWrapper isw(in);
+        CountedDocument j;
+        j.ParseStream(isw);
+        j.Accept(*validator);
+        return j;
+    });
 }
 //BENCHMARK_CAPTURE(ParseFile, jeopardy,              "../data/jeopardy/jeopardy.json");
-BENCHMARK_CAPTURE(ParseFile, canada,                "../data/nativejson-benchmark/canada.json", "../schema/nativejson-benchmark/canada.json");
+BENCHMARK_CAPTURE(ParseFile, canada,                "../data/nativejson-benchmark/canada.json", "nativejson-benchmark/canada");
 //BENCHMARK_CAPTURE(ParseFile, citm_catalog,          "../data/nativejson-benchmark/citm_catalog.json");
 //BENCHMARK_CAPTURE(ParseFile, twitter,               "../data/nativejson-benchmark/twitter.json");
-BENCHMARK_CAPTURE(ParseFile, floats,                "../data/numbers/floats.json",              "../schema/numbers/floats.json");
-BENCHMARK_CAPTURE(ParseFile, signed_ints,           "../data/numbers/signed_ints.json",         "../schema/numbers/signed_ints.json");
-BENCHMARK_CAPTURE(ParseFile, unsigned_ints,         "../data/numbers/unsigned_ints.json",       "../schema/numbers/small_signed_ints.json");
-BENCHMARK_CAPTURE(ParseFile, small_signed_ints,     "../data/numbers/small_signed_ints.json",   "../schema/numbers/unsigned_ints.json");
+BENCHMARK_CAPTURE(ParseFile, floats,                "../data/numbers/floats.json",              "numbers/floats");
+BENCHMARK_CAPTURE(ParseFile, signed_ints,           "../data/numbers/signed_ints.json",         "numbers/signed_ints");
+BENCHMARK_CAPTURE(ParseFile, unsigned_ints,         "../data/numbers/unsigned_ints.json",       "numbers/unsigned_ints");
+BENCHMARK_CAPTURE(ParseFile, small_signed_ints,     "../data/numbers/small_signed_ints.json",   "numbers/small_signed_ints");
 
 //////////////////////////////////////////////////////////////////////////////
 // parse JSON from string
 //////////////////////////////////////////////////////////////////////////////
 
-static void ParseString(benchmark::State& state, const char* filename, const char* schema_filename)
+static void ParseString(benchmark::State& state, const char* filename, const char* schema_name)
+{
+    std::ifstream f(filename);
+    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    const SchemaDocument& schema = GetSchema(schema_name);
+    auto validator = acquire_validator(schema);
+
+    profile_session profile;
+    while (state.KeepRunning())
+    {
+        profile.pause(state);
+        auto* j = new Document();
+        profile.resume(state);
+
+        StringStream ss(str.data());
+        profiled_parse(*j, ss);
+        {
+            phase_scope validate(phase::validate);
+            if (!j->Accept(*validator)) {
+                throw std::runtime_error("failed schema validation");
+            }
+        }
+
+        profile.pause(state);
+        validator->Reset();
+        delete j;
+        profile.resume(state);
+    }
+    profile.report(state);
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        CountedDocument j;
+        j.Parse(str.data());
+        j.Accept(*validator);
+        return j;
+    });
+}
+//BENCHMARK_CAPTURE(ParseString, jeopardy,            "../data/jeopardy/jeopardy.json");
+BENCHMARK_CAPTURE(ParseString, canada,              "../data/nativejson-benchmark/canada.json", "nativejson-benchmark/canada");
+//BENCHMARK_CAPTURE(ParseString, citm_catalog,        "../data/nativejson-benchmark/citm_catalog.json");
+//BENCHMARK_CAPTURE(ParseString, twitter,             "../data/nativejson-benchmark/twitter.json");
+BENCHMARK_CAPTURE(ParseString, floats,              "../data/numbers/floats.json",              "numbers/floats");
+BENCHMARK_CAPTURE(ParseString, signed_ints,         "../data/numbers/signed_ints.json",         "numbers/signed_ints");
+BENCHMARK_CAPTURE(ParseString, unsigned_ints,       "../data/numbers/unsigned_ints.json",       "numbers/unsigned_ints");
+BENCHMARK_CAPTURE(ParseString, small_signed_ints,   "../data/numbers/small_signed_ints.json",   "numbers/small_signed_ints");
+
+//////////////////////////////////////////////////////////////////////////////
+// parse and validate JSON from file in a single pass
+//////////////////////////////////////////////////////////////////////////////
+
+static void ParseFileStreaming(benchmark::State& state, const char* filename, const char* schema_name)
+{
+    const SchemaDocument& schema = GetSchema(schema_name);
+
+    profile_session profile;
+    while (state.KeepRunning())
+    {
+        profile.pause(state);
+        auto* f = new std::ifstream(filename);
+        auto* j = new Document();
+        profile.resume(state);
+
+        IStreamWrapper isw(*f);
+        if (!validating_parse(*j, isw, schema)) {
+            throw std::runtime_error("failed schema validation");
+        }
+
+        profile.pause(state);
+        delete f;
+        delete j;
+        profile.resume(state);
+    }
+    profile.report(state);
+
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    state.SetBytesProcessed(state.iterations() * file.tellg());
+
+    std::ifstream in(filename);
+    report_dom_allocations(state, static_cast<size_t>(file.tellg()), [&] {
+        IStreamWrapper isw(in);
+        CountedDocument j;
+        validating_parse(j, isw, schema);
+        return j;
+    });
+}
+BENCHMARK_CAPTURE(ParseFileStreaming, canada,               "../data/nativejson-benchmark/canada.json", "nativejson-benchmark/canada");
+BENCHMARK_CAPTURE(ParseFileStreaming, floats,               "../data/numbers/floats.json",              "numbers/floats");
+BENCHMARK_CAPTURE(ParseFileStreaming, signed_ints,          "../data/numbers/signed_ints.json",         "numbers/signed_ints");
+BENCHMARK_CAPTURE(ParseFileStreaming, unsigned_ints,        "../data/numbers/unsigned_ints.json",       "numbers/unsigned_ints");
+BENCHMARK_CAPTURE(ParseFileStreaming, small_signed_ints,    "../data/numbers/small_signed_ints.json",   "numbers/small_signed_ints");
+
+//////////////////////////////////////////////////////////////////////////////
+// parse and validate JSON from string in a single pass
+//////////////////////////////////////////////////////////////////////////////
+
+static void ParseStringStreaming(benchmark::State& state, const char* filename, const char* schema_name)
 {
     std::ifstream f(filename);
     std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
-    SchemaDocument schema = load_schema(schema_filename);
-    SchemaValidator validator(schema);
+    const SchemaDocument& schema = GetSchema(schema_name);
+
+    profile_session profile;
+    while (state.KeepRunning())
+    {
+        profile.pause(state);
+        auto* j = new Document();
+        profile.resume(state);
+
+        if (!validating_parse(*j, str.data(), schema)) {
+            throw std::runtime_error("failed schema validation");
+        }
+
+        profile.pause(state);
+        delete j;
+        profile.resume(state);
+    }
+    profile.report(state);
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        CountedDocument j;
+        validating_parse(j, str.data(), schema);
+        return j;
+    });
+}
+BENCHMARK_CAPTURE(ParseStringStreaming, canada,             "../data/nativejson-benchmark/canada.json", "nativejson-benchmark/canada");
+BENCHMARK_CAPTURE(ParseStringStreaming, floats,             "../data/numbers/floats.json",              "numbers/floats");
+BENCHMARK_CAPTURE(ParseStringStreaming, signed_ints,        "../data/numbers/signed_ints.json",         "numbers/signed_ints");
+BENCHMARK_CAPTURE(ParseStringStreaming, unsigned_ints,      "../data/numbers/unsigned_ints.json",       "numbers/unsigned_ints");
+BENCHMARK_CAPTURE(ParseStringStreaming, small_signed_ints,  "../data/numbers/small_signed_ints.json",   "numbers/small_signed_ints");
+
+//////////////////////////////////////////////////////////////////////////////
+// reject JSON that violates the schema in its first array element
+//////////////////////////////////////////////////////////////////////////////
+
+// Inserts a string as the first element of the first array, which every
+// schema here types as an object or a number.
+static std::string MakeEarlyInvalid(const std::string& str)
+{
+    std::string invalid = str;
+    invalid.insert(invalid.find('[') + 1, "\"invalid\",");
+    return invalid;
+}
+
+static void ParseStringInvalidTwoPass(benchmark::State& state, const char* filename, const char* schema_name)
+{
+    std::ifstream f(filename);
+    std::string str = MakeEarlyInvalid(std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>()));
+    const SchemaDocument& schema = GetSchema(schema_name);
+    auto validator = acquire_validator(schema);
 
     while (state.KeepRunning())
     {
@@ -77,24 +253,233 @@ static void ParseString(benchmark::State& state, const char* filename, const cha
         state.ResumeTiming();
 
         j->Parse(str.data());
-        if (!j->Accept(validator)) {
+        if (j->Accept(*validator)) {
+            throw std::runtime_error("invalid document passed schema validation");
+        }
+
+        state.PauseTiming();
+        validator->Reset();
+        delete j;
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_allocations(state, [&] {
+        CountedDocument j;
+        j.Parse(str.data());
+        j.Accept(*validator);
+        validator->Reset();
+    });
+}
+BENCHMARK_CAPTURE(ParseStringInvalidTwoPass, canada,        "../data/nativejson-benchmark/canada.json", "nativejson-benchmark/canada");
+BENCHMARK_CAPTURE(ParseStringInvalidTwoPass, floats,        "../data/numbers/floats.json",              "numbers/floats");
+BENCHMARK_CAPTURE(ParseStringInvalidTwoPass, signed_ints,   "../data/numbers/signed_ints.json",         "numbers/signed_ints");
+
+static void ParseStringInvalidStreaming(benchmark::State& state, const char* filename, const char* schema_name)
+{
+    std::ifstream f(filename);
+    std::string str = MakeEarlyInvalid(std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>()));
+    const SchemaDocument& schema = GetSchema(schema_name);
+
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        auto* j = new Document();
+        state.ResumeTiming();
+
+        if (validating_parse(*j, str.data(), schema)) {
+            throw std::runtime_error("invalid document passed schema validation");
+        }
+
+        state.PauseTiming();
+        delete j;
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_allocations(state, [&] {
+        CountedDocument j;
+        validating_parse(j, str.data(), schema);
+    });
+}
+BENCHMARK_CAPTURE(ParseStringInvalidStreaming, canada,      "../data/nativejson-benchmark/canada.json", "nativejson-benchmark/canada");
+BENCHMARK_CAPTURE(ParseStringInvalidStreaming, floats,      "../data/numbers/floats.json",              "numbers/floats");
+BENCHMARK_CAPTURE(ParseStringInvalidStreaming, signed_ints, "../data/numbers/signed_ints.json",         "numbers/signed_ints");
+
+//////////////////////////////////////////////////////////////////////////////
+// validate against schemas compiled at build time
+//////////////////////////////////////////////////////////////////////////////
+
+// ParseString with the schema's compiled_validator in place of a SchemaValidator.
+// The schema is passed as an (empty) value so that captures can name it.
+template <typename Schema>
+static void ParseStringCompiled(benchmark::State& state, const char* filename, Schema)
+{
+    std::ifstream f(filename);
+    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    compiled_validator<Schema> validator;
+
+    profile_session profile;
+    while (state.KeepRunning())
+    {
+        profile.pause(state);
+        auto* j = new Document();
+        profile.resume(state);
+
+        StringStream ss(str.data());
+        profiled_parse(*j, ss);
+        {
+            phase_scope validate(phase::validate);
+            if (!j->Accept(validator)) {
+                throw std::runtime_error("failed schema validation");
+            }
+        }
+
+        profile.pause(state);
+        validator.Reset();
+        delete j;
+        profile.resume(state);
+    }
+    profile.report(state);
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        CountedDocument j;
+        j.Parse(str.data());
+        j.Accept(validator);
+        validator.Reset();
+        return j;
+    });
+}
+BENCHMARK_CAPTURE(ParseStringCompiled, canada,              "../data/nativejson-benchmark/canada.json", compiled_nativejson_benchmark_canada{});
+BENCHMARK_CAPTURE(ParseStringCompiled, floats,              "../data/numbers/floats.json",              compiled_numbers_floats{});
+BENCHMARK_CAPTURE(ParseStringCompiled, signed_ints,         "../data/numbers/signed_ints.json",         compiled_numbers_signed_ints{});
+BENCHMARK_CAPTURE(ParseStringCompiled, unsigned_ints,       "../data/numbers/unsigned_ints.json",       compiled_numbers_unsigned_ints{});
+BENCHMARK_CAPTURE(ParseStringCompiled, small_signed_ints,   "../data/numbers/small_signed_ints.json",   compiled_numbers_small_signed_ints{});
+
+// ParseStringStreaming with the compiled validator between Reader and Document.
+template <typename Schema>
+static void ParseStringStreamingCompiled(benchmark::State& state, const char* filename, Schema)
+{
+    std::ifstream f(filename);
+    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    profile_session profile;
+    while (state.KeepRunning())
+    {
+        profile.pause(state);
+        auto* j = new Document();
+        profile.resume(state);
+
+        if (!compiled_validating_parse<Schema>(*j, str.data())) {
             throw std::runtime_error("failed schema validation");
         }
 
+        profile.pause(state);
+        delete j;
+        profile.resume(state);
+    }
+    profile.report(state);
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        CountedDocument j;
+        compiled_validating_parse<Schema>(j, str.data());
+        return j;
+    });
+}
+BENCHMARK_CAPTURE(ParseStringStreamingCompiled, canada,             "../data/nativejson-benchmark/canada.json", compiled_nativejson_benchmark_canada{});
+BENCHMARK_CAPTURE(ParseStringStreamingCompiled, floats,             "../data/numbers/floats.json",              compiled_numbers_floats{});
+BENCHMARK_CAPTURE(ParseStringStreamingCompiled, signed_ints,        "../data/numbers/signed_ints.json",         compiled_numbers_signed_ints{});
+BENCHMARK_CAPTURE(ParseStringStreamingCompiled, unsigned_ints,      "../data/numbers/unsigned_ints.json",       compiled_numbers_unsigned_ints{});
+BENCHMARK_CAPTURE(ParseStringStreamingCompiled, small_signed_ints,  "../data/numbers/small_signed_ints.json",   compiled_numbers_small_signed_ints{});
+
+template <typename Schema>
+static void ParseStringInvalidStreamingCompiled(benchmark::State& state, const char* filename, Schema)
+{
+    std::ifstream f(filename);
+    std::string str = MakeEarlyInvalid(std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>()));
+
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        auto* j = new Document();
+        state.ResumeTiming();
+
+        if (compiled_validating_parse<Schema>(*j, str.data())) {
+            throw std::runtime_error("invalid document passed schema validation");
+        }
+
         state.PauseTiming();
         delete j;
         state.ResumeTiming();
     }
 
     state.SetBytesProcessed(state.iterations() * str.size());
+    report_allocations(state, [&] {
+        CountedDocument j;
+        compiled_validating_parse<Schema>(j, str.data());
+    });
 }
-//BENCHMARK_CAPTURE(ParseString, jeopardy,            "../data/jeopardy/jeopardy.json");
-BENCHMARK_CAPTURE(ParseString, canada,              "../data/nativejson-benchmark/canada.json", "../schema/nativejson-benchmark/canada.json");
-//BENCHMARK_CAPTURE(ParseString, citm_catalog,        "../data/nativejson-benchmark/citm_catalog.json");
-//BENCHMARK_CAPTURE(ParseString, twitter,             "../data/nativejson-benchmark/twitter.json");
-BENCHMARK_CAPTURE(ParseString, floats,              "../data/numbers/floats.json",              "../schema/numbers/floats.json");
-BENCHMARK_CAPTURE(ParseString, signed_ints,         "../data/numbers/signed_ints.json",         "../schema/numbers/signed_ints.json");
-BENCHMARK_CAPTURE(ParseString, unsigned_ints,       "../data/numbers/unsigned_ints.json",       "../schema/numbers/small_signed_ints.json");
-BENCHMARK_CAPTURE(ParseString, small_signed_ints,   "../data/numbers/small_signed_ints.json",   "../schema/numbers/unsigned_ints.json");
+BENCHMARK_CAPTURE(ParseStringInvalidStreamingCompiled, canada,      "../data/nativejson-benchmark/canada.json", compiled_nativejson_benchmark_canada{});
+BENCHMARK_CAPTURE(ParseStringInvalidStreamingCompiled, floats,      "../data/numbers/floats.json",              compiled_numbers_floats{});
+BENCHMARK_CAPTURE(ParseStringInvalidStreamingCompiled, signed_ints, "../data/numbers/signed_ints.json",         compiled_numbers_signed_ints{});
+
+//////////////////////////////////////////////////////////////////////////////
+// validate from many threads against one shared SchemaDocument
+//////////////////////////////////////////////////////////////////////////////
+
+static void Threads(benchmark::internal::Benchmark* b)
+{
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    b->ThreadRange(1, max_threads);
+    b->UseRealTime();
+}
+
+// Each thread validates its own parsed copy of the input, leasing a validator
+// from its thread-local pool every iteration.
+static void ValidateThreaded(benchmark::State& state, const char* filename, const char* schema_name)
+{
+    std::ifstream f(filename);
+    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    const SchemaDocument& schema = GetSchema(schema_name);
+    Document j;
+    j.Parse(str.data());
+
+    while (state.KeepRunning())
+    {
+        auto validator = acquire_validator(schema);
+        if (!j.Accept(*validator)) {
+            throw std::runtime_error("failed schema validation");
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+}
+BENCHMARK_CAPTURE(ValidateThreaded, canada,                 "../data/nativejson-benchmark/canada.json", "nativejson-benchmark/canada")->Apply(Threads);
+BENCHMARK_CAPTURE(ValidateThreaded, floats,                 "../data/numbers/floats.json",              "numbers/floats")->Apply(Threads);
+BENCHMARK_CAPTURE(ValidateThreaded, signed_ints,            "../data/numbers/signed_ints.json",         "numbers/signed_ints")->Apply(Threads);
+
+// Single-pass parse and validate per thread through pooled validating_documents.
+static void ParseValidateThreaded(benchmark::State& state, const char* filename, const char* schema_name)
+{
+    std::ifstream f(filename);
+    std::string str((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    const SchemaDocument& schema = GetSchema(schema_name);
+
+    while (state.KeepRunning())
+    {
+        auto pooled = acquire_validator<validating_document>(schema);
+        Document j;
+        if (!validating_parse(j, str.data(), *pooled)) {
+            throw std::runtime_error("failed schema validation");
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+}
+BENCHMARK_CAPTURE(ParseValidateThreaded, canada,            "../data/nativejson-benchmark/canada.json", "nativejson-benchmark/canada")->Apply(Threads);
+BENCHMARK_CAPTURE(ParseValidateThreaded, floats,            "../data/numbers/floats.json",              "numbers/floats")->Apply(Threads);
+BENCHMARK_CAPTURE(ParseValidateThreaded, signed_ints,       "../data/numbers/signed_ints.json",         "numbers/signed_ints")->Apply(Threads);
 
 BENCHMARK_MAIN();
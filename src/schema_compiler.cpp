@@ -0,0 +1,523 @@
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Compiles a JSON schema into a header for compiled_validator (see
+// compiled_schema.hpp). Only the draft-04 keywords below are supported, with
+// SchemaValidator's semantics; anything else is an error rather than being
+// ignored, so a compiled schema never accepts what SchemaValidator rejects.
+
+namespace {
+
+enum type_bit : unsigned {
+    type_null = 1,
+    type_boolean = 2,
+    type_object = 4,
+    type_array = 8,
+    type_string = 16,
+    type_integer = 32,
+    type_number = 64,
+    type_any = 127,
+};
+
+// Annotations, which never affect validation.
+const std::set<std::string> ignored_keywords = {"$schema", "id", "title", "description", "default"};
+
+const std::set<std::string> supported_keywords = {
+    "type", "properties", "required", "items",
+    "minimum", "maximum", "exclusiveMinimum", "exclusiveMaximum",
+    "minLength", "maxLength", "minItems", "maxItems",
+};
+
+struct property {
+    std::string name;
+    int node = -1;
+};
+
+// A number bound as C++ source, typed the way compiled_less compares it.
+struct bound {
+    std::string literal;
+    bool exclusive = false;
+};
+
+struct node {
+    std::string pointer;
+    int depth = 1;
+    unsigned types = type_any;
+    std::vector<property> properties;
+    uint64_t required = 0;
+    int items = -1;
+    std::optional<bound> minimum;
+    std::optional<bound> maximum;
+    std::optional<uint64_t> min_length;
+    std::optional<uint64_t> max_length;
+    std::optional<uint64_t> min_items;
+    std::optional<uint64_t> max_items;
+};
+
+unsigned parse_type(const std::string& name) {
+    if (name == "null") return type_null;
+    if (name == "boolean") return type_boolean;
+    if (name == "object") return type_object;
+    if (name == "array") return type_array;
+    if (name == "string") return type_string;
+    if (name == "integer") return type_integer;
+    // As in SchemaValidator, "number" admits integers too.
+    if (name == "number") return type_number | type_integer;
+    throw std::runtime_error("unknown type \"" + name + "\"");
+}
+
+// JSON pointer token escaping.
+std::string escape_token(const std::string& token) {
+    std::string escaped;
+    for (char c : token) {
+        if (c == '~') {
+            escaped += "~0";
+        } else if (c == '/') {
+            escaped += "~1";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string cpp_string(const std::string& text) {
+    std::string quoted = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += static_cast<char>(c);
+        } else if (c < 0x20 || c >= 0x7F) {
+            quoted += fmt::format("\\x{:02x}\"\"", c);
+        } else {
+            quoted += static_cast<char>(c);
+        }
+    }
+    return quoted + "\"";
+}
+
+uint64_t get_count(const rapidjson::Value& value, const char* keyword, const std::string& pointer) {
+    if (!value.IsUint64()) {
+        throw std::runtime_error(fmt::format("{} at #{} is not a non-negative integer", keyword, pointer));
+    }
+    return value.GetUint64();
+}
+
+// SchemaValidator ignores bounds that are not numbers (the address schema's
+// "minimum": "10000" among them), so the compiled check is omitted too.
+std::optional<bound> get_bound(const rapidjson::Value& schema, const char* keyword, const char* exclusive) {
+    auto found = schema.FindMember(keyword);
+    if (found == schema.MemberEnd() || !found->value.IsNumber()) {
+        return std::nullopt;
+    }
+    const rapidjson::Value& value = found->value;
+    bound b;
+    if (value.IsUint64()) {
+        b.literal = fmt::format("uint64_t({}u)", value.GetUint64());
+    } else if (value.IsInt64()) {
+        b.literal = fmt::format("int64_t({})", value.GetInt64());
+    } else {
+        b.literal = fmt::format("{:.17g}", value.GetDouble());
+        if (b.literal.find_first_of(".eE") == std::string::npos) {
+            b.literal += ".0";
+        }
+    }
+    auto flag = schema.FindMember(exclusive);
+    b.exclusive = flag != schema.MemberEnd() && flag->value.IsBool() && flag->value.GetBool();
+    return b;
+}
+
+class compiler {
+public:
+    // Node 0 is the root; the rest follow in depth-first order.
+    void compile(const rapidjson::Value& schema) {
+        add(schema, "", 1);
+    }
+
+    void write(std::ostream& out, const std::string& name, const std::string& origin, const std::string& source) const;
+
+private:
+    int add(const rapidjson::Value& schema, const std::string& pointer, int depth) {
+        if (!schema.IsObject()) {
+            throw std::runtime_error(fmt::format("schema at #{} is not an object", pointer));
+        }
+        int index = static_cast<int>(_nodes.size());
+        _nodes.emplace_back();
+        _nodes[index].pointer = pointer;
+        _nodes[index].depth = depth;
+
+        for (const auto& member : schema.GetObject()) {
+            std::string keyword(member.name.GetString(), member.name.GetStringLength());
+            if (ignored_keywords.count(keyword) == 0 && supported_keywords.count(keyword) == 0) {
+                throw std::runtime_error(fmt::format("unsupported keyword \"{}\" at #{}", keyword, pointer));
+            }
+        }
+
+        if (auto type = schema.FindMember("type"); type != schema.MemberEnd()) {
+            unsigned types = 0;
+            if (type->value.IsString()) {
+                types = parse_type(type->value.GetString());
+            } else if (type->value.IsArray()) {
+                for (const auto& t : type->value.GetArray()) {
+                    if (!t.IsString()) {
+                        throw std::runtime_error(fmt::format("type at #{} has an entry that is not a string", pointer));
+                    }
+                    types |= parse_type(t.GetString());
+                }
+            } else {
+                throw std::runtime_error(fmt::format("type at #{} is not a string or array", pointer));
+            }
+            _nodes[index].types = types;
+        }
+
+        if (auto properties = schema.FindMember("properties"); properties != schema.MemberEnd()) {
+            if (!properties->value.IsObject()) {
+                throw std::runtime_error(fmt::format("properties at #{} is not an object", pointer));
+            }
+            for (const auto& member : properties->value.GetObject()) {
+                std::string key(member.name.GetString(), member.name.GetStringLength());
+                int child = add(member.value, pointer + "/properties/" + escape_token(key), depth + 1);
+                _nodes[index].properties.push_back({key, child});
+            }
+        }
+
+        // Required names that are not declared as properties are tracked as
+        // unconstrained ones.
+        if (auto required = schema.FindMember("required"); required != schema.MemberEnd()) {
+            if (!required->value.IsArray()) {
+                throw std::runtime_error(fmt::format("required at #{} is not an array", pointer));
+            }
+            for (const auto& name : required->value.GetArray()) {
+                if (!name.IsString()) {
+                    throw std::runtime_error(fmt::format("required at #{} has an entry that is not a string", pointer));
+                }
+                std::string key(name.GetString(), name.GetStringLength());
+                auto& properties = _nodes[index].properties;
+                size_t ordinal = 0;
+                while (ordinal < properties.size() && properties[ordinal].name != key) {
+                    ++ordinal;
+                }
+                if (ordinal == properties.size()) {
+                    properties.push_back({key, -1});
+                }
+                if (ordinal >= 64) {
+                    throw std::runtime_error(fmt::format("required property beyond the 64th at #{}", pointer));
+                }
+                _nodes[index].required |= uint64_t(1) << ordinal;
+            }
+        }
+
+        if (auto items = schema.FindMember("items"); items != schema.MemberEnd()) {
+            if (!items->value.IsObject()) {
+                throw std::runtime_error(fmt::format("items at #{} is not a single schema", pointer));
+            }
+            int child = add(items->value, pointer + "/items", depth + 1);
+            _nodes[index].items = child;
+        }
+
+        _nodes[index].minimum = get_bound(schema, "minimum", "exclusiveMinimum");
+        _nodes[index].maximum = get_bound(schema, "maximum", "exclusiveMaximum");
+        if (auto v = schema.FindMember("minLength"); v != schema.MemberEnd()) {
+            _nodes[index].min_length = get_count(v->value, "minLength", pointer);
+        }
+        if (auto v = schema.FindMember("maxLength"); v != schema.MemberEnd()) {
+            _nodes[index].max_length = get_count(v->value, "maxLength", pointer);
+        }
+        if (auto v = schema.FindMember("minItems"); v != schema.MemberEnd()) {
+            _nodes[index].min_items = get_count(v->value, "minItems", pointer);
+        }
+        if (auto v = schema.FindMember("maxItems"); v != schema.MemberEnd()) {
+            _nodes[index].max_items = get_count(v->value, "maxItems", pointer);
+        }
+        return index;
+    }
+
+    // The number checks for a value of the given C++ type: type, then minimum,
+    // then maximum, in SchemaValidator's order.
+    std::string number_checks(const node& n, unsigned type, const char* value_type) const {
+        if ((n.types & type) == 0) {
+            return "return \"type\";";
+        }
+        std::string body;
+        std::string value = fmt::format("{}(value)", value_type);
+        if (n.minimum) {
+            body += n.minimum->exclusive
+                    ? fmt::format("if (!compiled_less({1}, {0})) return \"minimum\"; ", value, n.minimum->literal)
+                    : fmt::format("if (compiled_less({0}, {1})) return \"minimum\"; ", value, n.minimum->literal);
+        }
+        if (n.maximum) {
+            body += n.maximum->exclusive
+                    ? fmt::format("if (!compiled_less({0}, {1})) return \"maximum\"; ", value, n.maximum->literal)
+                    : fmt::format("if (compiled_less({1}, {0})) return \"maximum\"; ", value, n.maximum->literal);
+        }
+        return body.empty() ? "" : body + "return nullptr;";
+    }
+
+    std::string type_check(const node& n, unsigned type) const {
+        return (n.types & type) == 0 ? "return \"type\";" : "";
+    }
+
+    std::string string_checks(const node& n) const {
+        if ((n.types & type_string) == 0) {
+            return "return \"type\";";
+        }
+        if (!n.min_length && !n.max_length) {
+            return "";
+        }
+        std::string body = "{ size_t count = compiled_code_points(str, length); ";
+        if (n.min_length) {
+            body += fmt::format("if (count < {}u) return \"minLength\"; ", *n.min_length);
+        }
+        if (n.max_length) {
+            body += fmt::format("if (count > {}u) return \"maxLength\"; ", *n.max_length);
+        }
+        return body + "return nullptr; }";
+    }
+
+    std::string end_array_checks(const node& n) const {
+        std::string body;
+        if (n.min_items) {
+            body += fmt::format("if (count < {}u) return \"minItems\"; ", *n.min_items);
+        }
+        if (n.max_items) {
+            body += fmt::format("if (count > {}u) return \"maxItems\"; ", *n.max_items);
+        }
+        return body.empty() ? "" : body + "return nullptr;";
+    }
+
+    // A switch over the nodes, with nodes that share a body sharing a case;
+    // nodes with an empty body take the default.
+    template <typename Body>
+    void write_switch(std::ostream& out, const char* fallback, Body&& body) const {
+        std::map<std::string, std::vector<size_t>> cases;
+        for (size_t i = 0; i < _nodes.size(); ++i) {
+            std::string text = body(_nodes[i]);
+            if (!text.empty()) {
+                cases[text].push_back(i);
+            }
+        }
+        out << "        switch (node) {\n";
+        for (const auto& [text, nodes] : cases) {
+            for (size_t i : nodes) {
+                out << "        case " << i << ":\n";
+            }
+            out << "            " << text << "\n";
+        }
+        out << "        default:\n"
+            << "            return " << fallback << ";\n"
+            << "        }\n";
+    }
+
+    void write_property_lookup(std::ostream& out) const;
+
+    std::vector<node> _nodes;
+};
+
+void compiler::write_property_lookup(std::ostream& out) const {
+    out << "    static int property(int node, const char* key, size_t length) {\n"
+        << "        switch (node) {\n";
+    for (size_t i = 0; i < _nodes.size(); ++i) {
+        const auto& properties = _nodes[i].properties;
+        if (properties.empty()) {
+            continue;
+        }
+        std::map<size_t, std::vector<size_t>> by_length;
+        for (size_t p = 0; p < properties.size(); ++p) {
+            by_length[properties[p].name.size()].push_back(p);
+        }
+        out << "        case " << i << ":\n"
+            << "            switch (length) {\n";
+        for (const auto& [length, ordinals] : by_length) {
+            out << "            case " << length << ":\n";
+            for (size_t p : ordinals) {
+                out << "                if (std::memcmp(key, " << cpp_string(properties[p].name) << ", " << length
+                    << ") == 0) return " << p << ";\n";
+            }
+            out << "                return -1;\n";
+        }
+        out << "            default:\n"
+            << "                return -1;\n"
+            << "            }\n";
+    }
+    out << "        default:\n"
+        << "            return -1;\n"
+        << "        }\n"
+        << "    }\n\n";
+
+    out << "    static int property_node(int node, int ordinal) {\n"
+        << "        switch (node) {\n";
+    for (size_t i = 0; i < _nodes.size(); ++i) {
+        if (_nodes[i].properties.empty()) {
+            continue;
+        }
+        out << "        case " << i << ": {\n"
+            << "            static constexpr int nodes[] = {";
+        for (size_t p = 0; p < _nodes[i].properties.size(); ++p) {
+            out << (p == 0 ? "" : ", ") << _nodes[i].properties[p].node;
+        }
+        out << "};\n"
+            << "            return nodes[ordinal];\n"
+            << "        }\n";
+    }
+    out << "        default:\n"
+        << "            return -1;\n"
+        << "        }\n"
+        << "    }\n\n";
+
+    out << "    static std::string_view property_name(int node, int ordinal) {\n"
+        << "        switch (node) {\n";
+    for (size_t i = 0; i < _nodes.size(); ++i) {
+        if (_nodes[i].properties.empty()) {
+            continue;
+        }
+        out << "        case " << i << ": {\n"
+            << "            static constexpr std::string_view names[] = {";
+        for (size_t p = 0; p < _nodes[i].properties.size(); ++p) {
+            out << (p == 0 ? "" : ", ") << cpp_string(_nodes[i].properties[p].name);
+        }
+        out << "};\n"
+            << "            return names[ordinal];\n"
+            << "        }\n";
+    }
+    out << "        default:\n"
+        << "            return {};\n"
+        << "        }\n"
+        << "    }\n\n";
+}
+
+void compiler::write(std::ostream& out, const std::string& name, const std::string& origin,
+        const std::string& source) const {
+    int max_depth = 1;
+    for (const auto& n : _nodes) {
+        max_depth = std::max(max_depth, n.depth);
+    }
+
+    std::string delimiter = "schema";
+    while (source.find(")" + delimiter + "\"") != std::string::npos) {
+        delimiter += "_";
+    }
+
+    out << "// Generated by schema_compiler from " << origin << "; do not edit.\n"
+        << "#pragma once\n\n"
+        << "#include \"compiled_schema.hpp\"\n\n"
+        << "struct " << name << " {\n"
+        << "    static constexpr const char* source = R\"" << delimiter << "(" << source << ")" << delimiter
+        << "\";\n\n"
+        << "    static constexpr int max_depth = " << max_depth << ";\n\n";
+
+    out << "    static const char* pointer(int node) {\n"
+        << "        static constexpr const char* pointers[] = {\n";
+    for (size_t i = 0; i < _nodes.size(); ++i) {
+        out << "            " << cpp_string(_nodes[i].pointer) << ",\n";
+    }
+    out << "        };\n"
+        << "        return pointers[node];\n"
+        << "    }\n\n";
+
+    out << "    static const char* check_null(int node) {\n";
+    write_switch(out, "nullptr", [&](const node& n) { return type_check(n, type_null); });
+    out << "    }\n\n";
+
+    out << "    static const char* check_bool(int node) {\n";
+    write_switch(out, "nullptr", [&](const node& n) { return type_check(n, type_boolean); });
+    out << "    }\n\n";
+
+    out << "    static const char* check_int64(int node, int64_t value) {\n";
+    write_switch(out, "nullptr", [&](const node& n) { return number_checks(n, type_integer, "int64_t"); });
+    out << "    }\n\n";
+
+    out << "    static const char* check_uint64(int node, uint64_t value) {\n";
+    write_switch(out, "nullptr", [&](const node& n) { return number_checks(n, type_integer, "uint64_t"); });
+    out << "    }\n\n";
+
+    out << "    static const char* check_double(int node, double value) {\n";
+    write_switch(out, "nullptr", [&](const node& n) { return number_checks(n, type_number, "double"); });
+    out << "    }\n\n";
+
+    out << "    static const char* check_string(int node, const char* str, size_t length) {\n";
+    write_switch(out, "nullptr", [&](const node& n) { return string_checks(n); });
+    out << "    }\n\n";
+
+    out << "    static const char* check_start_object(int node) {\n";
+    write_switch(out, "nullptr", [&](const node& n) { return type_check(n, type_object); });
+    out << "    }\n\n";
+
+    out << "    static const char* check_start_array(int node) {\n";
+    write_switch(out, "nullptr", [&](const node& n) { return type_check(n, type_array); });
+    out << "    }\n\n";
+
+    out << "    static const char* check_end_array(int node, uint32_t count) {\n";
+    write_switch(out, "nullptr", [&](const node& n) { return end_array_checks(n); });
+    out << "    }\n\n";
+
+    write_property_lookup(out);
+
+    out << "    static uint64_t required(int node) {\n";
+    write_switch(out, "0", [&](const node& n) {
+        return n.required == 0 ? std::string() : fmt::format("return {}u;", n.required);
+    });
+    out << "    }\n\n";
+
+    out << "    static int items(int node) {\n";
+    write_switch(out, "-1", [&](const node& n) {
+        return n.items < 0 ? std::string() : fmt::format("return {};", n.items);
+    });
+    out << "    }\n"
+        << "};\n";
+}
+
+int usage() {
+    std::cerr << "usage: schema_compiler SCHEMA.json STRUCT_NAME OUTPUT.hpp\n";
+    return 2;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        return usage();
+    }
+    std::string input = argv[1];
+    std::string name = argv[2];
+    fs::path output = argv[3];
+
+    try {
+        std::string source = read_file(input);
+        rapidjson::Document schema;
+        if (schema.Parse(source.c_str()).HasParseError()) {
+            throw std::runtime_error(fmt::format("{} at {}", rapidjson::GetParseError_En(schema.GetParseError()),
+                    schema.GetErrorOffset()));
+        }
+
+        compiler c;
+        c.compile(schema);
+
+        fs::create_directories(output.parent_path());
+        std::ofstream out(output);
+        c.write(out, name, fs::path(input).filename().string(), source);
+        if (!out) {
+            throw std::runtime_error("failed to write " + output.string());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "schema_compiler: " << input << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "schema_registry.hpp"
+
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fmt/format.h>
+#include <mutex>
+#include <rapidjson/document.h>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+schema_registry& schema_registry::global() {
+    static schema_registry registry;
+    return registry;
+}
+
+void schema_registry::load_directory(const std::string& root) {
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::recursive_directory_iterator(root)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".json") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    for (const auto& file : files) {
+        std::string name = fs::relative(file, root).replace_extension().generic_string();
+        std::string text = read_file(file.string());
+        insert(name, text.c_str(), file.string());
+    }
+}
+
+const rapidjson::SchemaDocument& schema_registry::add(const std::string& name, const char* schema_text) {
+    return insert(name, schema_text, name);
+}
+
+const rapidjson::SchemaDocument& schema_registry::insert(const std::string& name, const char* schema_text,
+        const std::string& origin) {
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        auto found = _schemas.find(name);
+        if (found != _schemas.end()) {
+            return *found->second;
+        }
+    }
+
+    // Build outside the lock; the source document can go once the
+    // SchemaDocument has been compiled from it.
+    rapidjson::Document json;
+    if (json.Parse(schema_text).HasParseError()) {
+        throw std::runtime_error(fmt::format("Failed to parse schema {}: {} at {}", origin,
+                json.GetParseError(), json.GetErrorOffset()));
+    }
+    auto schema = std::make_unique<rapidjson::SchemaDocument>(json);
+
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    auto inserted = _schemas.emplace(name, std::move(schema));
+    return *inserted.first->second;
+}
+
+const rapidjson::SchemaDocument& schema_registry::get(const std::string& name) const {
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    auto found = _schemas.find(name);
+    if (found == _schemas.end()) {
+        throw std::out_of_range(fmt::format("Unknown schema: {}", name));
+    }
+    return *found->second;
+}
+
+bool schema_registry::contains(const std::string& name) const {
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    return _schemas.count(name) != 0;
+}
+
+std::vector<std::string> schema_registry::names() const {
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    std::vector<std::string> result;
+    result.reserve(_schemas.size());
+    for (const auto& entry : _schemas) {
+        result.push_back(entry.first);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
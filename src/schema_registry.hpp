@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <rapidjson/schema.h>
+
+// Named, immutable SchemaDocuments shared by every thread. Load the schemas
+// once at startup; lookups afterwards only take a shared lock, and the
+// returned references stay valid for the life of the registry.
+//
+// A SchemaDocument is read-only while validating, so one instance serves all
+// threads. The exception in RapidJSON 1.1.0 is "pattern", whose regex keeps
+// match state inside the schema; none of the schemas in schema/ use it.
+class schema_registry {
+public:
+    // Process-wide registry, empty until something is loaded or added.
+    static schema_registry& global();
+
+    // Adds every *.json file under root, named by its path relative to root
+    // without the extension: schema/numbers/floats.json is "numbers/floats".
+    void load_directory(const std::string& root);
+
+    // Adds a schema from text, replacing nothing: if the name is already
+    // registered, the existing schema is returned.
+    const rapidjson::SchemaDocument& add(const std::string& name, const char* schema_text);
+
+    // Throws std::out_of_range for unknown names.
+    const rapidjson::SchemaDocument& get(const std::string& name) const;
+
+    bool contains(const std::string& name) const;
+
+    std::vector<std::string> names() const;
+
+private:
+    const rapidjson::SchemaDocument& insert(const std::string& name, const char* schema_text,
+            const std::string& origin);
+
+    mutable std::shared_mutex _mutex;
+    std::unordered_map<std::string, std::unique_ptr<rapidjson::SchemaDocument>> _schemas;
+};
+
+// A validator borrowed from the calling thread's pool. It is Reset() and handed
+// back when the lease ends, so the next user always starts from a clean state
+// whether or not the last validation ran to completion.
+template <typename Validator>
+class validator_lease {
+public:
+    validator_lease(std::unique_ptr<Validator> validator, std::vector<std::unique_ptr<Validator>>& pool)
+            :_validator(std::move(validator)), _pool(&pool) { }
+
+    validator_lease(validator_lease&& other) noexcept = default;
+    validator_lease& operator=(validator_lease&&) = delete;
+
+    ~validator_lease() {
+        if (_validator) {
+            _validator->Reset();
+            _pool->push_back(std::move(_validator));
+        }
+    }
+
+    Validator& operator*() const {
+        return *_validator;
+    }
+
+    Validator* operator->() const {
+        return _validator.get();
+    }
+
+private:
+    std::unique_ptr<Validator> _validator;
+    std::vector<std::unique_ptr<Validator>>* _pool;
+};
+
+// Leases a Validator for schema from a thread-local pool, constructing one with
+// Validator(schema) when the pool is empty. Pools are per thread, so there is
+// no locking; a lease must be released on the thread that took it. Validator
+// is rapidjson::SchemaValidator or anything else constructible from a
+// SchemaDocument with a Reset() member, e.g. validating_document.
+template <typename Validator = rapidjson::SchemaValidator>
+validator_lease<Validator> acquire_validator(const rapidjson::SchemaDocument& schema) {
+    thread_local std::unordered_map<const rapidjson::SchemaDocument*, std::vector<std::unique_ptr<Validator>>> pools;
+
+    auto& pool = pools[&schema];
+    if (pool.empty()) {
+        return validator_lease<Validator>(std::make_unique<Validator>(schema), pool);
+    }
+
+    std::unique_ptr<Validator> validator = std::move(pool.back());
+    pool.pop_back();
+    return validator_lease<Validator>(std::move(validator), pool);
+}
@@ -0,0 +1,197 @@
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/filewritestream.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
+
+#include "benchmark_counters.hpp"
+#include "json_writer.hpp"
+
+using namespace rapidjson;
+using json = nlohmann::json;
+
+// Same allocation behaviour as StringBuffer, with every malloc counted. Only
+// used for the untimed allocation report of each benchmark.
+using CountedStringBuffer = GenericStringBuffer<UTF8<>, counting_allocator>;
+
+static std::string ReadString(const char* filename)
+{
+    std::ifstream f(filename);
+    return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+static Document ReadDocument(const char* filename)
+{
+    std::string str = ReadString(filename);
+    Document d;
+    d.Parse<kParseFullPrecisionFlag>(str.c_str());
+    return d;
+}
+
+template <typename Stream>
+static void RapidWrite(const Document& d, Stream& stream, int indent)
+{
+    if (indent < 0)
+    {
+        Writer<Stream> writer(stream);
+        d.Accept(writer);
+    }
+    else
+    {
+        PrettyWriter<Stream> writer(stream);
+        writer.SetIndent(' ', static_cast<unsigned>(indent));
+        d.Accept(writer);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// the libraries' own writers, to memory
+//////////////////////////////////////////////////////////////////////////////
+
+static void RapidDump(benchmark::State& state, const char* filename, int indent)
+{
+    Document d = ReadDocument(filename);
+
+    StringBuffer buffer;
+    while (state.KeepRunning())
+    {
+        buffer.Clear();
+        RapidWrite(d, buffer, indent);
+    }
+
+    state.SetBytesProcessed(state.iterations() * buffer.GetSize());
+    report_allocations(state, [&] {
+        CountedStringBuffer counted;
+        RapidWrite(d, counted, indent);
+    });
+}
+
+static void NlohmannDump(benchmark::State& state, const char* filename, int indent)
+{
+    json j = json::parse(ReadString(filename));
+
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(j.dump(indent));
+    }
+
+    state.SetBytesProcessed(state.iterations() * j.dump(indent).size());
+    report_allocations(state, [&] {
+        return j.dump(indent);
+    });
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// json_writer into a reused output_buffer
+//////////////////////////////////////////////////////////////////////////////
+
+static void WriterRapid(benchmark::State& state, const char* filename, int indent)
+{
+    Document d = ReadDocument(filename);
+
+    output_buffer buffer;
+    json_writer<output_buffer> writer(buffer, indent);
+    while (state.KeepRunning())
+    {
+        buffer.clear();
+        writer.reset();
+        d.Accept(writer);
+    }
+
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+    report_allocations(state, [&] {
+        buffer.clear();
+        writer.reset();
+        d.Accept(writer);
+    });
+}
+
+static void WriterNlohmann(benchmark::State& state, const char* filename, int indent)
+{
+    json j = json::parse(ReadString(filename));
+
+    output_buffer buffer;
+    json_writer<output_buffer> writer(buffer, indent);
+    while (state.KeepRunning())
+    {
+        buffer.clear();
+        writer.reset();
+        write_json(j, writer);
+    }
+
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+    report_allocations(state, [&] {
+        buffer.clear();
+        writer.reset();
+        write_json(j, writer);
+    });
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// to a file descriptor (/dev/null, so only the copies and syscalls count)
+//////////////////////////////////////////////////////////////////////////////
+
+static void RapidFile(benchmark::State& state, const char* filename, int indent)
+{
+    Document d = ReadDocument(filename);
+    FILE* out = std::fopen("/dev/null", "wb");
+    char chunk[64 * 1024];
+
+    while (state.KeepRunning())
+    {
+        FileWriteStream stream(out, chunk, sizeof(chunk));
+        RapidWrite(d, stream, indent);
+        stream.Flush();
+    }
+
+    std::fclose(out);
+    StringBuffer buffer;
+    RapidWrite(d, buffer, indent);
+    state.SetBytesProcessed(state.iterations() * buffer.GetSize());
+}
+
+static void WriterFile(benchmark::State& state, const char* filename, int indent)
+{
+    Document d = ReadDocument(filename);
+    int fd = ::open("/dev/null", O_WRONLY);
+    fd_output out(fd);
+    json_writer<fd_output> writer(out, indent);
+
+    while (state.KeepRunning())
+    {
+        writer.reset();
+        d.Accept(writer);
+        out.flush();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(out.bytes_written()));
+    ::close(fd);
+}
+
+#define SERIALIZE_CAPTURES(name, filename) \
+    BENCHMARK_CAPTURE(RapidDump,      name / -, filename, -1); \
+    BENCHMARK_CAPTURE(RapidDump,      name / 4, filename, 4); \
+    BENCHMARK_CAPTURE(NlohmannDump,   name / -, filename, -1); \
+    BENCHMARK_CAPTURE(NlohmannDump,   name / 4, filename, 4); \
+    BENCHMARK_CAPTURE(WriterRapid,    name / -, filename, -1); \
+    BENCHMARK_CAPTURE(WriterRapid,    name / 4, filename, 4); \
+    BENCHMARK_CAPTURE(WriterNlohmann, name / -, filename, -1); \
+    BENCHMARK_CAPTURE(WriterNlohmann, name / 4, filename, 4); \
+    BENCHMARK_CAPTURE(RapidFile,      name / -, filename, -1); \
+    BENCHMARK_CAPTURE(RapidFile,      name / 4, filename, 4); \
+    BENCHMARK_CAPTURE(WriterFile,     name / -, filename, -1); \
+    BENCHMARK_CAPTURE(WriterFile,     name / 4, filename, 4)
+
+SERIALIZE_CAPTURES(canada,            "../data/nativejson-benchmark/canada.json");
+SERIALIZE_CAPTURES(citm_catalog,      "../data/nativejson-benchmark/citm_catalog.json");
+SERIALIZE_CAPTURES(twitter,           "../data/nativejson-benchmark/twitter.json");
+SERIALIZE_CAPTURES(floats,            "../data/numbers/floats.json");
+SERIALIZE_CAPTURES(signed_ints,       "../data/numbers/signed_ints.json");
+
+BENCHMARK_MAIN();
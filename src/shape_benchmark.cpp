@@ -0,0 +1,261 @@
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <rapidjson/document.h>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include "benchmark_counters.hpp"
+#include "shaped_document.hpp"
+
+using json = nlohmann::json;
+
+static std::string ReadString(const char* filename)
+{
+    std::ifstream f(filename);
+    return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// parse: throughput and DOM bytes
+//////////////////////////////////////////////////////////////////////////////
+
+static void ParseRapid(benchmark::State& state, const char* filename)
+{
+    std::string str = ReadString(filename);
+
+    while (state.KeepRunning())
+    {
+        rapidjson::Document d;
+        d.Parse(str.data(), str.size());
+        benchmark::DoNotOptimize(d);
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        auto d = std::make_unique<rapidjson::Document>();
+        d->Parse(str.data(), str.size());
+        return d;
+    });
+}
+
+static void ParseNlohmann(benchmark::State& state, const char* filename)
+{
+    std::string str = ReadString(filename);
+
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(json::parse(str));
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        return json::parse(str);
+    });
+}
+
+// Each document interns into its own table, which is counted in dom_bytes.
+static void ParseShaped(benchmark::State& state, const char* filename)
+{
+    std::string str = ReadString(filename);
+
+    while (state.KeepRunning())
+    {
+        shaped_document d;
+        d.parse(str);
+        benchmark::DoNotOptimize(d);
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        auto d = std::make_unique<shaped_document>();
+        d->parse(str);
+        return d;
+    });
+
+    shaped_document d;
+    d.parse(str);
+    state.counters["keys"] = benchmark::Counter(static_cast<double>(d.shapes().key_count()));
+    state.counters["shapes"] = benchmark::Counter(static_cast<double>(d.shapes().shape_count()));
+}
+
+// Documents share a table that has seen the input before, as a service
+// parsing the same kind of message over and over would; dom_bytes is then the
+// values and strings alone.
+static void ParseShapedShared(benchmark::State& state, const char* filename)
+{
+    std::string str = ReadString(filename);
+    shape_table table;
+    shaped_document(&table).parse(str);
+
+    while (state.KeepRunning())
+    {
+        shaped_document d(&table);
+        d.parse(str);
+        benchmark::DoNotOptimize(d);
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    report_dom_allocations(state, str.size(), [&] {
+        auto d = std::make_unique<shaped_document>(&table);
+        d->parse(str);
+        return d;
+    });
+}
+
+#define PARSE_CAPTURES(name, filename) \
+    BENCHMARK_CAPTURE(ParseRapid,        name, filename); \
+    BENCHMARK_CAPTURE(ParseNlohmann,     name, filename); \
+    BENCHMARK_CAPTURE(ParseShaped,       name, filename); \
+    BENCHMARK_CAPTURE(ParseShapedShared, name, filename)
+
+PARSE_CAPTURES(jeopardy,     "../data/jeopardy/jeopardy.json");
+PARSE_CAPTURES(canada,       "../data/nativejson-benchmark/canada.json");
+PARSE_CAPTURES(citm_catalog, "../data/nativejson-benchmark/citm_catalog.json");
+PARSE_CAPTURES(twitter,      "../data/nativejson-benchmark/twitter.json");
+
+//////////////////////////////////////////////////////////////////////////////
+// key lookup: a few fields of every element of an array of alike objects
+//////////////////////////////////////////////////////////////////////////////
+
+// Fields near the start, middle and end of each twitter.json status and
+// citm_catalog.json performance.
+static const std::vector<const char*> StatusFields = {"id", "text", "user", "lang", "retweet_count", "favorited"};
+static const std::vector<const char*> PerformanceFields = {"id", "eventId", "prices", "start", "venueCode"};
+
+// Only the lookups are timed; items_per_second is lookups per second.
+static void SetLookups(benchmark::State& state, size_t objects, const std::vector<const char*>& fields)
+{
+    state.SetItemsProcessed(state.iterations() * objects * fields.size());
+}
+
+static void LookupRapid(benchmark::State& state, const char* filename, const char* array,
+        const std::vector<const char*>* fields)
+{
+    std::string str = ReadString(filename);
+    rapidjson::Document d;
+    d.Parse(str.data(), str.size());
+    const rapidjson::Value& objects = d[array];
+
+    while (state.KeepRunning())
+    {
+        for (const auto& object : objects.GetArray())
+        {
+            for (const char* field : *fields)
+            {
+                benchmark::DoNotOptimize(object.FindMember(field));
+            }
+        }
+    }
+
+    SetLookups(state, objects.Size(), *fields);
+}
+
+static void LookupNlohmann(benchmark::State& state, const char* filename, const char* array,
+        const std::vector<const char*>* fields)
+{
+    std::string str = ReadString(filename);
+    json j = json::parse(str);
+    const json& objects = j[array];
+
+    while (state.KeepRunning())
+    {
+        for (const auto& object : objects)
+        {
+            for (const char* field : *fields)
+            {
+                benchmark::DoNotOptimize(object.find(field));
+            }
+        }
+    }
+
+    SetLookups(state, objects.size(), *fields);
+}
+
+// By key: a hash lookup of the key, then a search of the shape.
+static void LookupShaped(benchmark::State& state, const char* filename, const char* array,
+        const std::vector<const char*>* fields)
+{
+    std::string str = ReadString(filename);
+    shaped_document d;
+    d.parse(str);
+    shaped_value objects = d[array];
+
+    while (state.KeepRunning())
+    {
+        objects.for_each_element([&](shaped_value& object) {
+            for (const char* field : *fields)
+            {
+                benchmark::DoNotOptimize(object.find(field));
+            }
+        });
+    }
+
+    SetLookups(state, objects.size(), *fields);
+}
+
+// By key id resolved beforehand: a search of the shape.
+static void LookupShapedId(benchmark::State& state, const char* filename, const char* array,
+        const std::vector<const char*>* fields)
+{
+    std::string str = ReadString(filename);
+    shaped_document d;
+    d.parse(str);
+    shaped_value objects = d[array];
+    std::vector<uint32_t> ids;
+    for (const char* field : *fields)
+    {
+        ids.push_back(d.key_id(field));
+    }
+
+    while (state.KeepRunning())
+    {
+        objects.for_each_element([&](shaped_value& object) {
+            for (uint32_t id : ids)
+            {
+                benchmark::DoNotOptimize(object.find(id));
+            }
+        });
+    }
+
+    SetLookups(state, objects.size(), *fields);
+}
+
+// By field_key: the slot is reused for as long as the shape repeats.
+static void LookupShapedField(benchmark::State& state, const char* filename, const char* array,
+        const std::vector<const char*>* fields)
+{
+    std::string str = ReadString(filename);
+    shaped_document d;
+    d.parse(str);
+    shaped_value objects = d[array];
+    std::vector<field_key> keys;
+    for (const char* field : *fields)
+    {
+        keys.emplace_back(d.shapes(), field);
+    }
+
+    while (state.KeepRunning())
+    {
+        objects.for_each_element([&](shaped_value& object) {
+            for (const field_key& key : keys)
+            {
+                benchmark::DoNotOptimize(key.find(object));
+            }
+        });
+    }
+
+    SetLookups(state, objects.size(), *fields);
+}
+
+#define LOOKUP_CAPTURES(name, filename, array, fields) \
+    BENCHMARK_CAPTURE(LookupRapid,       name, filename, array, &fields); \
+    BENCHMARK_CAPTURE(LookupNlohmann,    name, filename, array, &fields); \
+    BENCHMARK_CAPTURE(LookupShaped,      name, filename, array, &fields); \
+    BENCHMARK_CAPTURE(LookupShapedId,    name, filename, array, &fields); \
+    BENCHMARK_CAPTURE(LookupShapedField, name, filename, array, &fields)
+
+LOOKUP_CAPTURES(twitter,      "../data/nativejson-benchmark/twitter.json",      "statuses",     StatusFields);
+LOOKUP_CAPTURES(citm_catalog, "../data/nativejson-benchmark/citm_catalog.json", "performances", PerformanceFields);
+
+BENCHMARK_MAIN();
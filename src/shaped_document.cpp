@@ -0,0 +1,342 @@
+#include "shaped_document.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <rapidjson/encodedstream.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
+#include <stdexcept>
+
+#include "fast_numbers.hpp"
+
+namespace {
+
+// Shapes up to this wide are searched linearly; wider ones by binary search.
+constexpr size_t scan_limit = 8;
+
+uint64_t hash_keys(const uint32_t* keys, size_t count) {
+    uint64_t hash = count;
+    for (size_t i = 0; i < count; ++i) {
+        hash = (hash ^ keys[i]) * 0x9e3779b97f4a7c15ULL;
+    }
+    return hash ^ (hash >> 29);
+}
+
+}
+
+shape_table::shape_table() {
+    _shapes.emplace_back();
+    _shape_ids.emplace(hash_keys(nullptr, 0), empty_shape);
+}
+
+shape_table& shape_table::global() {
+    static shape_table table;
+    return table;
+}
+
+uint32_t shape_table::intern(std::string_view key) {
+    auto found = _key_ids.find(key);
+    if (found != _key_ids.end()) {
+        return found->second;
+    }
+    auto id = static_cast<uint32_t>(_keys.size());
+    _keys.emplace_back(key);
+    _key_ids.emplace(_keys.back(), id);
+    return id;
+}
+
+uint32_t shape_table::find_key(std::string_view key) const {
+    auto found = _key_ids.find(key);
+    return found == _key_ids.end() ? npos : found->second;
+}
+
+uint32_t shape_table::intern_shape(const uint32_t* keys, size_t count) {
+    uint64_t hash = hash_keys(keys, count);
+    auto range = _shape_ids.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const std::vector<uint32_t>& candidate = _shapes[it->second].keys;
+        if (candidate.size() == count && std::equal(candidate.begin(), candidate.end(), keys)) {
+            return it->second;
+        }
+    }
+
+    shape s;
+    s.keys.assign(keys, keys + count);
+    if (count > scan_limit) {
+        for (size_t i = 0; i < count; ++i) {
+            s.sorted.emplace_back(keys[i], static_cast<uint32_t>(i));
+        }
+        // Stable, so the first of repeated keys sorts first.
+        std::stable_sort(s.sorted.begin(), s.sorted.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+    }
+
+    auto id = static_cast<uint32_t>(_shapes.size());
+    _shapes.push_back(std::move(s));
+    _shape_ids.emplace(hash, id);
+    return id;
+}
+
+uint32_t shape_table::slot(uint32_t shape, uint32_t key) const {
+    const struct shape& s = _shapes[shape];
+    if (s.sorted.empty()) {
+        for (size_t i = 0; i < s.keys.size(); ++i) {
+            if (s.keys[i] == key) {
+                return static_cast<uint32_t>(i);
+            }
+        }
+        return npos;
+    }
+    auto found = std::lower_bound(s.sorted.begin(), s.sorted.end(), key, [](const auto& entry, uint32_t k) {
+        return entry.first < k;
+    });
+    return found != s.sorted.end() && found->first == key ? found->second : npos;
+}
+
+rapidjson::Type shaped_value::type() const {
+    switch (_document->_values[_index].type) {
+    case shaped_document::kind::null:
+        return rapidjson::kNullType;
+    case shaped_document::kind::false_:
+        return rapidjson::kFalseType;
+    case shaped_document::kind::true_:
+        return rapidjson::kTrueType;
+    case shaped_document::kind::object:
+        return rapidjson::kObjectType;
+    case shaped_document::kind::array:
+        return rapidjson::kArrayType;
+    case shaped_document::kind::string:
+        return rapidjson::kStringType;
+    default:
+        return rapidjson::kNumberType;
+    }
+}
+
+bool shaped_value::is_object() const {
+    return _document->_values[_index].type == shaped_document::kind::object;
+}
+
+bool shaped_value::is_array() const {
+    return _document->_values[_index].type == shaped_document::kind::array;
+}
+
+std::optional<shaped_value> shaped_value::find(std::string_view key) const {
+    uint32_t id = _document->_table->find_key(key);
+    if (id == shape_table::npos) {
+        return std::nullopt;
+    }
+    return find(id);
+}
+
+shaped_value shaped_value::operator[](std::string_view key) const {
+    std::optional<shaped_value> value = find(key);
+    if (!value) {
+        throw std::out_of_range(fmt::format("No member {}", key));
+    }
+    return *value;
+}
+
+std::optional<shaped_value> shaped_value::find(uint32_t key) const {
+    if (!is_object()) {
+        return std::nullopt;
+    }
+    uint32_t slot = _document->_table->slot(shape(), key);
+    if (slot == shape_table::npos) {
+        return std::nullopt;
+    }
+    return shaped_value(*_document, child(slot));
+}
+
+shaped_value shaped_value::operator[](size_t index) const {
+    if (index >= size()) {
+        throw std::out_of_range(fmt::format("Index {} out of range", index));
+    }
+    return shaped_value(*_document, child(index));
+}
+
+size_t shaped_value::size() const {
+    const shaped_document::node& n = _document->_values[_index];
+    switch (n.type) {
+    case shaped_document::kind::object:
+        return _document->_table->keys(n.size).size();
+    case shaped_document::kind::array:
+        return n.size;
+    default:
+        return 0;
+    }
+}
+
+uint32_t shaped_value::shape() const {
+    const shaped_document::node& n = _document->_values[_index];
+    return n.type == shaped_document::kind::object ? n.size : shape_table::npos;
+}
+
+size_t shaped_value::child(size_t index) const {
+    return static_cast<size_t>(_document->_values[_index].offset) + index;
+}
+
+std::string_view shaped_value::get_string() const {
+    const shaped_document::node& n = _document->_values[_index];
+    return std::string_view(_document->_strings.data() + n.offset, n.size);
+}
+
+double shaped_value::get_double() const {
+    const shaped_document::node& n = _document->_values[_index];
+    switch (n.type) {
+    case shaped_document::kind::int64:
+        return static_cast<double>(n.i);
+    case shaped_document::kind::uint64:
+        return static_cast<double>(n.u);
+    default:
+        return n.d;
+    }
+}
+
+int64_t shaped_value::get_int64() const {
+    return _document->_values[_index].i;
+}
+
+uint64_t shaped_value::get_uint64() const {
+    return _document->_values[_index].u;
+}
+
+bool shaped_value::get_bool() const {
+    return _document->_values[_index].type == shaped_document::kind::true_;
+}
+
+bool shaped_value::is_null() const {
+    return _document->_values[_index].type == shaped_document::kind::null;
+}
+
+// Builds the document from Reader events the way GenericDocument does: values
+// collect on a stack, and a container's children move to the value array,
+// contiguously, when it ends. Keys are interned as they arrive, and the shape
+// when the object ends.
+class shaped_document::builder {
+public:
+    explicit builder(shaped_document& document)
+            :_document(document) { }
+
+    bool Null() { return push(kind::null, 0, 0); }
+    bool Bool(bool b) { return push(b ? kind::true_ : kind::false_, 0, 0); }
+    bool Int(int i) { return Int64(i); }
+    bool Uint(unsigned u) { return Uint64(u); }
+    bool Int64(int64_t i) { return push(kind::int64, 0, static_cast<uint64_t>(i)); }
+    bool Uint64(uint64_t u) { return push(kind::uint64, 0, u); }
+
+    bool Double(double d) {
+        node n{kind::floating, 0, {}};
+        n.d = d;
+        _stack.push_back(n);
+        return true;
+    }
+
+    bool String(const char* str, rapidjson::SizeType length, bool) {
+        uint64_t offset = _document._strings.size();
+        _document._strings.append(str, length);
+        return push(kind::string, length, offset);
+    }
+
+    bool Key(const char* str, rapidjson::SizeType length, bool) {
+        _keys.push_back(_document._table->intern(std::string_view(str, length)));
+        return true;
+    }
+
+    bool StartObject() {
+        _frames.push_back({_stack.size(), _keys.size()});
+        return true;
+    }
+
+    bool EndObject(rapidjson::SizeType) {
+        frame f = _frames.back();
+        _frames.pop_back();
+        uint32_t shape = _document._table->intern_shape(_keys.data() + f.keys, _keys.size() - f.keys);
+        _keys.resize(f.keys);
+        return close(kind::object, shape, f.values);
+    }
+
+    bool StartArray() {
+        _frames.push_back({_stack.size(), 0});
+        return true;
+    }
+
+    bool EndArray(rapidjson::SizeType count) {
+        frame f = _frames.back();
+        _frames.pop_back();
+        return close(kind::array, count, f.values);
+    }
+
+    // Moves the root into the value array.
+    void finish() {
+        _document._root = _document._values.size();
+        _document._values.push_back(_stack.back());
+    }
+
+private:
+    struct frame {
+        size_t values;
+        size_t keys;
+    };
+
+    bool push(kind type, uint32_t size, uint64_t payload) {
+        node n{type, size, {}};
+        n.u = payload;
+        _stack.push_back(n);
+        return true;
+    }
+
+    bool close(kind type, uint32_t size, size_t begin) {
+        uint64_t offset = _document._values.size();
+        _document._values.insert(_document._values.end(), _stack.begin() + begin, _stack.end());
+        _stack.resize(begin);
+        return push(type, size, offset);
+    }
+
+    shaped_document& _document;
+    std::vector<node> _stack;
+    std::vector<uint32_t> _keys;
+    std::vector<frame> _frames;
+};
+
+shaped_document::shaped_document(shape_table* table)
+        :_own_table(table == nullptr ? std::make_unique<shape_table>() : nullptr),
+         _table(table == nullptr ? _own_table.get() : table) { }
+
+void shaped_document::parse(std::string_view json) {
+    _values.clear();
+    _strings.clear();
+    _root = 0;
+
+    builder events(*this);
+    fast_number_handler<builder> numbers(events);
+    rapidjson::MemoryStream ms(json.data(), json.size());
+    rapidjson::EncodedInputStream<rapidjson::UTF8<>, rapidjson::MemoryStream> is(ms);
+    rapidjson::Reader reader;
+    rapidjson::ParseResult result = reader.Parse<rapidjson::kParseNumbersAsStringsFlag>(is, numbers);
+    if (result.IsError()) {
+        _values.clear();
+        _strings.clear();
+        throw std::runtime_error(fmt::format("Failed to parse json: {} at {}", result.Code(), result.Offset()));
+    }
+    events.finish();
+}
+
+size_t shaped_document::memory_usage() const {
+    return _values.capacity() * sizeof(node) + _strings.capacity();
+}
+
+std::optional<shaped_value> field_key::find(const shaped_value& object) const {
+    uint32_t shape = object.shape();
+    if (shape == shape_table::npos || _key == shape_table::npos) {
+        return std::nullopt;
+    }
+    if (shape != _shape) {
+        _shape = shape;
+        _slot = _table->slot(shape, _key);
+    }
+    if (_slot == shape_table::npos) {
+        return std::nullopt;
+    }
+    return shaped_value(*object._document, object.child(_slot));
+}
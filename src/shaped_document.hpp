@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <rapidjson/document.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Interned object keys, and the shapes made of them. A shape is the sequence
+// of keys of an object, in member order; every object with the same keys in
+// the same order shares one, so a document with thousands of alike records
+// stores their keys once instead of once per record. Looking a member up by
+// key id is then a search of the shape's few slots instead of string
+// comparisons against every member.
+//
+// Objects used as maps (many distinct keys, each seen once) gain nothing from
+// a shape and still intern every key.
+class shape_table {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    // Shape of {}.
+    static constexpr uint32_t empty_shape = 0;
+
+    shape_table();
+
+    shape_table(const shape_table&) = delete;
+    shape_table& operator=(const shape_table&) = delete;
+
+    // A table shared by every document parsed with it, so keys and shapes
+    // seen in earlier documents are not interned again. Not thread safe.
+    static shape_table& global();
+
+    uint32_t intern(std::string_view key);
+
+    // Id of a key interned earlier, or npos.
+    uint32_t find_key(std::string_view key) const;
+
+    std::string_view key(uint32_t id) const {
+        return _keys[id];
+    }
+
+    // Shape of an object with these keys, in this order.
+    uint32_t intern_shape(const uint32_t* keys, size_t count);
+
+    const std::vector<uint32_t>& keys(uint32_t shape) const {
+        return _shapes[shape].keys;
+    }
+
+    // Member index of key in shape (the first, if the object repeats it), or
+    // npos.
+    uint32_t slot(uint32_t shape, uint32_t key) const;
+
+    size_t key_count() const {
+        return _keys.size();
+    }
+
+    size_t shape_count() const {
+        return _shapes.size();
+    }
+
+private:
+    struct shape {
+        std::vector<uint32_t> keys;
+        // (key, slot) sorted by key; only for shapes too wide to scan.
+        std::vector<std::pair<uint32_t, uint32_t>> sorted;
+    };
+
+    std::deque<std::string> _keys;
+    std::unordered_map<std::string_view, uint32_t> _key_ids;
+    std::vector<shape> _shapes;
+    // By hash of the key sequence; collisions are told apart by comparing.
+    std::unordered_multimap<uint64_t, uint32_t> _shape_ids;
+};
+
+class shaped_document;
+
+// A value in a shaped_document. A cheap handle: copy it freely, but not past
+// the lifetime of its document.
+class shaped_value {
+public:
+    shaped_value(const shaped_document& document, size_t index)
+            :_document(&document), _index(index) { }
+
+    rapidjson::Type type() const;
+
+    bool is_object() const;
+    bool is_array() const;
+
+    // Object member by key; operator[] throws std::out_of_range if there is
+    // no such member.
+    std::optional<shaped_value> find(std::string_view key) const;
+    shaped_value operator[](std::string_view key) const;
+    shaped_value operator[](const char* key) const {
+        return (*this)[std::string_view(key)];
+    }
+
+    // Object member by interned key id (see shaped_document::key_id).
+    std::optional<shaped_value> find(uint32_t key) const;
+
+    // Array element, or object member in shape order; throws
+    // std::out_of_range past the end.
+    shaped_value operator[](size_t index) const;
+
+    // Number of elements or members.
+    size_t size() const;
+
+    // The object's shape id.
+    uint32_t shape() const;
+
+    // Calls fn(shaped_value&) for each array element.
+    template <typename Fn>
+    void for_each_element(Fn&& fn) const;
+
+    // Calls fn(std::string_view key, shaped_value&) for each object member.
+    template <typename Fn>
+    void for_each_member(Fn&& fn) const;
+
+    // Valid for the lifetime of the document.
+    std::string_view get_string() const;
+    double get_double() const;
+    int64_t get_int64() const;
+    uint64_t get_uint64() const;
+    bool get_bool() const;
+    bool is_null() const;
+
+private:
+    friend class field_key;
+
+    size_t child(size_t index) const;
+
+    const shaped_document* _document;
+    size_t _index;
+};
+
+// A DOM whose objects hold only their values: keys live in a shape_table,
+// each object records its shape, and member lookup goes through the shape.
+// Values are 16 bytes each, stored children-contiguously in one vector, and
+// strings in one buffer.
+//
+// By default each document interns into a table of its own. Passing a table
+// shares it (and its keys) between documents; it must outlive them.
+class shaped_document {
+public:
+    explicit shaped_document(shape_table* table = nullptr);
+
+    shaped_document(const shaped_document&) = delete;
+    shaped_document& operator=(const shaped_document&) = delete;
+
+    // Throws std::runtime_error on malformed input.
+    void parse(std::string_view json);
+
+    shaped_value root() const {
+        return shaped_value(*this, _root);
+    }
+
+    shaped_value operator[](std::string_view key) const {
+        return root()[key];
+    }
+
+    const shape_table& shapes() const {
+        return *_table;
+    }
+
+    // Id to look key up by, or shape_table::npos if no object has it.
+    uint32_t key_id(std::string_view key) const {
+        return _table->find_key(key);
+    }
+
+    // Bytes held by the values and strings; excludes the shape table.
+    size_t memory_usage() const;
+
+private:
+    friend class shaped_value;
+    class builder;
+
+    enum class kind : uint8_t {
+        null,
+        false_,
+        true_,
+        object,
+        array,
+        string,
+        int64,
+        uint64,
+        floating,
+    };
+
+    // size is the string length, the element count or the object's shape;
+    // offset is where the string starts in _strings, or where the children
+    // start in _values.
+    struct node {
+        kind type;
+        uint32_t size;
+        union {
+            int64_t i;
+            uint64_t u;
+            double d;
+            uint64_t offset;
+        };
+    };
+
+    std::unique_ptr<shape_table> _own_table;
+    shape_table* _table;
+    std::vector<node> _values;
+    std::string _strings;
+    size_t _root = 0;
+};
+
+// A key resolved to its id once, remembering the slot it had in the last
+// shape it was found in. Reading the same field from a run of alike objects
+// is then a shape comparison and an index. Not thread safe.
+class field_key {
+public:
+    field_key(const shape_table& table, std::string_view key)
+            :_table(&table), _key(table.find_key(key)) { }
+
+    std::optional<shaped_value> find(const shaped_value& object) const;
+
+private:
+    const shape_table* _table;
+    uint32_t _key;
+    mutable uint32_t _shape = shape_table::npos;
+    mutable uint32_t _slot = shape_table::npos;
+};
+
+template <typename Fn>
+void shaped_value::for_each_element(Fn&& fn) const {
+    size_t count = size();
+    for (size_t i = 0; i < count; ++i) {
+        shaped_value element(*_document, child(i));
+        fn(element);
+    }
+}
+
+template <typename Fn>
+void shaped_value::for_each_member(Fn&& fn) const {
+    const std::vector<uint32_t>& keys = _document->_table->keys(shape());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        shaped_value value(*_document, child(i));
+        fn(_document->_table->key(keys[i]), value);
+    }
+}
@@ -0,0 +1,148 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <fstream>
+#include <rapidjson/document.h>
+#include <string>
+
+#include "shaped_document.hpp"
+
+using namespace rapidjson;
+
+static std::string read_corpus(const char* filename) {
+    std::ifstream f(filename);
+    std::string json((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    REQUIRE(!json.empty());
+    return json;
+}
+
+// Compares every value, key and member order against RapidJSON's DOM.
+static void require_same(const Value& expected, const shaped_value& actual) {
+    REQUIRE(actual.type() == expected.GetType());
+    switch (expected.GetType()) {
+    case kObjectType: {
+        REQUIRE(actual.size() == expected.MemberCount());
+        size_t i = 0;
+        actual.for_each_member([&](std::string_view key, shaped_value& value) {
+            const auto& member = expected.MemberBegin()[i++];
+            REQUIRE(key == std::string_view(member.name.GetString(), member.name.GetStringLength()));
+            require_same(member.value, value);
+        });
+        break;
+    }
+    case kArrayType:
+        REQUIRE(actual.size() == expected.Size());
+        for (SizeType i = 0; i < expected.Size(); ++i) {
+            require_same(expected[i], actual[i]);
+        }
+        break;
+    case kStringType:
+        REQUIRE(actual.get_string() == std::string_view(expected.GetString(), expected.GetStringLength()));
+        break;
+    case kNumberType:
+        if (expected.IsDouble()) {
+            REQUIRE(actual.get_double() == expected.GetDouble());
+        } else if (expected.IsInt64()) {
+            REQUIRE(actual.get_int64() == expected.GetInt64());
+        } else {
+            REQUIRE(actual.get_uint64() == expected.GetUint64());
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+TEST_CASE("shaped documents match RapidJSON on the corpora") {
+    for (const char* filename : {"../data/nativejson-benchmark/canada.json",
+            "../data/nativejson-benchmark/citm_catalog.json", "../data/nativejson-benchmark/twitter.json"}) {
+        std::string json = read_corpus(filename);
+        Document expected;
+        expected.Parse<kParseFullPrecisionFlag>(json.c_str());
+        REQUIRE(!expected.HasParseError());
+
+        shaped_document actual;
+        actual.parse(json);
+        require_same(expected, actual.root());
+    }
+}
+
+TEST_CASE("alike objects share a shape") {
+    shaped_document d;
+    d.parse(R"([{"a": 1, "b": 2}, {"a": 3, "b": 4}, {"b": 5, "a": 6}, {}])");
+
+    shaped_value root = d.root();
+    CHECK(root[size_t(0)].shape() == root[size_t(1)].shape());
+    CHECK(root[size_t(0)].shape() != root[size_t(2)].shape());
+    CHECK(root[size_t(3)].shape() == shape_table::empty_shape);
+    CHECK(d.shapes().key_count() == 2);
+    CHECK(d.shapes().shape_count() == 3);
+
+    CHECK(root[size_t(2)]["a"].get_int64() == 6);
+    CHECK(!root[size_t(3)].find("a"));
+    CHECK(!root[size_t(0)].find("c"));
+    CHECK_THROWS_AS(root[size_t(0)]["c"], std::out_of_range);
+}
+
+TEST_CASE("repeated keys find the first member") {
+    shaped_document d;
+    d.parse(R"({"k": 1, "x": 0, "k": 2})");
+    CHECK(d["k"].get_int64() == 1);
+    CHECK(d.root().size() == 3);
+
+    std::string wide = "{";
+    for (int i = 0; i < 20; ++i) {
+        wide += "\"k" + std::to_string(i % 10) + "\": " + std::to_string(i) + (i == 19 ? "}" : ", ");
+    }
+    d.parse(wide);
+    for (int i = 0; i < 10; ++i) {
+        CHECK(d["k" + std::to_string(i)].get_int64() == i);
+    }
+}
+
+TEST_CASE("field keys follow changing shapes") {
+    shaped_document d;
+    d.parse(R"([{"id": 1, "name": "a"}, {"id": 2, "name": "b"}, {"name": "c", "id": 3}, {"name": "d"}, [4]])");
+    field_key id(d.shapes(), "id");
+
+    int64_t sum = 0;
+    size_t missing = 0;
+    d.root().for_each_element([&](shaped_value& element) {
+        std::optional<shaped_value> value = id.find(element);
+        if (value) {
+            sum += value->get_int64();
+        } else {
+            ++missing;
+        }
+    });
+    CHECK(sum == 6);
+    CHECK(missing == 2);
+
+    field_key unknown(d.shapes(), "unknown");
+    CHECK(!unknown.find(d.root()[size_t(0)]));
+}
+
+TEST_CASE("a shared table interns keys across documents") {
+    shape_table table;
+    shaped_document first(&table);
+    shaped_document second(&table);
+    first.parse(R"({"user": {"id": 1, "name": "a"}})");
+    second.parse(R"({"user": {"id": 2, "name": "b"}})");
+
+    CHECK(table.key_count() == 3);
+    CHECK(first["user"].shape() == second["user"].shape());
+    CHECK(second["user"]["id"].get_int64() == 2);
+}
+
+TEST_CASE("malformed input throws") {
+    shaped_document d;
+    CHECK_THROWS_AS(d.parse(R"({"a": [1, 2})"), std::runtime_error);
+    d.parse("[true, null, \"s\", -1, 18446744073709551615, 0.5]");
+    shaped_value root = d.root();
+    CHECK(root[size_t(0)].get_bool());
+    CHECK(root[size_t(1)].is_null());
+    CHECK(root[size_t(2)].get_string() == "s");
+    CHECK(root[size_t(3)].get_int64() == -1);
+    CHECK(root[size_t(4)].get_uint64() == 18446744073709551615ULL);
+    CHECK(root[size_t(5)].get_double() == 0.5);
+}
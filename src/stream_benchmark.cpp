@@ -0,0 +1,171 @@
+#include <benchmark/benchmark.h>
+#include <rapidjson/document.h>
+#include <rapidjson/filereadstream.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "data_generator.hpp"
+#include "stream_parser.hpp"
+
+using namespace rapidjson;
+
+// Size of the document streamed by the *_large rows. The build sets this from
+// the JSON_COMPARISON_STREAM_SIZE cache variable.
+#ifndef JSON_COMPARISON_STREAM_SIZE
+#define JSON_COMPARISON_STREAM_SIZE (int64_t(4) << 30)
+#endif
+
+static const char* const StreamFile = "../data/geojson/features_stream.json";
+
+static size_t FileSize(const char* filename)
+{
+    struct stat st;
+    return ::stat(filename, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+}
+
+// Written once, on the first run that needs it, and reused afterwards.
+static const char* LargeFile()
+{
+    if (FileSize(StreamFile) < static_cast<size_t>(JSON_COMPARISON_STREAM_SIZE))
+    {
+        write_corpus_file(corpus::features, default_corpus_seed, JSON_COMPARISON_STREAM_SIZE, StreamFile);
+    }
+    return StreamFile;
+}
+
+// Linux keeps a resettable high-water mark of the resident set (VmHWM), which
+// lets each row report its own peak rather than the whole process's so far.
+// Elsewhere the reset is a no-op and ru_maxrss is the process-wide peak.
+static void ResetPeakRss()
+{
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+}
+
+static double PeakRss()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmHWM:") == 0)
+        {
+            return std::stod(line.substr(6)) * 1024;
+        }
+    }
+
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_maxrss) * 1024;
+}
+
+// peak_rss is the process's resident high-water mark over the row; features
+// and points are what the callback saw in one pass.
+static void SetStreamCounters(benchmark::State& state, size_t features, size_t points)
+{
+    state.counters["peak_rss"] = benchmark::Counter(PeakRss());
+    state.counters["features"] = benchmark::Counter(static_cast<double>(features));
+    state.counters["points"] = benchmark::Counter(static_cast<double>(points));
+}
+
+// Works on both the streamed elements and a Document's values, whose
+// allocator types differ.
+template <typename Feature>
+static size_t CountPoints(const Feature& feature)
+{
+    size_t points = 0;
+    for (const auto& ring : feature["geometry"]["coordinates"].GetArray())
+    {
+        points += ring.Size();
+    }
+    return points;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// stream "/features/*" one feature at a time
+//////////////////////////////////////////////////////////////////////////////
+
+static void StreamFeatures(benchmark::State& state, const char* filename)
+{
+    size_t chunk_size = static_cast<size_t>(state.range(0));
+    size_t features = 0;
+    size_t points = 0;
+
+    ResetPeakRss();
+    while (state.KeepRunning())
+    {
+        stream_parser parser(chunk_size);
+        features = 0;
+        points = 0;
+        parser.subscribe("/features/*", [&](stream_parser::element_document& feature) {
+            ++features;
+            points += CountPoints(feature);
+        });
+        parser.parse_file(filename);
+    }
+
+    state.SetBytesProcessed(state.iterations() * FileSize(filename));
+    SetStreamCounters(state, features, points);
+    state.counters["memory_ceiling"] = benchmark::Counter(
+            static_cast<double>(stream_parser(chunk_size).memory_ceiling()));
+}
+
+static void StreamFeaturesLarge(benchmark::State& state)
+{
+    StreamFeatures(state, LargeFile());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// the same pass over a whole-document DOM
+//////////////////////////////////////////////////////////////////////////////
+
+static void ParseFileDom(benchmark::State& state, const char* filename)
+{
+    size_t features = 0;
+    size_t points = 0;
+
+    ResetPeakRss();
+    while (state.KeepRunning())
+    {
+        FILE* f = std::fopen(filename, "rb");
+        if (f == nullptr)
+        {
+            state.SkipWithError("failed to open file");
+            return;
+        }
+        char buffer[64 * 1024];
+        FileReadStream is(f, buffer, sizeof(buffer));
+        Document d;
+        d.ParseStream(is);
+        std::fclose(f);
+        if (d.HasParseError())
+        {
+            state.SkipWithError("parse error");
+            return;
+        }
+
+        features = 0;
+        points = 0;
+        for (const Value& feature : d["features"].GetArray())
+        {
+            ++features;
+            points += CountPoints(feature);
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * FileSize(filename));
+    SetStreamCounters(state, features, points);
+}
+
+BENCHMARK_CAPTURE(StreamFeatures, features, "../data/geojson/features.json")
+        ->Arg(4 << 10)->Arg(64 << 10)->Arg(1 << 20);
+BENCHMARK_CAPTURE(ParseFileDom,   features, "../data/geojson/features.json");
+
+// Only streamed: at the default 4 GB the DOM would not fit in memory.
+BENCHMARK(StreamFeaturesLarge)
+        ->Arg(64 << 10)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
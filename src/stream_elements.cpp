@@ -0,0 +1,135 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <rapidjson/document.h>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "data_generator.hpp"
+#include "stream_parser.hpp"
+
+using namespace rapidjson;
+
+TEST_CASE("wildcards deliver each element with its pointer") {
+    stream_parser parser;
+    std::vector<std::string> pointers;
+    std::vector<int64_t> ids;
+    parser.subscribe("/items/*", [&](stream_parser::element_document& item) {
+        pointers.push_back(parser.pointer());
+        ids.push_back(item["id"].GetInt64());
+    });
+
+    size_t delivered = parser.parse(R"({"meta": {"items": [9]}, "items": [{"id": 1}, {"id": 2, "tags": ["a"]}, {"id": -3}]})");
+
+    REQUIRE(delivered == 3);
+    CHECK(ids == std::vector<int64_t>{1, 2, -3});
+    CHECK(pointers == std::vector<std::string>{"/items/0", "/items/1", "/items/2"});
+}
+
+TEST_CASE("pointers select by key and index") {
+    stream_parser parser;
+    std::vector<std::string> seen;
+    parser.subscribe("/a~1b/1", [&](stream_parser::element_document& value) {
+        seen.push_back(value.GetString());
+    });
+    parser.subscribe("/m~0n/*/x", [&](stream_parser::element_document& value) {
+        seen.push_back(std::to_string(value.GetInt()));
+    });
+
+    REQUIRE(parser.parse(R"({"a/b": ["zero", "one", "two"], "m~n": {"p": {"x": 7}, "q": {"y": 8, "x": 9}}})") == 3);
+    CHECK(seen == std::vector<std::string>{"one", "7", "9"});
+}
+
+TEST_CASE("the empty pointer delivers the whole document") {
+    stream_parser parser;
+    size_t members = 0;
+    parser.subscribe("", [&](stream_parser::element_document& root) {
+        members = root.MemberCount();
+    });
+
+    REQUIRE(parser.parse(R"({"a": 1, "b": [true, null, 2.5]})") == 1);
+    CHECK(members == 2);
+}
+
+TEST_CASE("matched values are not matched again inside") {
+    stream_parser parser;
+    size_t outer = 0;
+    parser.subscribe("/*", [&](stream_parser::element_document&) {
+        ++outer;
+    });
+    parser.subscribe("/*/*", [&](stream_parser::element_document&) {
+        FAIL("nested value delivered");
+    });
+
+    CHECK(parser.parse("[[1, 2], [3]]") == 2);
+    CHECK(outer == 2);
+}
+
+TEST_CASE("an element larger than the limit throws") {
+    stream_parser parser(stream_parser::default_chunk_size, 1024);
+    parser.subscribe("/*", [](stream_parser::element_document&) { });
+
+    std::string small = "[\"" + std::string(100, 'x') + "\"]";
+    CHECK(parser.parse(small) == 1);
+
+    std::string large = "[[1";
+    for (int i = 0; i < 100000; ++i) {
+        large += ",1";
+    }
+    large += "]]";
+    CHECK_THROWS_AS(parser.parse(large), std::runtime_error);
+
+    // The parser is usable again afterwards.
+    CHECK(parser.parse(small) == 1);
+}
+
+TEST_CASE("malformed input and patterns throw") {
+    stream_parser parser;
+    CHECK_THROWS_AS(parser.subscribe("features/*", [](stream_parser::element_document&) { }), std::invalid_argument);
+    CHECK_THROWS_AS(parser.parse(R"({"a": [1, 2})"), std::runtime_error);
+    CHECK_THROWS_AS(parser.parse_file("does/not/exist.json"), std::runtime_error);
+}
+
+TEST_CASE("streaming a file in small chunks matches a full parse") {
+    char filename[] = "/tmp/stream_elementsXXXXXX";
+    int fd = ::mkstemp(filename);
+    REQUIRE(fd >= 0);
+    ::close(fd);
+    write_corpus_file(corpus::features, default_corpus_seed, 1 << 20, filename);
+
+    FILE* f = std::fopen(filename, "rb");
+    std::string json;
+    char buffer[4096];
+    for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), f)) > 0;) {
+        json.append(buffer, n);
+    }
+    std::fclose(f);
+
+    Document d;
+    d.Parse<kParseFullPrecisionFlag>(json.c_str());
+    REQUIRE(!d.HasParseError());
+    const Value& features = d["features"];
+
+    stream_parser parser(100);
+    SizeType index = 0;
+    parser.subscribe("/features/*", [&](stream_parser::element_document& feature) {
+        const Value& expected = features[index++]["geometry"]["coordinates"];
+        const auto& actual = feature["geometry"]["coordinates"];
+        REQUIRE(actual.Size() == expected.Size());
+        for (SizeType ring = 0; ring < actual.Size(); ++ring) {
+            REQUIRE(actual[ring].Size() == expected[ring].Size());
+            for (SizeType point = 0; point < actual[ring].Size(); ++point) {
+                CHECK(actual[ring][point][0].GetDouble() == expected[ring][point][0].GetDouble());
+                CHECK(actual[ring][point][1].GetDouble() == expected[ring][point][1].GetDouble());
+            }
+        }
+    });
+
+    CHECK(parser.parse_file(filename) == features.Size());
+    CHECK(index == features.Size());
+    std::remove(filename);
+}
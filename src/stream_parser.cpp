@@ -0,0 +1,317 @@
+#include "stream_parser.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/format.h>
+#include <memory>
+#include <new>
+#include <rapidjson/encodedstream.h>
+#include <rapidjson/filereadstream.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
+#include <stdexcept>
+
+#include "fast_numbers.hpp"
+
+namespace {
+
+// Each block carries its size in front, for Free to give back to the budget.
+constexpr size_t block_header = 16;
+
+constexpr size_t arena_chunk_size = 64 * 1024;
+
+}
+
+void* bounded_allocator::Malloc(size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+    if (size > _limit - _used) {
+        throw std::runtime_error(fmt::format("Streamed element exceeds the memory limit of {} bytes", _limit));
+    }
+    auto* block = static_cast<char*>(std::malloc(size + block_header));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    std::memcpy(block, &size, sizeof(size));
+    _used += size;
+    return block + block_header;
+}
+
+void* bounded_allocator::Realloc(void* original, size_t original_size, size_t new_size) {
+    if (new_size == 0) {
+        Free(original);
+        return nullptr;
+    }
+    void* resized = Malloc(new_size);
+    if (original != nullptr) {
+        std::memcpy(resized, original, std::min(original_size, new_size));
+        Free(original);
+    }
+    return resized;
+}
+
+void bounded_allocator::Free(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    char* block = static_cast<char*>(ptr) - block_header;
+    size_t size;
+    std::memcpy(&size, block, sizeof(size));
+    _used -= size;
+    std::free(block);
+}
+
+// The SAX side: tracks the path outside subscribed values and builds the
+// element DOM inside them.
+class stream_parser::handler {
+public:
+    using value_type = element_document::ValueType;
+
+    explicit handler(stream_parser& parser)
+            :_parser(parser) { }
+
+    size_t delivered() const {
+        return _delivered;
+    }
+
+    bool Null() { return scalar([] { return value_type(); }); }
+    bool Bool(bool b) { return scalar([b] { return value_type(b); }); }
+    bool Int(int i) { return scalar([i] { return value_type(i); }); }
+    bool Uint(unsigned u) { return scalar([u] { return value_type(u); }); }
+    bool Int64(int64_t i) { return scalar([i] { return value_type(i); }); }
+    bool Uint64(uint64_t u) { return scalar([u] { return value_type(u); }); }
+    bool Double(double d) { return scalar([d] { return value_type(d); }); }
+
+    bool String(const char* str, rapidjson::SizeType length, bool) {
+        return scalar([&] { return value_type(str, length, _parser._arena); });
+    }
+
+    bool Key(const char* str, rapidjson::SizeType length, bool) {
+        if (_capturing) {
+            _key.SetString(str, length, _parser._arena);
+        } else {
+            _parser._path.back().key.assign(str, length);
+        }
+        return true;
+    }
+
+    bool StartObject() {
+        return start(rapidjson::kObjectType, false);
+    }
+
+    bool EndObject(rapidjson::SizeType) {
+        return end();
+    }
+
+    bool StartArray() {
+        return start(rapidjson::kArrayType, true);
+    }
+
+    bool EndArray(rapidjson::SizeType) {
+        return end();
+    }
+
+private:
+    template <typename Make>
+    bool scalar(Make&& make) {
+        if (!_capturing && !begin_value()) {
+            end_value();
+            return true;
+        }
+        value_type value = make();
+        add(value);
+        if (_building.empty()) {
+            deliver();
+        }
+        return true;
+    }
+
+    bool start(rapidjson::Type type, bool array) {
+        if (!_capturing && !begin_value()) {
+            _parser._path.push_back({array, 0, {}});
+            return true;
+        }
+        value_type value(type);
+        _building.push_back(add(value));
+        return true;
+    }
+
+    bool end() {
+        if (_capturing) {
+            _building.pop_back();
+            if (_building.empty()) {
+                deliver();
+            }
+            return true;
+        }
+        _parser._path.pop_back();
+        end_value();
+        return true;
+    }
+
+    // Whether the value starting now, at the end of the current path, is
+    // subscribed; if so, capturing starts.
+    bool begin_value() {
+        _matched.clear();
+        const std::vector<frame>& path = _parser._path;
+        for (size_t i = 0; i < _parser._subscriptions.size(); ++i) {
+            const std::vector<token>& tokens = _parser._subscriptions[i].tokens;
+            if (tokens.size() != path.size()) {
+                continue;
+            }
+            bool match = true;
+            for (size_t depth = 0; match && depth < tokens.size(); ++depth) {
+                const token& t = tokens[depth];
+                const frame& f = path[depth];
+                match = t.wildcard || (f.array ? t.index == f.index : t.text == f.key);
+            }
+            if (match) {
+                _matched.push_back(i);
+            }
+        }
+        _capturing = !_matched.empty();
+        return _capturing;
+    }
+
+    void end_value() {
+        if (!_parser._path.empty() && _parser._path.back().array) {
+            ++_parser._path.back().index;
+        }
+    }
+
+    // Moves value into the element under construction and returns where it
+    // now lives. Containers only grow once their open child is complete, so
+    // the pointers on _building stay valid.
+    value_type* add(value_type& value) {
+        if (_building.empty()) {
+            value_type& root = _parser._element;
+            root = value;
+            return &root;
+        }
+        value_type& parent = *_building.back();
+        if (parent.IsArray()) {
+            parent.PushBack(value, _parser._arena);
+            return &parent[parent.Size() - 1];
+        }
+        parent.AddMember(_key, value, _parser._arena);
+        return &(parent.MemberEnd() - 1)->value;
+    }
+
+    void deliver() {
+        _capturing = false;
+        for (size_t i : _matched) {
+            _parser._subscriptions[i].fn(_parser._element);
+        }
+        ++_delivered;
+        _parser.reset_element();
+        end_value();
+    }
+
+    stream_parser& _parser;
+    bool _capturing = false;
+    std::vector<size_t> _matched;
+    std::vector<value_type*> _building;
+    value_type _key;
+    size_t _delivered = 0;
+};
+
+stream_parser::stream_parser(size_t chunk_size, size_t element_limit)
+        :_chunk_size(std::max<size_t>(chunk_size, 4)), _budget(element_limit), _arena_buffer(arena_chunk_size),
+         _arena(_arena_buffer.data(), _arena_buffer.size(), arena_chunk_size, &_budget), _element(&_arena) { }
+
+stream_parser::~stream_parser() = default;
+
+void stream_parser::subscribe(std::string_view pattern, element_callback fn) {
+    if (!pattern.empty() && pattern[0] != '/') {
+        throw std::invalid_argument(fmt::format("Invalid subscription {}: not a JSON Pointer", pattern));
+    }
+
+    subscription sub;
+    sub.fn = std::move(fn);
+    while (!pattern.empty()) {
+        pattern.remove_prefix(1);
+        size_t end = std::min(pattern.find('/'), pattern.size());
+        token t{{}, false, std::string_view::npos};
+        for (size_t i = 0; i < end; ++i) {
+            if (pattern[i] == '~' && i + 1 < end && (pattern[i + 1] == '0' || pattern[i + 1] == '1')) {
+                t.text += pattern[++i] == '0' ? '~' : '/';
+            } else {
+                t.text += pattern[i];
+            }
+        }
+        t.wildcard = pattern.substr(0, end) == "*";
+        if (!t.text.empty() && std::all_of(t.text.begin(), t.text.end(), [](char c) { return c >= '0' && c <= '9'; }) &&
+                (t.text.size() == 1 || t.text[0] != '0')) {
+            t.index = std::stoull(t.text);
+        }
+        sub.tokens.push_back(std::move(t));
+        pattern.remove_prefix(end);
+    }
+    _subscriptions.push_back(std::move(sub));
+}
+
+template <typename InputStream>
+size_t stream_parser::parse_stream(InputStream& is) {
+    _path.clear();
+    reset_element();
+
+    handler events(*this);
+    fast_number_handler<handler> numbers(events);
+    rapidjson::Reader reader;
+    rapidjson::ParseResult result = reader.Parse<rapidjson::kParseNumbersAsStringsFlag>(is, numbers);
+    if (result.IsError()) {
+        reset_element();
+        throw std::runtime_error(fmt::format("Failed to parse json: {} at {}", result.Code(), result.Offset()));
+    }
+    return events.delivered();
+}
+
+size_t stream_parser::parse_file(const std::string& filename) {
+    std::unique_ptr<FILE, int (*)(FILE*)> file(std::fopen(filename.c_str(), "rb"), &std::fclose);
+    if (!file) {
+        throw std::runtime_error(fmt::format("Failed to open {}: {}", filename, std::strerror(errno)));
+    }
+    std::vector<char> chunk(_chunk_size);
+    rapidjson::FileReadStream is(file.get(), chunk.data(), chunk.size());
+    return parse_stream(is);
+}
+
+size_t stream_parser::parse(std::string_view json) {
+    rapidjson::MemoryStream ms(json.data(), json.size());
+    rapidjson::EncodedInputStream<rapidjson::UTF8<>, rapidjson::MemoryStream> is(ms);
+    return parse_stream(is);
+}
+
+std::string stream_parser::pointer() const {
+    std::string result;
+    for (const frame& f : _path) {
+        result += '/';
+        if (f.array) {
+            result += std::to_string(f.index);
+            continue;
+        }
+        for (char c : f.key) {
+            if (c == '~') {
+                result += "~0";
+            } else if (c == '/') {
+                result += "~1";
+            } else {
+                result += c;
+            }
+        }
+    }
+    return result;
+}
+
+size_t stream_parser::memory_ceiling() const {
+    return _chunk_size + _arena_buffer.size() + _budget.limit();
+}
+
+void stream_parser::reset_element() {
+    _element.SetNull();
+    _arena.Clear();
+}
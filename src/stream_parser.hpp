@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <rapidjson/document.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Base allocator for a streamed element's arena that refuses to hold more
+// than limit bytes: the allocation that would cross it throws
+// std::runtime_error instead.
+class bounded_allocator {
+public:
+    static const bool kNeedFree = true;
+
+    explicit bounded_allocator(size_t limit = SIZE_MAX)
+            :_limit(limit) { }
+
+    void* Malloc(size_t size);
+    void* Realloc(void* original, size_t original_size, size_t new_size);
+    void Free(void* ptr);
+
+    size_t used() const {
+        return _used;
+    }
+
+    size_t limit() const {
+        return _limit;
+    }
+
+private:
+    size_t _limit;
+    size_t _used = 0;
+};
+
+// Streams a JSON document of any size through RapidJSON's SAX Reader and hands
+// each value matching a subscription to a callback as a small DOM of its own,
+// so a multi-GB export shaped like canada.json's {"features": [...]} is
+// processed one feature at a time.
+//
+// Memory is bounded: the input is read in chunk_size pieces, and each element
+// is built in an arena that throws once it would exceed element_limit. The
+// arena is cleared after every element, so the delivered document is only
+// valid during the callback; copy out anything that must outlive it. Outside
+// the subscribed values only the path (keys and indices) is kept. A single
+// string longer than the limit, wherever it is, still passes through the
+// Reader's own buffer.
+class stream_parser {
+public:
+    using element_allocator = rapidjson::MemoryPoolAllocator<bounded_allocator>;
+    using element_document = rapidjson::GenericDocument<rapidjson::UTF8<>, element_allocator>;
+    using element_callback = std::function<void(element_document& element)>;
+
+    static constexpr size_t default_chunk_size = 64 * 1024;
+    static constexpr size_t default_element_limit = 64 * 1024 * 1024;
+
+    explicit stream_parser(size_t chunk_size = default_chunk_size, size_t element_limit = default_element_limit);
+    ~stream_parser();
+
+    stream_parser(const stream_parser&) = delete;
+    stream_parser& operator=(const stream_parser&) = delete;
+
+    // pattern is a JSON Pointer in which a "*" token matches every element of
+    // an array and every member of an object, e.g. "/features/*". Values
+    // nested inside a matched value are not matched again. Throws
+    // std::invalid_argument for a pattern that is not a pointer.
+    void subscribe(std::string_view pattern, element_callback fn);
+
+    // Parse the input and return the number of values delivered. Throws
+    // std::runtime_error on malformed input, with the byte offset, or when an
+    // element exceeds the limit.
+    size_t parse_file(const std::string& filename);
+    size_t parse(std::string_view json);
+
+    // The JSON Pointer of the value being delivered; for use in callbacks.
+    std::string pointer() const;
+
+    // Upper bound on the memory the parser itself holds while streaming: the
+    // read chunk, the arena's first block and the element limit.
+    size_t memory_ceiling() const;
+
+private:
+    class handler;
+    friend class handler;
+
+    struct token {
+        std::string text;
+        bool wildcard;
+        // The array index the token names, or npos.
+        size_t index;
+    };
+
+    struct subscription {
+        std::vector<token> tokens;
+        element_callback fn;
+    };
+
+    // One open container on the path to the current value.
+    struct frame {
+        bool array;
+        size_t index;
+        std::string key;
+    };
+
+    template <typename InputStream>
+    size_t parse_stream(InputStream& is);
+
+    void reset_element();
+
+    size_t _chunk_size;
+    std::vector<subscription> _subscriptions;
+    std::vector<frame> _path;
+
+    bounded_allocator _budget;
+    std::vector<char> _arena_buffer;
+    element_allocator _arena;
+    element_document _element;
+};
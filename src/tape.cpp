@@ -0,0 +1,422 @@
+#include "tape.hpp"
+#include "number_parse.hpp"
+#include "profile.hpp"
+#include "tape_stage1.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <initializer_list>
+#include <stdexcept>
+
+simd_level detect_simd_level() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (have_avx2_kernel() && __builtin_cpu_supports("avx2")) {
+        return simd_level::avx2;
+    }
+    if (have_sse42_kernel() && __builtin_cpu_supports("sse4.2")) {
+        return simd_level::sse42;
+    }
+#endif
+    return simd_level::scalar;
+}
+
+const char* simd_level_name(simd_level level) {
+    switch (level) {
+    case simd_level::scalar:
+        return "scalar";
+    case simd_level::sse42:
+        return "sse4.2";
+    case simd_level::avx2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+char* tape_document::reserve_string(size_t max_length) {
+    size_t needed = _strings_size + sizeof(uint32_t) + max_length + 1;
+    if (needed > _strings_capacity) {
+        size_t capacity = std::max(needed, _strings_capacity + _strings_capacity / 2);
+        std::unique_ptr<char[]> strings(new char[capacity]);
+        if (_strings_size != 0) {
+            std::memcpy(strings.get(), _strings.get(), _strings_size);
+        }
+        _strings = std::move(strings);
+        _strings_capacity = capacity;
+    }
+    return _strings.get() + _strings_size + sizeof(uint32_t);
+}
+
+uint64_t tape_document::commit_string(size_t length) {
+    uint64_t offset = _strings_size;
+    auto length32 = static_cast<uint32_t>(length);
+    std::memcpy(_strings.get() + offset, &length32, sizeof(length32));
+    _strings[offset + sizeof(length32) + length] = '\0';
+    _strings_size += sizeof(length32) + length + 1;
+    return offset;
+}
+
+uint32_t tape_document::count_children(size_t open) const {
+    uint32_t count = 0;
+    bool object = static_cast<char>(_tape[open] >> 56) == '{';
+    size_t end = static_cast<size_t>(_tape[open] & payload_mask) - 1;
+    for (size_t i = open + 1; i < end; ++count) {
+        if (object) {
+            ++i;
+        }
+        switch (static_cast<char>(_tape[i] >> 56)) {
+        case '{':
+        case '[':
+            i = static_cast<size_t>(_tape[i] & payload_mask);
+            break;
+        case 'l':
+        case 'u':
+        case 'd':
+            i += 2;
+            break;
+        default:
+            ++i;
+            break;
+        }
+    }
+    return count;
+}
+
+namespace {
+
+// Bytes that may directly follow a number or literal.
+struct terminators {
+    bool table[256] = {};
+
+    constexpr terminators() {
+        for (char c : {'{', '}', '[', ']', ':', ',', ' ', '\t', '\n', '\r'}) {
+            table[static_cast<uint8_t>(c)] = true;
+        }
+    }
+};
+
+constexpr terminators terminator;
+
+inline bool is_terminator(char c) {
+    return terminator.table[static_cast<uint8_t>(c)];
+}
+
+inline uint64_t tape_word(char type, uint64_t payload) {
+    return (static_cast<uint64_t>(static_cast<uint8_t>(type)) << 56) | payload;
+}
+
+[[noreturn]] void parse_error(const char* message, size_t offset) {
+    throw std::runtime_error(fmt::format("Failed to parse json: {} at {}", message, offset));
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = static_cast<char>(c | 0x20);
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+// Reads the four hex digits after "\u", or returns -1.
+long parse_hex4(const char* p) {
+    long value = 0;
+    for (int i = 0; i < 4; ++i) {
+        int digit = hex_value(p[i]);
+        if (digit < 0) {
+            return -1;
+        }
+        value = (value << 4) | digit;
+    }
+    return value;
+}
+
+char* encode_utf8(char* out, uint32_t cp) {
+    if (cp < 0x80) {
+        *out++ = static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        *out++ = static_cast<char>(0xc0 | (cp >> 6));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        *out++ = static_cast<char>(0xe0 | (cp >> 12));
+        *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3f));
+    } else {
+        *out++ = static_cast<char>(0xf0 | (cp >> 18));
+        *out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+        *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3f));
+    }
+    return out;
+}
+
+// Unescapes the string whose opening quote is at begin into out, returning
+// the end of the output. Stage 1 has already established that the string is
+// closed; an escape sequence is never longer than its UTF-8 result, so out
+// needs no more room than the input remaining.
+char* parse_string(const char* buffer, size_t begin, char* out) {
+    const char* p = buffer + begin + 1;
+    for (;;) {
+        char c = *p;
+        if (c == '"') {
+            return out;
+        }
+        if (c == '\\') {
+            char escape = p[1];
+            p += 2;
+            switch (escape) {
+            case '"': *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '/': *out++ = '/'; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u': {
+                long cp = parse_hex4(p);
+                if (cp < 0) {
+                    parse_error("invalid \\u escape", static_cast<size_t>(p - buffer));
+                }
+                p += 4;
+                if (cp >= 0xd800 && cp <= 0xdbff) {
+                    long low = p[0] == '\\' && p[1] == 'u' ? parse_hex4(p + 2) : -1;
+                    if (low < 0xdc00 || low > 0xdfff) {
+                        parse_error("invalid surrogate pair", static_cast<size_t>(p - buffer));
+                    }
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                    p += 6;
+                } else if (cp >= 0xdc00 && cp <= 0xdfff) {
+                    parse_error("invalid surrogate pair", static_cast<size_t>(p - buffer));
+                }
+                out = encode_utf8(out, static_cast<uint32_t>(cp));
+                break;
+            }
+            default:
+                parse_error("invalid escape", static_cast<size_t>(p - buffer - 1));
+            }
+            continue;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) {
+            parse_error("control character in string", static_cast<size_t>(p - buffer));
+        }
+        *out++ = c;
+        ++p;
+    }
+}
+
+// Appends the number starting at offset to the tape, as 'l', 'u' or 'd'. The
+// padding guarantees a terminator, so the number never runs off the buffer.
+void parse_number(const char* buffer, size_t length, size_t offset, std::vector<uint64_t>& tape) {
+    phase_scope parse(phase::number_parse);
+    parsed_number number;
+    const char* end = parse_json_number(buffer + offset, buffer + length + tape_parser::padding, number);
+    if (end == nullptr || !is_terminator(*end)) {
+        parse_error("invalid number", offset);
+    }
+    switch (number.kind) {
+    case number_kind::int64:
+        tape.push_back(tape_word('l', 0));
+        tape.push_back(static_cast<uint64_t>(number.i));
+        break;
+    case number_kind::uint64:
+        tape.push_back(tape_word('u', 0));
+        tape.push_back(number.u);
+        break;
+    case number_kind::floating: {
+        uint64_t bits;
+        std::memcpy(&bits, &number.d, sizeof(bits));
+        tape.push_back(tape_word('d', 0));
+        tape.push_back(bits);
+        break;
+    }
+    }
+}
+
+void parse_literal(const char* buffer, size_t offset, std::vector<uint64_t>& tape) {
+    const char* p = buffer + offset;
+    if (std::memcmp(p, "true", 4) == 0 && is_terminator(p[4])) {
+        tape.push_back(tape_word('t', 0));
+    } else if (std::memcmp(p, "false", 5) == 0 && is_terminator(p[5])) {
+        tape.push_back(tape_word('f', 0));
+    } else if (std::memcmp(p, "null", 4) == 0 && is_terminator(p[4])) {
+        tape.push_back(tape_word('n', 0));
+    } else {
+        parse_error("invalid value", offset);
+    }
+}
+
+}
+
+void tape_parser::parse(std::string_view json, tape_document& document) {
+    if (json.size() > UINT32_MAX) {
+        throw std::runtime_error(fmt::format("Failed to parse json: {} bytes exceeds the 4GB limit", json.size()));
+    }
+
+    size_t padded_size = json.size() + padding;
+    if (padded_size > _padded_capacity) {
+        _padded.reset(new char[padded_size]);
+        _padded_capacity = padded_size;
+    }
+    std::memcpy(_padded.get(), json.data(), json.size());
+    std::memset(_padded.get() + json.size(), ' ', padding);
+
+    size_t count;
+    {
+        phase_scope tokenize(phase::tokenize);
+        count = find_structurals(json.size());
+    }
+    phase_scope build(phase::dom_build);
+    build_tape(json.size(), count, document);
+}
+
+size_t tape_parser::find_structurals(size_t length) {
+    if (length + 1 > _structurals_capacity) {
+        _structurals.reset(new uint32_t[length + 1]);
+        _structurals_capacity = length + 1;
+    }
+
+    bool unclosed_string = false;
+    size_t count;
+    switch (_level) {
+    case simd_level::avx2:
+        count = find_structurals_avx2(_padded.get(), length, _structurals.get(), unclosed_string);
+        break;
+    case simd_level::sse42:
+        count = find_structurals_sse42(_padded.get(), length, _structurals.get(), unclosed_string);
+        break;
+    default:
+        count = find_structurals_scalar(_padded.get(), length, _structurals.get(), unclosed_string);
+        break;
+    }
+
+    if (unclosed_string) {
+        parse_error("unterminated string", length);
+    }
+    return count;
+}
+
+void tape_parser::build_tape(size_t length, size_t count, tape_document& document) {
+    const char* buffer = _padded.get();
+    const uint32_t* structurals = _structurals.get();
+    std::vector<uint64_t>& tape = document._tape;
+
+    document.clear();
+    tape.reserve(2 * count + 2);
+    _open.clear();
+
+    if (count == 0) {
+        parse_error("empty document", length);
+    }
+
+    size_t next = 0;
+    auto advance = [&]() -> size_t {
+        if (next == count) {
+            parse_error("unexpected end of input", length);
+        }
+        return structurals[next++];
+    };
+    auto add_string = [&](size_t offset, char type) {
+        char* begin = document.reserve_string(length - offset);
+        char* end = parse_string(buffer, offset, begin);
+        tape.push_back(tape_word(type, document.commit_string(static_cast<size_t>(end - begin))));
+    };
+    auto close = [&](char type) {
+        open_container open = _open.back();
+        _open.pop_back();
+        uint64_t members = std::min<uint64_t>(open.count, tape_document::count_saturated);
+        tape.push_back(tape_word(type, (members << 32) | open.index));
+        tape[open.index] |= tape.size();
+    };
+
+    tape.push_back(tape_word('r', 0));
+
+    size_t offset = advance();
+
+    // The grammar as a small state machine over the structural index; the
+    // container stack replaces recursion, so nesting depth is unbounded.
+value:
+    switch (buffer[offset]) {
+    case '{':
+        _open.push_back({tape.size(), 0});
+        tape.push_back(tape_word('{', 0));
+        offset = advance();
+        if (buffer[offset] == '}') {
+            close('}');
+            goto after_value;
+        }
+        goto object_key;
+    case '[':
+        _open.push_back({tape.size(), 0});
+        tape.push_back(tape_word('[', 0));
+        offset = advance();
+        if (buffer[offset] == ']') {
+            close(']');
+            goto after_value;
+        }
+        ++_open.back().count;
+        goto value;
+    case '"':
+        add_string(offset, '"');
+        goto after_value;
+    case 't':
+    case 'f':
+    case 'n':
+        parse_literal(buffer, offset, tape);
+        goto after_value;
+    case '-':
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+        parse_number(buffer, length, offset, tape);
+        goto after_value;
+    default:
+        parse_error("invalid value", offset);
+    }
+
+object_key:
+    if (buffer[offset] != '"') {
+        parse_error("expected object key", offset);
+    }
+    ++_open.back().count;
+    add_string(offset, 'k');
+    offset = advance();
+    if (buffer[offset] != ':') {
+        parse_error("expected ':' after object key", offset);
+    }
+    offset = advance();
+    goto value;
+
+after_value:
+    if (_open.empty()) {
+        if (next != count) {
+            parse_error("unexpected content after the root value", structurals[next]);
+        }
+        tape.push_back(tape_word('r', 0));
+        tape[0] |= tape.size() - 1;
+        return;
+    }
+    offset = advance();
+    if (static_cast<char>(tape[_open.back().index] >> 56) == '{') {
+        if (buffer[offset] == ',') {
+            offset = advance();
+            goto object_key;
+        }
+        if (buffer[offset] == '}') {
+            close('}');
+            goto after_value;
+        }
+        parse_error("expected ',' or '}' in object", offset);
+    }
+    if (buffer[offset] == ',') {
+        offset = advance();
+        ++_open.back().count;
+        goto value;
+    }
+    if (buffer[offset] == ']') {
+        close(']');
+        goto after_value;
+    }
+    parse_error("expected ',' or ']' in array", offset);
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A third parser for the comparison, built the way simdjson is rather than as
+// a byte-at-a-time scanner:
+//
+//   stage 1  classifies the input 64 bytes at a time with SIMD compares and
+//            turns the quote, backslash, operator and whitespace masks into a
+//            structural index: the offset of every {}[]:, of every string's
+//            opening quote, and of the first byte of every other scalar.
+//   stage 2  walks that index, checks the grammar and writes a tape.
+//
+// Stage 1 has SSE4.2 and AVX2 kernels and a portable scalar one; the widest the
+// CPU supports is picked at runtime.
+//
+// The tape is one 64-bit word per value, with the type in the top byte:
+//
+//   'r'       root; the first word links to the last, which closes the tape
+//   '{' '['   open; payload is the index just past the matching close
+//   '}' ']'   close; low 32 bits index the open, bits 32-55 hold the member or
+//             element count (saturated at 0xffffff)
+//   'k' '"'   object key / string; payload is an offset into the string
+//             buffer, which holds a uint32_t length, the bytes and a NUL
+//   'l' 'u'   int64_t / uint64_t, value in the following word
+//   'd'       double, bits in the following word
+//   't' 'f' 'n'
+
+enum class simd_level {
+    scalar,
+    sse42,
+    avx2,
+};
+
+// The widest stage 1 kernel this CPU can run.
+simd_level detect_simd_level();
+
+const char* simd_level_name(simd_level level);
+
+class tape_document {
+public:
+    static constexpr uint64_t payload_mask = (uint64_t(1) << 56) - 1;
+    static constexpr uint64_t count_saturated = 0xffffff;
+
+    bool empty() const {
+        return _tape.empty();
+    }
+
+    size_t tape_size() const {
+        return _tape.size();
+    }
+
+    const std::vector<uint64_t>& tape() const {
+        return _tape;
+    }
+
+    // Replays the document as RapidJSON SAX events, so any RapidJSON Handler
+    // (Writer, PrettyWriter, Document) can consume it. Numbers are reported
+    // with the narrowest of Int/Uint/Int64/Uint64 that fits, as Reader does.
+    // Returns false if the handler stopped the walk.
+    template <typename Handler>
+    bool accept(Handler& handler) const;
+
+    // The string whose tape payload is offset.
+    std::string_view string_at(uint64_t offset) const {
+        uint32_t length;
+        std::memcpy(&length, _strings.get() + offset, sizeof(length));
+        return std::string_view(_strings.get() + offset + sizeof(length), length);
+    }
+
+private:
+    friend class tape_parser;
+
+    void clear() {
+        _tape.clear();
+        _strings_size = 0;
+    }
+
+    // Makes room for a string of up to max_length bytes and returns where its
+    // bytes go; commit_string then records the actual length.
+    char* reserve_string(size_t max_length);
+    uint64_t commit_string(size_t length);
+
+    uint32_t count_children(size_t open) const;
+
+    std::vector<uint64_t> _tape;
+    std::unique_ptr<char[]> _strings;
+    size_t _strings_size = 0;
+    size_t _strings_capacity = 0;
+};
+
+// Parses JSON text into tape_documents. The parser owns the padded copy of the
+// input and the structural index, and keeps both between parses, so reusing
+// one parser (and document) avoids the per-parse allocations.
+//
+// Strings are not checked for valid UTF-8, matching RapidJSON's defaults.
+// Inputs are limited to 4GB by the 32-bit structural index.
+class tape_parser {
+public:
+    static constexpr size_t padding = 64;
+
+    explicit tape_parser(simd_level level = detect_simd_level())
+            :_level(level) { }
+
+    simd_level level() const {
+        return _level;
+    }
+
+    // Throws std::runtime_error on malformed input, with the byte offset.
+    void parse(std::string_view json, tape_document& document);
+
+    tape_document parse(std::string_view json) {
+        tape_document document;
+        parse(json, document);
+        return document;
+    }
+
+private:
+    size_t find_structurals(size_t length);
+    void build_tape(size_t length, size_t count, tape_document& document);
+
+    simd_level _level;
+    std::unique_ptr<char[]> _padded;
+    size_t _padded_capacity = 0;
+    std::unique_ptr<uint32_t[]> _structurals;
+    size_t _structurals_capacity = 0;
+
+    struct open_container {
+        size_t index;
+        uint32_t count;
+    };
+    std::vector<open_container> _open;
+};
+
+template <typename Handler>
+bool tape_document::accept(Handler& handler) const {
+    if (_tape.empty()) {
+        return false;
+    }
+
+    size_t end = static_cast<size_t>(_tape[0] & payload_mask);
+    for (size_t i = 1; i < end; ++i) {
+        uint64_t word = _tape[i];
+        uint64_t payload = word & payload_mask;
+        bool ok = true;
+
+        switch (static_cast<char>(word >> 56)) {
+        case '{':
+            ok = handler.StartObject();
+            break;
+        case '}': {
+            uint64_t count = payload >> 32;
+            ok = handler.EndObject(static_cast<unsigned>(count == count_saturated ? count_children(payload & 0xffffffff) : count));
+            break;
+        }
+        case '[':
+            ok = handler.StartArray();
+            break;
+        case ']': {
+            uint64_t count = payload >> 32;
+            ok = handler.EndArray(static_cast<unsigned>(count == count_saturated ? count_children(payload & 0xffffffff) : count));
+            break;
+        }
+        case 'k': {
+            std::string_view key = string_at(payload);
+            ok = handler.Key(key.data(), static_cast<unsigned>(key.size()), true);
+            break;
+        }
+        case '"': {
+            std::string_view str = string_at(payload);
+            ok = handler.String(str.data(), static_cast<unsigned>(str.size()), true);
+            break;
+        }
+        case 'l': {
+            auto value = static_cast<int64_t>(_tape[++i]);
+            ok = value >= INT32_MIN ? handler.Int(static_cast<int>(value)) : handler.Int64(value);
+            break;
+        }
+        case 'u': {
+            uint64_t value = _tape[++i];
+            ok = value <= UINT32_MAX ? handler.Uint(static_cast<unsigned>(value)) : handler.Uint64(value);
+            break;
+        }
+        case 'd': {
+            double value;
+            std::memcpy(&value, &_tape[++i], sizeof(value));
+            ok = handler.Double(value);
+            break;
+        }
+        case 't':
+            ok = handler.Bool(true);
+            break;
+        case 'f':
+            ok = handler.Bool(false);
+            break;
+        case 'n':
+            ok = handler.Null();
+            break;
+        }
+
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,199 @@
+#include <benchmark/benchmark.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <fstream>
+
+#include "benchmark_counters.hpp"
+#include "mapped_file.hpp"
+#include "tape.hpp"
+
+using namespace rapidjson;
+
+// Same allocation behaviour as StringBuffer, with every malloc counted. Only
+// used for the untimed allocation report of each benchmark.
+using CountedStringBuffer = GenericStringBuffer<UTF8<>, counting_allocator>;
+
+static std::string ReadString(const char* filename)
+{
+    std::ifstream f(filename);
+    return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// parse JSON from file
+//////////////////////////////////////////////////////////////////////////////
+
+static void ParseFile(benchmark::State& state, const char* filename)
+{
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        auto* f = new mapped_file(filename);
+        auto* j = new tape_document();
+        state.ResumeTiming();
+
+        tape_parser parser;
+        parser.parse(f->view(), *j);
+
+        state.PauseTiming();
+        delete f;
+        delete j;
+        state.ResumeTiming();
+    }
+
+    mapped_file file(filename);
+    state.SetBytesProcessed(state.iterations() * file.size());
+    state.SetLabel(simd_level_name(detect_simd_level()));
+    report_dom_allocations(state, file.size(), [&] {
+        return tape_parser().parse(file.view());
+    });
+}
+BENCHMARK_CAPTURE(ParseFile, canada,                "../data/nativejson-benchmark/canada.json");
+BENCHMARK_CAPTURE(ParseFile, citm_catalog,          "../data/nativejson-benchmark/citm_catalog.json");
+BENCHMARK_CAPTURE(ParseFile, twitter,               "../data/nativejson-benchmark/twitter.json");
+
+//////////////////////////////////////////////////////////////////////////////
+// parse JSON from string
+//////////////////////////////////////////////////////////////////////////////
+
+static void ParseString(benchmark::State& state, const char* filename)
+{
+    std::string str = ReadString(filename);
+
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        auto* j = new tape_document();
+        state.ResumeTiming();
+
+        tape_parser parser;
+        parser.parse(str, *j);
+
+        state.PauseTiming();
+        delete j;
+        state.ResumeTiming();
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    state.SetLabel(simd_level_name(detect_simd_level()));
+    report_dom_allocations(state, str.size(), [&] {
+        return tape_parser().parse(str);
+    });
+}
+BENCHMARK_CAPTURE(ParseString, canada,              "../data/nativejson-benchmark/canada.json");
+BENCHMARK_CAPTURE(ParseString, citm_catalog,        "../data/nativejson-benchmark/citm_catalog.json");
+BENCHMARK_CAPTURE(ParseString, twitter,             "../data/nativejson-benchmark/twitter.json");
+
+//////////////////////////////////////////////////////////////////////////////
+// parse JSON from string, reusing the parser and document
+//////////////////////////////////////////////////////////////////////////////
+
+// Once warm, the padded input copy, structural index, tape and string buffer
+// are all reused, so a parse makes no allocations.
+static void ParseStringReuse(benchmark::State& state, const char* filename)
+{
+    std::string str = ReadString(filename);
+    tape_parser parser;
+    tape_document j;
+
+    while (state.KeepRunning())
+    {
+        parser.parse(str, j);
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+    state.SetLabel(simd_level_name(parser.level()));
+    report_allocations(state, [&] {
+        parser.parse(str, j);
+    });
+}
+BENCHMARK_CAPTURE(ParseStringReuse, canada,         "../data/nativejson-benchmark/canada.json");
+BENCHMARK_CAPTURE(ParseStringReuse, citm_catalog,   "../data/nativejson-benchmark/citm_catalog.json");
+BENCHMARK_CAPTURE(ParseStringReuse, twitter,        "../data/nativejson-benchmark/twitter.json");
+
+//////////////////////////////////////////////////////////////////////////////
+// parse JSON from string with each stage 1 kernel
+//////////////////////////////////////////////////////////////////////////////
+
+static bool Supported(simd_level level)
+{
+    return level <= detect_simd_level();
+}
+
+static void ParseStringKernel(benchmark::State& state, const char* filename, simd_level level)
+{
+    if (!Supported(level))
+    {
+        state.SkipWithError("stage 1 kernel not supported on this CPU");
+        return;
+    }
+
+    std::string str = ReadString(filename);
+    tape_parser parser(level);
+    tape_document j;
+
+    while (state.KeepRunning())
+    {
+        parser.parse(str, j);
+    }
+
+    state.SetBytesProcessed(state.iterations() * str.size());
+}
+BENCHMARK_CAPTURE(ParseStringKernel, canada / scalar,       "../data/nativejson-benchmark/canada.json",       simd_level::scalar);
+BENCHMARK_CAPTURE(ParseStringKernel, canada / sse42,        "../data/nativejson-benchmark/canada.json",       simd_level::sse42);
+BENCHMARK_CAPTURE(ParseStringKernel, canada / avx2,         "../data/nativejson-benchmark/canada.json",       simd_level::avx2);
+BENCHMARK_CAPTURE(ParseStringKernel, citm_catalog / scalar, "../data/nativejson-benchmark/citm_catalog.json", simd_level::scalar);
+BENCHMARK_CAPTURE(ParseStringKernel, citm_catalog / sse42,  "../data/nativejson-benchmark/citm_catalog.json", simd_level::sse42);
+BENCHMARK_CAPTURE(ParseStringKernel, citm_catalog / avx2,   "../data/nativejson-benchmark/citm_catalog.json", simd_level::avx2);
+BENCHMARK_CAPTURE(ParseStringKernel, twitter / scalar,      "../data/nativejson-benchmark/twitter.json",      simd_level::scalar);
+BENCHMARK_CAPTURE(ParseStringKernel, twitter / sse42,       "../data/nativejson-benchmark/twitter.json",      simd_level::sse42);
+BENCHMARK_CAPTURE(ParseStringKernel, twitter / avx2,        "../data/nativejson-benchmark/twitter.json",      simd_level::avx2);
+
+//////////////////////////////////////////////////////////////////////////////
+// serialize JSON
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename Buffer>
+static void Write(const tape_document& j, Buffer& buffer, int indent)
+{
+    if (indent < 0)
+    {
+        Writer<Buffer> writer(buffer);
+        j.accept(writer);
+    }
+    else
+    {
+        PrettyWriter<Buffer> writer(buffer);
+        writer.SetIndent(' ', static_cast<unsigned>(indent));
+        j.accept(writer);
+    }
+}
+
+static void Dump(benchmark::State& state, const char* filename, int indent)
+{
+    std::string str = ReadString(filename);
+    tape_document j = tape_parser().parse(str);
+
+    while (state.KeepRunning())
+    {
+        StringBuffer buffer;
+        Write(j, buffer, indent);
+    }
+
+    StringBuffer buffer;
+    Write(j, buffer, indent);
+    state.SetBytesProcessed(state.iterations() * buffer.GetSize());
+    report_allocations(state, [&] {
+        CountedStringBuffer counted;
+        Write(j, counted, indent);
+    });
+}
+BENCHMARK_CAPTURE(Dump, canada / -,        "../data/nativejson-benchmark/canada.json",       -1);
+BENCHMARK_CAPTURE(Dump, canada / 4,        "../data/nativejson-benchmark/canada.json",       4);
+BENCHMARK_CAPTURE(Dump, citm_catalog / -,  "../data/nativejson-benchmark/citm_catalog.json", -1);
+BENCHMARK_CAPTURE(Dump, citm_catalog / 4,  "../data/nativejson-benchmark/citm_catalog.json", 4);
+BENCHMARK_CAPTURE(Dump, twitter / -,       "../data/nativejson-benchmark/twitter.json",      -1);
+BENCHMARK_CAPTURE(Dump, twitter / 4,       "../data/nativejson-benchmark/twitter.json",      4);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,106 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <fstream>
+#include <rapidjson/document.h>
+#include <string>
+#include <vector>
+
+#include "tape.hpp"
+
+using namespace rapidjson;
+
+// Rebuilds a RapidJSON Document from the tape, for comparison with one parsed
+// by RapidJSON itself. Full precision, so that doubles compare exactly.
+static Document from_tape(const tape_document& tape) {
+    Document d;
+    auto generator = [&](Document& handler) { return tape.accept(handler); };
+    d.Populate(generator);
+    return d;
+}
+
+static Document from_rapidjson(const std::string& json) {
+    Document d;
+    d.Parse<kParseFullPrecisionFlag>(json.c_str());
+    REQUIRE(!d.HasParseError());
+    return d;
+}
+
+static std::vector<simd_level> supported_levels() {
+    std::vector<simd_level> levels;
+    for (simd_level level : {simd_level::scalar, simd_level::sse42, simd_level::avx2}) {
+        if (level <= detect_simd_level()) {
+            levels.push_back(level);
+        }
+    }
+    return levels;
+}
+
+TEST_CASE("tape scalars") {
+    std::string json = R"([0, -0, 1, -1, 4294967295, 4294967296, -2147483648, -2147483649,
+        9223372036854775807, -9223372036854775808, 18446744073709551615, 18446744073709551616,
+        -9223372036854775809, 1.5, -2.5e-3, 1E300, 0.1, true, false, null, ""])";
+
+    tape_document tape = tape_parser().parse(json);
+    REQUIRE(from_tape(tape) == from_rapidjson(json));
+}
+
+TEST_CASE("tape strings") {
+    std::string json = R"({"plain": "abc", "escapes": "\"\\\/\b\f\n\r\t", "unicode": "\u00e9\u20ac\ud83d\ude00",
+        "raw": "é€😀", "": {"nested": ["\\\"", "a\\\\"]}})";
+
+    tape_document tape = tape_parser().parse(json);
+    Document d = from_tape(tape);
+    REQUIRE(d == from_rapidjson(json));
+    REQUIRE(std::string(d["unicode"].GetString()) == "é€😀");
+    REQUIRE(std::string(d[""]["nested"][1].GetString()) == "a\\\\");
+}
+
+TEST_CASE("tape kernels agree across block boundaries") {
+    // Runs of backslashes and quotes that straddle the 64-byte blocks.
+    std::string json = "[";
+    for (int i = 0; i < 200; ++i) {
+        json += "\"" + std::string(i % 7, '\\') + std::string(i % 7, '\\') + "\\\"" + std::string(i % 61, 'x') + "\", ";
+        json += std::to_string(i) + ",";
+    }
+    json += "{}]";
+
+    tape_document expected = tape_parser(simd_level::scalar).parse(json);
+    REQUIRE(from_tape(expected) == from_rapidjson(json));
+    for (simd_level level : supported_levels()) {
+        CAPTURE(simd_level_name(level));
+        REQUIRE(tape_parser(level).parse(json).tape() == expected.tape());
+    }
+}
+
+TEST_CASE("tape round trips the corpora") {
+    for (const char* filename : {"../data/nativejson-benchmark/canada.json",
+            "../data/nativejson-benchmark/citm_catalog.json", "../data/nativejson-benchmark/twitter.json"}) {
+        std::ifstream f(filename);
+        std::string json((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        REQUIRE(!json.empty());
+        Document expected = from_rapidjson(json);
+
+        for (simd_level level : supported_levels()) {
+            CAPTURE(filename, simd_level_name(level));
+            REQUIRE(from_tape(tape_parser(level).parse(json)) == expected);
+        }
+    }
+}
+
+TEST_CASE("tape parser reuse") {
+    tape_parser parser;
+    tape_document tape;
+    parser.parse(R"({"a": [1, 2, 3], "b": "long enough to need the string buffer"})", tape);
+    parser.parse(R"([true])", tape);
+    REQUIRE(from_tape(tape) == from_rapidjson("[true]"));
+}
+
+TEST_CASE("tape rejects malformed input") {
+    for (const char* json : {"", "   ", "[1,]", "{\"a\" 1}", "{\"a\":1,}", "[01]", "[-]", "[1.]", "[1e]",
+            "truex", "[true\"x\"]", "\"abc", "\"a\\\"", "[1] 2", "[1 2]", "{\"a\":1 \"b\":2}", "[\"\\x\"]",
+            "[\"\\ud800\"]", "[\"\x01\"]", "{1:2}", "[", "]", "{\"a\":}"}) {
+        CAPTURE(json);
+        REQUIRE_THROWS_AS(tape_parser().parse(json), std::runtime_error);
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+// Internal to the tape parser. Each stage 1 kernel lives in its own translation
+// unit compiled with that instruction set's -m flags; the shared code below has
+// internal linkage so differently compiled copies never get merged by the
+// linker into one that the CPU may not support.
+
+#include <cstddef>
+#include <cstdint>
+
+// Each returns the number of structural offsets written to out (which must
+// have room for length + 1), and sets unclosed_string if the input ends inside
+// a string. buffer holds length bytes followed by at least 64 bytes of spaces.
+size_t find_structurals_scalar(const char* buffer, size_t length, uint32_t* out, bool& unclosed_string);
+size_t find_structurals_sse42(const char* buffer, size_t length, uint32_t* out, bool& unclosed_string);
+size_t find_structurals_avx2(const char* buffer, size_t length, uint32_t* out, bool& unclosed_string);
+
+// Whether the kernel was compiled into this build at all; the x86 kernels are
+// empty on other architectures.
+bool have_sse42_kernel();
+bool have_avx2_kernel();
+
+namespace {
+
+// One bit per byte of a 64-byte block.
+struct block_masks {
+    uint64_t quote;
+    uint64_t backslash;
+    // { } [ ] : ,
+    uint64_t op;
+    // space, tab, newline, carriage return
+    uint64_t whitespace;
+};
+
+// Bit i of the result is the XOR of bits 0..i: with quote bits in, the result
+// marks each opening quote and the bytes up to (not including) its close.
+inline uint64_t prefix_xor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+// The block-to-block state of the scan, and the bit logic that turns a block's
+// character masks into structural starts.
+class structural_scanner {
+public:
+    uint64_t next(const block_masks& masks) {
+        uint64_t escaped = find_escaped(masks.backslash);
+        uint64_t quote = masks.quote & ~escaped;
+
+        uint64_t in_string = prefix_xor(quote) ^ _in_string;
+        _in_string = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+        // The body of each string and its closing quote, but not the opening
+        // quote, which is itself structural.
+        uint64_t string_tail = in_string ^ quote;
+
+        // Scalars are everything that is not an operator or whitespace; one
+        // starts wherever a scalar byte does not follow another. A quote does
+        // not count as "another", so a literal directly after a closing quote
+        // ("x"true) starts a new value. A quote directly after a literal
+        // (true"x") continues it, and stage 2 rejects the literal for not
+        // ending at a terminator.
+        uint64_t scalar = ~(masks.op | masks.whitespace);
+        uint64_t nonquote_scalar = scalar & ~quote;
+        uint64_t follows_scalar = (nonquote_scalar << 1) | _scalar;
+        _scalar = nonquote_scalar >> 63;
+
+        return (masks.op | (scalar & ~follows_scalar)) & ~string_tail;
+    }
+
+    bool in_string() const {
+        return _in_string != 0;
+    }
+
+private:
+    // Marks the bytes escaped by a backslash: the second of each pair in a run
+    // of backslashes, and the byte after a run of odd length.
+    uint64_t find_escaped(uint64_t backslash) {
+        const uint64_t even_bits = 0x5555555555555555ULL;
+
+        backslash &= ~_escaped;
+        uint64_t follows_escape = (backslash << 1) | _escaped;
+        uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+        uint64_t sequences_starting_on_even_bits;
+        _escaped = __builtin_add_overflow(odd_sequence_starts, backslash, &sequences_starting_on_even_bits) ? 1 : 0;
+        uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+        return (even_bits ^ invert_mask) & follows_escape;
+    }
+
+    uint64_t _escaped = 0;
+    uint64_t _in_string = 0;
+    uint64_t _scalar = 0;
+};
+
+inline uint32_t* flatten_bits(uint32_t* out, uint32_t base, uint64_t bits) {
+    while (bits != 0) {
+        *out++ = base + static_cast<uint32_t>(__builtin_ctzll(bits));
+        bits &= bits - 1;
+    }
+    return out;
+}
+
+// The scan, parameterised on how a block is classified. Reading whole blocks
+// past length is safe because of the padding, and the padding is whitespace,
+// so it never adds structurals.
+template <typename Classify>
+size_t scan_structurals(const char* buffer, size_t length, uint32_t* out, bool& unclosed_string, Classify classify) {
+    structural_scanner scanner;
+    uint32_t* next = out;
+    for (size_t base = 0; base < length; base += 64) {
+        block_masks masks;
+        classify(buffer + base, masks);
+        next = flatten_bits(next, static_cast<uint32_t>(base), scanner.next(masks));
+    }
+    unclosed_string = scanner.in_string();
+    return static_cast<size_t>(next - out);
+}
+
+}
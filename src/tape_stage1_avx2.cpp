@@ -0,0 +1,55 @@
+#include "tape_stage1.hpp"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace {
+
+// 32 bytes at a time; the same compares as the SSE4.2 kernel.
+struct classify_avx2 {
+    void operator()(const char* block, block_masks& masks) const {
+        masks = block_masks{};
+        for (unsigned i = 0; i < 2; ++i) {
+            __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i));
+            __m256i folded = _mm256_or_si256(in, _mm256_set1_epi8(0x20));
+
+            __m256i quote = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('"'));
+            __m256i backslash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('\\'));
+            __m256i op = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(in, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(in, _mm256_set1_epi8(','))));
+            __m256i whitespace = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(in, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(in, _mm256_set1_epi8('\t'))),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(in, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(in, _mm256_set1_epi8('\r'))));
+
+            unsigned shift = 32 * i;
+            masks.quote |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(quote))) << shift;
+            masks.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(backslash))) << shift;
+            masks.op |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(op))) << shift;
+            masks.whitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(whitespace))) << shift;
+        }
+    }
+};
+
+}
+
+size_t find_structurals_avx2(const char* buffer, size_t length, uint32_t* out, bool& unclosed_string) {
+    return scan_structurals(buffer, length, out, unclosed_string, classify_avx2());
+}
+
+bool have_avx2_kernel() {
+    return true;
+}
+
+#else
+
+size_t find_structurals_avx2(const char* buffer, size_t length, uint32_t* out, bool& unclosed_string) {
+    return find_structurals_scalar(buffer, length, out, unclosed_string);
+}
+
+bool have_avx2_kernel() {
+    return false;
+}
+
+#endif
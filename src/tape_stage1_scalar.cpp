@@ -0,0 +1,49 @@
+#include "tape_stage1.hpp"
+
+#include <initializer_list>
+
+namespace {
+
+enum : uint8_t {
+    class_quote = 1,
+    class_backslash = 2,
+    class_op = 4,
+    class_whitespace = 8,
+};
+
+struct byte_classes {
+    uint8_t table[256] = {};
+
+    constexpr byte_classes() {
+        table[static_cast<uint8_t>('"')] = class_quote;
+        table[static_cast<uint8_t>('\\')] = class_backslash;
+        for (char c : {'{', '}', '[', ']', ':', ','}) {
+            table[static_cast<uint8_t>(c)] = class_op;
+        }
+        for (char c : {' ', '\t', '\n', '\r'}) {
+            table[static_cast<uint8_t>(c)] = class_whitespace;
+        }
+    }
+};
+
+constexpr byte_classes classes;
+
+struct classify_scalar {
+    void operator()(const char* block, block_masks& masks) const {
+        masks = block_masks{};
+        for (unsigned i = 0; i < 64; ++i) {
+            uint8_t c = classes.table[static_cast<uint8_t>(block[i])];
+            uint64_t bit = uint64_t(1) << i;
+            masks.quote |= (c & class_quote) ? bit : 0;
+            masks.backslash |= (c & class_backslash) ? bit : 0;
+            masks.op |= (c & class_op) ? bit : 0;
+            masks.whitespace |= (c & class_whitespace) ? bit : 0;
+        }
+    }
+};
+
+}
+
+size_t find_structurals_scalar(const char* buffer, size_t length, uint32_t* out, bool& unclosed_string) {
+    return scan_structurals(buffer, length, out, unclosed_string, classify_scalar());
+}
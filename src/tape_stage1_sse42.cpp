@@ -0,0 +1,56 @@
+#include "tape_stage1.hpp"
+
+#if defined(__SSE4_2__)
+
+#include <nmmintrin.h>
+
+namespace {
+
+// 16 bytes at a time: operators are found with two compares by folding case,
+// since '[' | 0x20 == '{' and ']' | 0x20 == '}', and no other byte maps there.
+struct classify_sse42 {
+    void operator()(const char* block, block_masks& masks) const {
+        masks = block_masks{};
+        for (unsigned i = 0; i < 4; ++i) {
+            __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+            __m128i folded = _mm_or_si128(in, _mm_set1_epi8(0x20));
+
+            __m128i quote = _mm_cmpeq_epi8(in, _mm_set1_epi8('"'));
+            __m128i backslash = _mm_cmpeq_epi8(in, _mm_set1_epi8('\\'));
+            __m128i op = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+                    _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8(':')), _mm_cmpeq_epi8(in, _mm_set1_epi8(','))));
+            __m128i whitespace = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(in, _mm_set1_epi8('\t'))),
+                    _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(in, _mm_set1_epi8('\r'))));
+
+            unsigned shift = 16 * i;
+            masks.quote |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(quote))) << shift;
+            masks.backslash |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(backslash))) << shift;
+            masks.op |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(op))) << shift;
+            masks.whitespace |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(whitespace))) << shift;
+        }
+    }
+};
+
+}
+
+size_t find_structurals_sse42(const char* buffer, size_t length, uint32_t* out, bool& unclosed_string) {
+    return scan_structurals(buffer, length, out, unclosed_string, classify_sse42());
+}
+
+bool have_sse42_kernel() {
+    return true;
+}
+
+#else
+
+size_t find_structurals_sse42(const char* buffer, size_t length, uint32_t* out, bool& unclosed_string) {
+    return find_structurals_scalar(buffer, length, out, unclosed_string);
+}
+
+bool have_sse42_kernel() {
+    return false;
+}
+
+#endif
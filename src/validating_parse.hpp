@@ -0,0 +1,119 @@
+#pragma once
+
+#include <rapidjson/document.h>
+#include <rapidjson/schema.h>
+#include <rapidjson/stringbuffer.h>
+#include <string>
+
+#include "profile.hpp"
+
+struct validation_result {
+    rapidjson::ParseResult parse;
+    bool valid = true;
+
+    // Set when valid is false, in the form SchemaValidator reports them.
+    std::string schema_pointer;
+    std::string keyword;
+    std::string document_pointer;
+
+    explicit operator bool() const {
+        return !parse.IsError() && valid;
+    }
+};
+
+// Fills in a validation_result from anything with the SchemaValidator error
+// accessors (the validator itself, or GenericSchemaValidatingReader).
+template <typename Validator>
+validation_result make_validation_result(const rapidjson::ParseResult& parse, const Validator& validator) {
+    validation_result result;
+    result.parse = parse;
+    result.valid = validator.IsValid();
+    if (!result.valid) {
+        rapidjson::StringBuffer buf;
+        validator.GetInvalidSchemaPointer().StringifyUriFragment(buf);
+        result.schema_pointer.assign(buf.GetString(), buf.GetSize());
+        result.keyword = validator.GetInvalidSchemaKeyword();
+        buf.Clear();
+        validator.GetInvalidDocumentPointer().StringifyUriFragment(buf);
+        result.document_pointer.assign(buf.GetString(), buf.GetSize());
+    }
+    return result;
+}
+
+// Parses and validates in a single pass: the schema validator sits between the
+// tokenizer and the document, so the first violation aborts the parse, and the
+// document only receives a value if the whole input was valid. Compare with
+// parsing into a Document and then calling Accept(validator), which builds the
+// complete DOM before it can reject anything.
+//
+// This is what GenericSchemaValidatingReader does, spelled out so that the
+// validator's and the document's shares of each event are separate phases.
+template <unsigned parseFlags = rapidjson::kParseDefaultFlags, typename Document, typename InputStream>
+validation_result validating_parse(Document& document, InputStream& is, const rapidjson::SchemaDocument& schema) {
+    phase_scope tokenize(phase::tokenize);
+    rapidjson::Reader reader;
+    validation_result result;
+    auto generator = [&](Document& handler) {
+        phase_handler<Document> dom(handler, phase::dom_build);
+        rapidjson::GenericSchemaValidator<rapidjson::SchemaDocument, phase_handler<Document>> validator(schema, dom);
+        phase_handler<decltype(validator)> validate(validator, phase::validate);
+        result = make_validation_result(reader.Parse<parseFlags>(is, validate), validator);
+        return static_cast<bool>(result);
+    };
+    document.Populate(generator);
+    return result;
+}
+
+template <unsigned parseFlags = rapidjson::kParseDefaultFlags, typename Document>
+validation_result validating_parse(Document& document, const char* json, const rapidjson::SchemaDocument& schema) {
+    rapidjson::StringStream ss(json);
+    return validating_parse<parseFlags>(document, ss, schema);
+}
+
+// A schema validator wired to its own output Document, so that it can be
+// reused for single-pass parses (GenericSchemaValidatingReader builds a fresh
+// validator every time). Pool these with acquire_validator<validating_document>.
+struct validating_document {
+    explicit validating_document(const rapidjson::SchemaDocument& schema)
+            :validator(schema, document) { }
+
+    void Reset() {
+        validator.Reset();
+    }
+
+    rapidjson::Document document;
+    rapidjson::GenericSchemaValidator<rapidjson::SchemaDocument, rapidjson::Document> validator;
+};
+
+// Single-pass parse through a reusable validating_document. On success the
+// parsed value, and the allocator that owns it, are swapped into document;
+// either way the pooled document is left empty for the next parse. The pooled
+// validator writes straight into its document, so when profiling, DOM building
+// counts as validate here.
+template <unsigned parseFlags = rapidjson::kParseDefaultFlags, typename InputStream>
+validation_result validating_parse(rapidjson::Document& document, InputStream& is, validating_document& pooled) {
+    phase_scope tokenize(phase::tokenize);
+    rapidjson::Reader reader;
+    rapidjson::ParseResult parse;
+    auto generator = [&](rapidjson::Document&) {
+        phase_handler<decltype(pooled.validator)> validate(pooled.validator, phase::validate);
+        parse = reader.Parse<parseFlags>(is, validate);
+        return !parse.IsError();
+    };
+    pooled.document.Populate(generator);
+
+    validation_result result = make_validation_result(parse, pooled.validator);
+    if (result) {
+        document.Swap(pooled.document);
+    }
+    // Drops whatever the pooled document holds now: the caller's previous
+    // value, or the partial tree of a failed parse.
+    rapidjson::Document().Swap(pooled.document);
+    return result;
+}
+
+template <unsigned parseFlags = rapidjson::kParseDefaultFlags>
+validation_result validating_parse(rapidjson::Document& document, const char* json, validating_document& pooled) {
+    rapidjson::StringStream ss(json);
+    return validating_parse<parseFlags>(document, ss, pooled);
+}
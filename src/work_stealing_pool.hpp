@@ -0,0 +1,152 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run batches of indexed tasks. Each batch is
+// dealt out to the workers in contiguous runs; a worker takes from the back of
+// its own queue and, once that is empty, steals from the front of the others,
+// so uneven tasks (long lines, big documents) still spread over all workers.
+//
+// Queues are mutex protected rather than lock free: tasks here are whole
+// chunks of input, so the queue is touched a few hundred times per batch and
+// never shows up next to the work itself.
+class work_stealing_pool {
+public:
+    using task = std::function<void(size_t index, size_t worker)>;
+
+    explicit work_stealing_pool(size_t threads) {
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            _queues.push_back(std::make_unique<queue>());
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            _threads.emplace_back([this, i] { work(i); });
+        }
+    }
+
+    work_stealing_pool(const work_stealing_pool&) = delete;
+    work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+    ~work_stealing_pool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _wake.notify_all();
+        for (auto& thread : _threads) {
+            thread.join();
+        }
+    }
+
+    size_t size() const {
+        return _threads.size();
+    }
+
+    // Runs fn(index, worker) for every index in [0, count) and returns once all
+    // of them have finished. worker is in [0, size()) and identifies the thread,
+    // for per-thread state. Not reentrant.
+    void run(size_t count, task fn) {
+        if (count == 0) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _task = std::move(fn);
+        _remaining = count;
+
+        // Queue the tasks only after _task is set: a worker still draining the
+        // previous batch may pick them up without waiting for the wake-up.
+        size_t workers = _queues.size();
+        for (size_t w = 0; w < workers; ++w) {
+            std::lock_guard<std::mutex> queue_lock(_queues[w]->mutex);
+            for (size_t i = count * w / workers; i < count * (w + 1) / workers; ++i) {
+                _queues[w]->tasks.push_back(i);
+            }
+        }
+
+        ++_generation;
+        _wake.notify_all();
+        _done.wait(lock, [this] { return _remaining == 0; });
+        _task = nullptr;
+    }
+
+private:
+    struct queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    bool pop(size_t worker, size_t& index) {
+        {
+            queue& own = *_queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                index = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for (size_t offset = 1; offset < _queues.size(); ++offset) {
+            queue& victim = *_queues[(worker + offset) % _queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                index = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void work(size_t worker) {
+        size_t seen = 0;
+        for (;;) {
+            const task* fn;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [&] { return _stopping || _generation != seen; });
+                if (_stopping) {
+                    return;
+                }
+                seen = _generation;
+                fn = &_task;
+            }
+
+            size_t finished = 0;
+            size_t index;
+            while (pop(worker, index)) {
+                (*fn)(index, worker);
+                ++finished;
+            }
+
+            if (finished != 0) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _remaining -= finished;
+                if (_remaining == 0) {
+                    _done.notify_all();
+                }
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<queue>> _queues;
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    task _task;
+    size_t _remaining = 0;
+    size_t _generation = 0;
+    bool _stopping = false;
+};
@@ -0,0 +1,134 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <string>
+#include <unistd.h>
+
+#include "json_writer.hpp"
+#include "mapped_file.hpp"
+
+using namespace rapidjson;
+
+static std::string read_corpus(const char* filename) {
+    std::ifstream f(filename);
+    std::string json((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    REQUIRE(!json.empty());
+    return json;
+}
+
+static std::string rapid_write(const Document& d, int indent) {
+    StringBuffer buffer;
+    if (indent < 0) {
+        Writer<StringBuffer> writer(buffer);
+        d.Accept(writer);
+    } else {
+        PrettyWriter<StringBuffer> writer(buffer);
+        writer.SetIndent(' ', static_cast<unsigned>(indent));
+        d.Accept(writer);
+    }
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+static std::string engine_write(const Document& d, int indent) {
+    output_buffer buffer(16);
+    json_writer<output_buffer> writer(buffer, indent);
+    REQUIRE(d.Accept(writer));
+    return std::string(buffer.view());
+}
+
+TEST_CASE("writer matches RapidJSON's writers") {
+    // No doubles in these two, so the output is identical byte for byte.
+    for (const char* filename : {"../data/nativejson-benchmark/citm_catalog.json",
+            "../data/nativejson-benchmark/twitter.json"}) {
+        Document d;
+        d.Parse(read_corpus(filename).c_str());
+        for (int indent : {-1, 0, 4}) {
+            CAPTURE(filename, indent);
+            REQUIRE(engine_write(d, indent) == rapid_write(d, indent));
+        }
+    }
+}
+
+// Layout (indentation, separators, member order) matches dump(); escapes follow
+// RapidJSON's, which nlohmann 3.6.1 writes in lowercase hex.
+TEST_CASE("writer matches the layout of nlohmann's dump") {
+    for (const char* filename : {"../data/nativejson-benchmark/citm_catalog.json",
+            "../data/nativejson-benchmark/twitter.json"}) {
+        nlohmann::json j = nlohmann::json::parse(read_corpus(filename));
+        for (int indent : {-1, 4}) {
+            CAPTURE(filename, indent);
+            output_buffer buffer;
+            json_writer<output_buffer> writer(buffer, indent);
+            REQUIRE(write_json(j, writer));
+            REQUIRE(buffer.view() == j.dump(indent));
+        }
+    }
+}
+
+TEST_CASE("control characters are escaped in uppercase hex, unlike nlohmann's dump") {
+    nlohmann::json j = {{"control", std::string("a\x01\x1f\x7f\tb")}};
+    output_buffer buffer;
+    json_writer<output_buffer> writer(buffer, -1);
+    REQUIRE(write_json(j, writer));
+
+    // DEL is not a control character to either.
+    REQUIRE(buffer.view() == "{\"control\":\"a\\u0001\\u001F\x7f\\tb\"}");
+    REQUIRE(j.dump() == "{\"control\":\"a\\u0001\\u001f\x7f\\tb\"}");
+}
+
+TEST_CASE("shortest doubles round trip") {
+    Document d;
+    d.Parse<kParseFullPrecisionFlag>(read_corpus("../data/nativejson-benchmark/canada.json").c_str());
+    for (int indent : {-1, 4}) {
+        std::string text = engine_write(d, indent);
+        Document back;
+        back.Parse<kParseFullPrecisionFlag>(text.c_str());
+        REQUIRE(back == d);
+    }
+
+    char buffer[max_output_reserve];
+    REQUIRE(std::string(buffer, format_double(buffer, 0.1)) == "0.1");
+    REQUIRE(std::string(buffer, format_double(buffer, 100.0)) == "100.0");
+    REQUIRE(std::string(buffer, format_double(buffer, -0.0)) == "-0.0");
+    REQUIRE(format_double(buffer, 1.0 / 0.0) == nullptr);
+    REQUIRE(std::string(buffer, format_int64(buffer, INT64_MIN)) == "-9223372036854775808");
+    REQUIRE(std::string(buffer, format_uint64(buffer, UINT64_MAX)) == "18446744073709551615");
+}
+
+TEST_CASE("strings are escaped around the SIMD blocks") {
+    Document d;
+    d.SetArray();
+    std::string padding(15, 'x');
+    for (std::string str : {padding + "\"", padding + "x\\", std::string("\x01\x1f\x7f\xc3\xa9/"), padding + padding + "\n\t"}) {
+        d.PushBack(Value(str.c_str(), static_cast<SizeType>(str.size()), d.GetAllocator()), d.GetAllocator());
+    }
+    REQUIRE(engine_write(d, -1) == rapid_write(d, -1));
+}
+
+TEST_CASE("fd output writes everything through small chunks") {
+    Document d;
+    d.Parse(read_corpus("../data/nativejson-benchmark/twitter.json").c_str());
+    std::string expected = engine_write(d, 2);
+
+    char name[] = "/tmp/writer_outputXXXXXX";
+    int fd = mkstemp(name);
+    REQUIRE(fd >= 0);
+    {
+        fd_output out(fd, 100, 3);
+        json_writer<fd_output> writer(out, 2);
+        d.Accept(writer);
+        out.flush();
+        REQUIRE(out.bytes_written() == expected.size());
+    }
+    ::close(fd);
+    REQUIRE(read_file(name) == expected);
+    std::remove(name);
+}